@@ -2,12 +2,15 @@
 #include <time.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 typedef unsigned long long ticks_t;
 
 #if defined(_MSC_VER)
 #pragma warning(disable:4996)
 #include <intrin.h>
+#define fseek _fseeki64                /* files larger than 2 GB */
+#define ftell _ftelli64
 
 ticks_t ticks()
 {
@@ -16,9 +19,9 @@ ticks_t ticks()
 #elif defined(__GNUC__)
 ticks_t ticks()
 {
-  ticks_t result;
-  __asm__ __volatile__("rdtsc" : "=A" (result));
-  return result;
+  unsigned int lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((ticks_t)hi << 32) | lo;
 }
 #else
 #include <time.h>
@@ -29,15 +32,46 @@ ticks_t ticks()
 }
 #endif
 
-int uxml_get_initial_allocated( uxml_node_t *root );
+size_t uxml_get_initial_allocated( uxml_node_t *root );
+
+int on_flush( void *user, const char *data, size_t size )
+{
+  *(size_t *)user += size;             /* output is counted only */
+  return 1;
+}
+
+/* pass node to streaming writer, content is written before child nodes */
+void write_node( uxml_writer_t *w, uxml_node_t *n )
+{
+  uxml_node_t *a;
+  const char *s;
+  size_t size;
+
+  uxml_writer_start_element( w, uxml_name( n ) );
+  for( a = uxml_first_attr( n ); a != NULL; a = uxml_next_attr( a ) )
+  {
+    uxml_writer_attribute( w, uxml_name( a ), uxml_get( a, NULL ) );
+  }
+  if( (s = uxml_get_ref( n, NULL, &size )) != NULL && size != 0 )
+  {
+    uxml_writer_text( w, s, size );
+  }
+  for( a = uxml_child_node( n ); a != NULL; a = uxml_next( a ) ) /* child nodes follow attributes */
+  {
+    write_node( w, a );
+  }
+  uxml_writer_end_element( w );
+}
 
 int main( int argc, char *argv[] )
 {
   FILE *fp;
-  void *b;
-  int size, n;
-  int i, j, k = 0;
-  uxml_node_t *r;
+  void *b, *w = NULL;
+  size_t size, n, j = 0;
+  int i, k = 0, ref = 0, insitu = 0, write = 0;
+  uxml_node_t *r, *root = NULL;
+  uxml_writer_t *wr;
+  uxml_context_t *ctx = NULL;
   uxml_error_t e;
   time_t t, t0;
   ticks_t tck, freq;
@@ -48,6 +82,22 @@ int main( int argc, char *argv[] )
     {
       break;
     }
+    if( strcmp( argv[i], "-r" ) == 0 ) /* names and contents refer to XML data */
+    {
+      ref = 1;
+    }
+    if( strcmp( argv[i], "-i" ) == 0 ) /* in-situ parse of the copy of XML data, copy is measured too */
+    {
+      insitu = 1;
+    }
+    if( strcmp( argv[i], "-w" ) == 0 ) /* streaming writer of parsed tree, size of output is measured */
+    {
+      write = 1;
+    }
+    if( strcmp( argv[i], "-c" ) == 0 && ctx == NULL ) /* buffers of parse context are reused */
+    {
+      ctx = uxml_context_create();
+    }
   }
 
   if( i == argc )
@@ -60,12 +110,12 @@ int main( int argc, char *argv[] )
     return fprintf( stderr, "fopen(%s) failed\n", argv[i] );
   }
   fseek( fp, 0, SEEK_END );
-  n = ftell( fp );
+  n = (size_t)ftell( fp );
   fseek( fp, 0, SEEK_SET );
   if( (b = malloc( n )) == NULL )
   {
     fclose( fp );
-    return fprintf( stderr, "malloc(%d) failed\n", n );
+    return fprintf( stderr, "malloc(%.0f) failed\n", (double)n );
   }
   size = fread( b, 1, n, fp );
   fclose( fp );
@@ -75,6 +125,21 @@ int main( int argc, char *argv[] )
     return fprintf( stderr, "fread failed\n" );
   }
 
+  if( insitu && (w = malloc( n )) == NULL )
+  {
+    free( b );
+    return fprintf( stderr, "malloc(%.0f) failed\n", (double)n );
+  }
+
+  if( write )
+  {
+    if( (root = uxml_parse( b, n, &e )) == NULL )
+    {
+      return fprintf( stderr, "Line %d column %d: %s\n", e.line, e.column, e.text );
+    }
+    j = uxml_get_initial_allocated( root );
+  }
+
   for( t0 = time( &t0 ); time( &t ) == t0; );
   tck = ticks();
   for( t0 = t; time( &t ) == t0; );
@@ -83,7 +148,21 @@ int main( int argc, char *argv[] )
   tck = ticks();
   do
   {
-    if( (r = uxml_parse( b, n, &e )) == NULL )
+    if( write )
+    {
+      n = 0;
+      wr = uxml_writer_create( on_flush, &n, UXML_WRITE_COMPACT );
+      write_node( wr, root );
+      uxml_writer_finish( wr, NULL );
+      uxml_writer_free( wr );
+      k++;
+      continue;
+    }
+    if( insitu )
+    {
+      memcpy( w, b, n );
+    }
+    if( (r = (ctx != NULL ? uxml_parse_ctx( ctx, b, n, &e ): insitu ? uxml_parse_insitu( w, n, &e ): ref ? uxml_parse_ref( b, n, &e ): uxml_parse( b, n, &e ))) == NULL )
     {
       return fprintf( stderr, "Line %d column %d: %s\n", e.line, e.column, e.text );
     }
@@ -95,13 +174,19 @@ int main( int argc, char *argv[] )
   while( (ticks() - tck) < 5 * freq );
   tck = ticks() - tck;
 
-  printf( "CPU %.3f GHz: %d ticks/character, %d bytes/s, %d bytes allocated (%d%% overhead)\n", 
+  printf( "CPU %.3f GHz: %.2f ticks/character, %.0f bytes/s, %.0f bytes allocated (%d%% overhead)\n", 
   (double)( 0.000000001 * freq ),
-  (int)(tck / (n * k)),
-  (int)(freq * n * k / tck),
-  j,
-  (j - n) * 100 / n );
+  (double)tck / ((double)n * k),
+  (double)freq * n * k / tck,
+  (double)j,
+  (int)(((double)j - (double)n) * 100 / n) );
 
+  if( root != NULL )
+  {
+    uxml_free( root );
+  }
+  uxml_context_free( ctx );
   free( b );
+  free( w );
   return 0;
 }
@@ -1,6 +1,9 @@
 #include <uxml.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <stddef.h>
 
 uxml_error_t e;
 
@@ -11,6 +14,7 @@ int print_error( uxml_error_t *e )
 }
 
 void uxml_dump_list( uxml_node_t *root );
+size_t uxml_get_initial_allocated( uxml_node_t *root );
 
 int test( const char *x )
 {
@@ -68,6 +72,8 @@ int test_navigate()
   printf( "../nodeB/attrB2=\"%s\"\n", uxml_get( node, "../nodeB/attrB2" ) );
   printf( "prev of nodeB is %s\n", uxml_name( uxml_prev( uxml_node( root, "nodeB" ) ) ) );
   printf( "next of nodeB is %s\n", uxml_name( uxml_next( uxml_node( root, "nodeB" ) ) ) );
+  printf( "last child of root is %s\n", uxml_get( uxml_last_child( root ), NULL ) );
+  printf( "prev attribute of nodeB/attrB2 is %s\n", uxml_name( uxml_prev_attr( uxml_node( root, "nodeB/attrB2" ) ) ) );
   printf( "/nodeD[4]=\"%s\"\n", uxml_get( root, "/nodeD[4]" ) );
   printf( "/nodeD[2]/*=\"%s\"\n", uxml_get( root, "/nodeD[2]/*" ) );
   printf( "/nodeD[2]/*[1]=\"%s\"\n", uxml_get( root, "/nodeD[2]/*[1]" ) );
@@ -76,6 +82,1350 @@ int test_navigate()
   return 1;
 }
 
+int test_grow()
+{
+  uxml_node_t *root;
+  char xml[8192], name[32];
+  int i, k, n;
+
+  /* many nodes and moved content, parser must grow its buffers */
+  n = sprintf( xml, "<nodeR>contentR" );
+  for( i = 0; i < 200; i++ )
+  {
+    n += sprintf( xml + n, "<n a='%d'/>", i );
+  }
+  n += sprintf( xml + n, "</nodeR>" );
+
+  if( (root = uxml_parse( xml, n, &e )) == NULL ) 
+    return print_error( &e );
+  for( i = 0; i < 200; i++ )
+  {
+    sprintf( name, "n[%d]/a", i );
+    if( uxml_int( root, name ) != i )
+    {
+      printf( "grow failed at %s\n", name );
+      uxml_free( root );
+      return 0;
+    }
+  }
+  if( strcmp( uxml_get( root, NULL ), "contentR" ) != 0 )
+  {
+    printf( "grow failed at content\n" );
+    uxml_free( root );
+    return 0;
+  }
+  uxml_free( root );
+
+  /* '=' in contents is counted like attribute, too large array of nodes is packed */
+  n = sprintf( xml, "<nodeR>" );
+  for( i = 0; i < 200; i++ )
+  {
+    n += sprintf( xml + n, "<n>a==%d</n>", i );
+  }
+  n += sprintf( xml + n, "</nodeR>" );
+
+  for( k = 0; k < 2; k++ )
+  {
+    if( (root = (k == 0) ? uxml_parse( xml, n, &e ): uxml_parse_ref( xml, n, &e )) == NULL )
+      return print_error( &e );
+    sprintf( name, "a==%d", 199 );
+    if( strcmp( uxml_get( root, "n[199]" ), name ) != 0 || uxml_prev( uxml_last_child( root ) ) != uxml_node( root, "n[198]" ) )
+    {
+      printf( "grow failed at packed nodes\n" );
+      uxml_free( root );
+      return 0;
+    }
+    uxml_free( root );
+  }
+  printf( "grow: %d nodes ok\n", i );
+  return 1;
+}
+
+int test_deep()
+{
+  uxml_node_t *root, *node;
+  char *xml;
+  int i, n, depth = 100000;
+
+  /* deep nesting must not exhaust the call stack */
+  if( (xml = (char *)malloc( depth * 7 + 16 )) == NULL )
+    return 0;
+  for( i = n = 0; i < depth; i++ )
+    n += sprintf( xml + n, "<a>" );
+  n += sprintf( xml + n, "deep" );
+  for( i = 0; i < depth; i++ )
+    n += sprintf( xml + n, "</a>" );
+
+  root = uxml_parse( xml, n, &e );
+  free( xml );
+  if( root == NULL )
+    return print_error( &e );
+  for( i = 1, node = root; uxml_child( node ) != NULL; i++ )
+    node = uxml_child( node );
+  if( i != depth || strcmp( uxml_get( node, NULL ), "deep" ) != 0 )
+  {
+    printf( "deep failed at %d\n", i );
+    uxml_free( root );
+    return 0;
+  }
+  printf( "deep: %d levels ok\n", i );
+  uxml_free( root );
+  return 1;
+}
+
+/* ends of documents and expected errors */
+const char *end_docs[] = { "<a/><!-- x", "<!-- x", "<a/><?pi x='1", "<a/><b/>" };
+const char *end_errors[] = { NULL, "No root node", "Unterminated process instruction", "Multiple root node" };
+
+int check_end( const char *api, size_t i, int ok )
+{
+  if( ok != (end_errors[i] == NULL) || (!ok && strcmp( e.text, end_errors[i] ) != 0) )
+  {
+    printf( "%s: end of \"%s\" failed: %s\n", api, end_docs[i], ok ? "no error": e.text );
+    return 0;
+  }
+  return 1;
+}
+
+int test_end()
+{
+  uxml_node_t *root;
+  size_t i;
+
+  /* unterminated comment after root is ignored, like in baseline parser */
+  for( i = 0; i < sizeof( end_docs ) / sizeof( end_docs[0] ); i++ )
+  {
+    root = uxml_parse( end_docs[i], strlen( end_docs[i] ), &e );
+    if( root != NULL )
+      uxml_free( root );
+    if( !check_end( "parse", i, root != NULL ) )
+      return 0;
+  }
+  printf( "end: ok\n" );
+  return 1;
+}
+
+char events[1024];
+
+int on_start( void *user, const char *name )
+{
+  sprintf( events + strlen( events ), "<%s>", name );
+  return 1;
+}
+
+int on_attr( void *user, const char *name, const char *value, size_t size )
+{
+  sprintf( events + strlen( events ), "%s=\"%s\"(%d)", name, value, (int)size );
+  return 1;
+}
+
+int on_text( void *user, const char *text, size_t size )
+{
+  sprintf( events + strlen( events ), "[%s]", text );
+  return 1;
+}
+
+int on_end( void *user, const char *name )
+{
+  sprintf( events + strlen( events ), "</%s>", name );
+  return strcmp( name, (const char *)user ) != 0; /* stop at specified node */
+}
+
+int on_inst( void *user, const char *name )
+{
+  sprintf( events + strlen( events ), "<?%s>", name );
+  return 1;
+}
+
+int test_reader()
+{
+  const char xml[] = 
+    "<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<nodeR attrR=\"valueR\">  contentR1 <!-- comment -->  contentR2\n"
+    "<nodeA attrA1='a &amp; b' attrA2 = \"\"/>contentR3 &lt;&#32;&gt;"
+    "<nodeB>  contentB  </nodeB></nodeR>\n";
+  const char expected[] = 
+    "<?xml>version=\"1.0\"(3)encoding=\"UTF-8\"(5)"
+    "<nodeR>attrR=\"valueR\"(6)[contentR1 contentR2]"
+    "<nodeA>attrA1=\"a & b\"(5)attrA2=\"\"(0)</nodeA>[contentR3 < >]"
+    "<nodeB>[contentB]</nodeB></nodeR>";
+  uxml_reader_t reader = { NULL, on_start, on_attr, on_text, on_end, on_inst };
+
+  events[0] = 0;
+  reader.user = "";
+  if( !uxml_read( xml, sizeof( xml ), &reader, &e ) )
+    return print_error( &e );
+  if( strcmp( events, expected ) != 0 )
+  {
+    printf( "reader failed:\n%s\n", events );
+    return 0;
+  }
+  printf( "reader: %s\n", events );
+
+  events[0] = 0;
+  reader.user = "nodeA";
+  if( uxml_read( xml, sizeof( xml ), &reader, &e ) || strcmp( e.text, "Stopped by reader" ) != 0 )
+  {
+    printf( "reader is not stopped:\n%s\n", events );
+    return 0;
+  }
+  printf( "reader stopped: %s\n", events );
+  return 1;
+}
+
+int test_push()
+{
+  const char xml[] = 
+    "\xEF\xBB\xBF<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<nodeR attrR=\"value&#x52;\"> contentR1 &amp;&lt;&gt; <!-- comment --> contentR2"
+    "<nodeA attrA='&quot;valueA&apos;'>contentA&#32;&#65;</nodeA></nodeR>\n";
+  char expected[1024];
+  uxml_reader_t reader = { "", on_start, on_attr, on_text, on_end, on_inst };
+  uxml_parser_t *parser;
+  int i, n, part;
+
+  events[0] = 0;
+  if( !uxml_read( xml, sizeof( xml ) - 1, &reader, &e ) )
+    return print_error( &e );
+  strcpy( expected, events );
+
+  for( part = 1; part <= 16; part++ )  /* split data to parts of every size */
+  {
+    if( (parser = uxml_parser_create( &reader )) == NULL )
+      return 0;
+    events[0] = 0;
+    for( i = 0; i < (int)sizeof( xml ) - 1; i += n )
+    {
+      n = (i + part < (int)sizeof( xml ) - 1) ? part: (int)sizeof( xml ) - 1 - i;
+      if( !uxml_parser_feed( parser, xml + i, n, &e ) )
+      {
+        uxml_parser_free( parser );
+        return print_error( &e );
+      }
+    }
+    if( !uxml_parser_finish( parser, &e ) )
+    {
+      uxml_parser_free( parser );
+      return print_error( &e );
+    }
+    uxml_parser_free( parser );
+    if( strcmp( events, expected ) != 0 )
+    {
+      printf( "push failed by parts of %d bytes:\n%s\n", part, events );
+      return 0;
+    }
+  }
+  printf( "push: %s\n", events );
+
+  parser = uxml_parser_create( &reader ); /* unterminated document */
+  n = uxml_parser_feed( parser, xml, 100, &e ) && !uxml_parser_finish( parser, &e );
+  uxml_parser_free( parser );
+  if( !n || strcmp( e.text, "Unterminated node" ) != 0 )
+  {
+    printf( "push failed at unterminated document\n" );
+    return 0;
+  }
+
+  parser = uxml_parser_create( &reader ); /* trailing zero byte is ignored, like in uxml_read */
+  events[0] = 0;
+  n = uxml_parser_feed( parser, xml, sizeof( xml ), &e ) && uxml_parser_feed( parser, "\0\0", 2, &e ) && uxml_parser_finish( parser, &e );
+  uxml_parser_free( parser );
+  if( !n || strcmp( events, expected ) != 0 )
+  {
+    printf( "push failed at trailing zero bytes\n" );
+    return 0;
+  }
+  parser = uxml_parser_create( &reader ); /* zero bytes, which are followed by data, are not ignored */
+  n = uxml_parser_feed( parser, "<a>t</a>\0", 9, &e ) && uxml_parser_feed( parser, "x", 1, &e ) && uxml_parser_finish( parser, &e );
+  uxml_parser_free( parser );
+  i = e.column;
+  if( n || uxml_read( "<a>t</a>\0x", 10, &reader, &e ) || e.column != i )
+  {
+    printf( "push failed at zero byte inside data\n" );
+    return 0;
+  }
+  return 1;
+}
+
+int on_extract( void *user, size_t path, const char *value, size_t size )
+{
+  sprintf( events + strlen( events ), "%d:%s(%d)", (int)path, value, (int)size );
+  return strcmp( value, (const char *)user ) != 0; /* stop at specified value */
+}
+
+int on_compare( void *user, size_t path, const char *value, size_t size )
+{
+  uxml_node_t *n = uxml_iter_next( (uxml_iter_t *)user + path ); /* the same values are found in the tree */
+
+  return n != NULL && strcmp( uxml_get( n, NULL ), value ) == 0 && strlen( value ) == size;
+}
+
+int test_read_end()
+{
+  uxml_reader_t reader;
+  uxml_parser_t *parser;
+  const char *paths[] = { "/a" };
+  size_t i;
+  int ok;
+
+  /* reader, push parser and extraction check end of document like parser */
+  memset( &reader, 0, sizeof( reader ) );
+  for( i = 0; i < sizeof( end_docs ) / sizeof( end_docs[0] ); i++ )
+  {
+    if( !check_end( "read", i, uxml_read( end_docs[i], strlen( end_docs[i] ), &reader, &e ) ) )
+      return 0;
+    parser = uxml_parser_create( &reader );
+    ok = uxml_parser_feed( parser, end_docs[i], strlen( end_docs[i] ), &e ) && uxml_parser_finish( parser, &e );
+    uxml_parser_free( parser );
+    if( !check_end( "push", i, ok ) )
+      return 0;
+    events[0] = 0;
+    if( !check_end( "extract", i, uxml_extract( end_docs[i], strlen( end_docs[i] ), paths, 1, on_extract, "none", &e ) ) )
+      return 0;
+  }
+  printf( "read end: ok\n" );
+  return 1;
+}
+
+int test_extract()
+{
+  const char xml[] = 
+    "<?xml version='1.0'?>\n"
+    "<export date='today'>\n"
+    "  <customer id='1'><name>A &amp; B</name><balance>10.5</balance></customer>\n"
+    "  <customer id='2'><name>C</name><note>x<b>bold</b> y </note><balance>-3</balance></customer>\n"
+    "  <vendor id='3'><name>D</name></vendor>\n"
+    "</export>\n";
+  const char *paths[] = { "/export/customer/id", "/export/customer/balance", "/export/*/name", "export/customer/note", 
+    "/export/customer/note/b", "/export/date", "/vendor/name", "/export/customer/none" };
+  const char *tree_paths[] = { "customer/id", "customer/balance", "*/name", "customer/note", "customer/note/b", "date" };
+  uxml_iter_t it[6];
+  uxml_node_t *root;
+  char *doc;
+  int i, n, size = 200000;
+
+  events[0] = 0;
+  if( !uxml_extract( xml, sizeof( xml ), paths, sizeof( paths ) / sizeof( paths[0] ), on_extract, "", &e ) )
+    return print_error( &e );
+  printf( "extract: %s\n", events );
+  events[0] = 0;
+  if( uxml_extract( xml, sizeof( xml ), paths, sizeof( paths ) / sizeof( paths[0] ), on_extract, "C", &e ) ||
+      strcmp( e.text, "Stopped by reader" ) != 0 )
+  {
+    printf( "extract failed at stop\n" );
+    return 0;
+  }
+  printf( "extract: stopped after %s\n", events );
+
+  /* long contents, mixed contents, escapes: the same values as in the tree */
+  if( (doc = (char *)malloc( size + 8192 )) == NULL )
+    return 0;
+  n = sprintf( doc, "<export date='%d'>", size );
+  for( i = 0; n < size; i++ )
+  {
+    n += sprintf( doc + n, "<customer id='%d &lt;%d&gt;'><name>name %d</name>", i, i % 7, i );
+    if( i % 50 == 0 )
+    {
+      n += sprintf( doc + n, "<note> head <b>%d</b> tail ", i );
+      memset( doc + n, 'a' + i % 26, 6000 );
+      n += 6000;
+      n += sprintf( doc + n, " &amp;</note>" );
+    }
+    n += sprintf( doc + n, "<balance>%d.%02d</balance></customer>%s", i * 3, i % 100, (i % 9 == 0) ? "<vendor><name>v</name></vendor>": "" );
+  }
+  n += sprintf( doc + n, "</export>" );
+  if( (root = uxml_parse( doc, n, &e )) == NULL )
+  {
+    free( doc );
+    return print_error( &e );
+  }
+  for( i = 0; i < 6; i++ )
+  {
+    it[i] = uxml_find( root, tree_paths[i] );
+  }
+  if( !uxml_extract( doc, n, paths, 6, on_compare, it, &e ) )
+  {
+    printf( "extract failed: %s\n", e.text );
+    free( doc );
+    uxml_free( root );
+    return 0;
+  }
+  for( i = 0; i < 6; i++ )
+  {
+    if( uxml_iter_next( it + i ) != NULL )
+    {
+      printf( "extract failed: %s is not extracted\n", paths[i] );
+      free( doc );
+      uxml_free( root );
+      return 0;
+    }
+  }
+  free( doc );
+  uxml_free( root );
+  return 1;
+}
+
+int same_links( uxml_node_t *node )
+{
+  uxml_node_t *n, *prev = NULL;
+
+  for( n = uxml_child( node ); n != NULL; prev = n, n = uxml_next( n ) )
+  {
+    if( uxml_prev( n ) != prev )
+      return 0;
+  }
+  return uxml_last_child( node ) == prev;
+}
+
+int same_tree( uxml_node_t *a, uxml_node_t *b )
+{
+  for( ; a != NULL && b != NULL; a = uxml_next( a ), b = uxml_next( b ) )
+  {
+    if( strcmp( uxml_name( a ), uxml_name( b ) ) != 0 ||
+        strcmp( uxml_get( a, NULL ), uxml_get( b, NULL ) ) != 0 ||
+        uxml_size( a, NULL ) != uxml_size( b, NULL ) || !same_links( a ) || !same_links( b ) ||
+        !same_tree( uxml_child( a ), uxml_child( b ) ) )
+      return 0;
+  }
+  return a == b;
+}
+
+int same_select( uxml_node_t *a, uxml_node_t *b, const char *text )
+{
+  uxml_query_t *query = uxml_query_compile( text, &e );
+  uxml_node_t **x = uxml_select( a, query, NULL ), **y = uxml_select( b, query, NULL );
+  size_t i;
+  int ok = (x != NULL && y != NULL);
+
+  for( i = 0; ok && (x[i] != NULL || y[i] != NULL); i++ )
+  {
+    ok = (x[i] != NULL && y[i] != NULL && strcmp( uxml_get( x[i], NULL ), uxml_get( y[i], NULL ) ) == 0);
+  }
+  free( x );
+  free( y );
+  uxml_query_free( query );
+  return ok && i != 0;
+}
+
+int count_ref( uxml_node_t *a, uxml_node_t *b, const char *xml, int n )
+{
+  const char *s, *r;
+  size_t len, size;
+  int k = 0, c;
+
+  for( ; a != NULL && b != NULL; a = uxml_next( a ), b = uxml_next( b ) )
+  {
+    s = uxml_name_ref( a, &len );
+    r = uxml_get_ref( a, NULL, &size );
+    if( len != strlen( uxml_name( b ) ) || memcmp( s, uxml_name( b ), len ) != 0 ||
+        size != uxml_size( b, NULL ) || memcmp( r, uxml_get( b, NULL ), size ) != 0 )
+      return -1;
+    if( s >= xml && s < xml + n )    /* names are interned, they never refer to XML data */
+      return -1;
+    k += (r >= xml && r < xml + n);
+    if( (c = count_ref( uxml_child( a ), uxml_child( b ), xml, n )) < 0 )
+      return -1;
+    k += c;
+  }
+  return k;
+}
+
+int test_ref()
+{
+  uxml_node_t *root, *root_ref;
+  const char xml[] = 
+    "<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<nodeR attrR=\"valueR\" attrE=\"&lt;&gt;\">\n"
+    "  <nodeA attrA=''>  contentA  </nodeA>\n"
+    "  <nodeB>contentB1\n contentB2</nodeB>\n"
+    "  <nodeC>contentC1 contentC2 &amp; contentC3</nodeC>\n"
+    "  <nodeD>contentD1 <!-- c --> contentD2</nodeD>\n"
+    "  contentR\n"
+    "</nodeR>\n";
+  int k;
+
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  root_ref = uxml_parse_ref( xml, sizeof( xml ), &e );
+  if( root == NULL || root_ref == NULL )
+  {
+    uxml_free( root );
+    uxml_free( root_ref );
+    return print_error( &e );
+  }
+  k = count_ref( root_ref, root, xml, sizeof( xml ) );
+  if( k < 0 || !same_tree( root, root_ref ) || count_ref( root_ref, root, xml, sizeof( xml ) ) != 0 ||
+      uxml_get_initial_allocated( root_ref ) >= uxml_get_initial_allocated( root ) )
+  {
+    printf( "ref failed\n" );
+    uxml_free( root );
+    uxml_free( root_ref );
+    return 0;
+  }
+  printf( "ref: %d contents refer to XML data\n", k );
+  uxml_free( root );
+  uxml_free( root_ref );
+  return 1;
+}
+
+int test_insitu()
+{
+  uxml_node_t *root, *root_insitu;
+  const char xml[] = 
+    "\xEF\xBB\xBF<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<nodeR attrR=\"valueR\" attrE=\"&lt;&gt;\">\n"
+    "  contentR1 <nodeA attrA=''>  contentA  </nodeA>\n"
+    "  <nodeB>contentB1\n contentB2 <nodeC>contentC</nodeC>contentB3<nodeC/> &amp; contentB4</nodeB>\n"
+    "  contentR2 <!-- c --> contentR3\n"
+    "</nodeR>\n";
+  char buf[ sizeof( xml ) ];
+
+  memcpy( buf, xml, sizeof( xml ) );
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  root_insitu = uxml_parse_insitu( buf, sizeof( buf ), &e );
+  if( root == NULL || root_insitu == NULL )
+  {
+    uxml_free( root );
+    uxml_free( root_insitu );
+    return print_error( &e );
+  }
+  if( !same_tree( root, root_insitu ) || 
+      uxml_get( root_insitu, "nodeA" ) < buf || uxml_get( root_insitu, "nodeA" ) >= buf + sizeof( buf ) ||
+      uxml_name( root_insitu ) < buf || uxml_name( root_insitu ) >= buf + sizeof( buf ) )
+  {
+    printf( "insitu failed\n" );
+    uxml_free( root );
+    uxml_free( root_insitu );
+    return 0;
+  }
+  printf( "insitu: root content=\"%s\", nodeB content=\"%s\"\n", uxml_get( root_insitu, NULL ), uxml_get( root_insitu, "nodeB" ) );
+  uxml_free( root );
+  uxml_free( root_insitu );
+  return 1;
+}
+
+int test_names()
+{
+  uxml_node_t *root;
+  const char xml[] = 
+    "<nodeR>\n"
+    "  <nodeA attrA='1'/>\n"
+    "  <nodeA attrA='2'><nodeB/></nodeA>\n"
+    "  <nodeB attrA='3'/>\n"
+    "</nodeR>\n";
+  int i;
+
+  for( i = 0; i < 2; i++ )
+  {
+    root = (i == 0) ? uxml_parse( xml, sizeof( xml ), &e ): uxml_parse_ref( xml, sizeof( xml ), &e );
+    if( root == NULL )
+      return print_error( &e );
+    if( uxml_name( uxml_node( root, "nodeA[0]" ) ) != uxml_name( uxml_node( root, "nodeA[1]" ) ) ||
+        uxml_name( uxml_node( root, "nodeA/attrA" ) ) != uxml_name( uxml_node( root, "nodeB/attrA" ) ) ||
+        uxml_name( uxml_node( root, "nodeA[1]/nodeB" ) ) != uxml_name( uxml_node( root, "nodeB" ) ) ||
+        uxml_int( root, "nodeB/attrA" ) != 3 || uxml_int( root, "nodeA[1]/attrA" ) != 2 ||
+        uxml_node( root, "nodeC" ) != NULL || uxml_node( root, "node" ) != NULL )
+    {
+      printf( "names failed\n" );
+      uxml_free( root );
+      return 0;
+    }
+    uxml_free( root );
+  }
+  printf( "names: repeated names are interned\n" );
+  return 1;
+}
+
+int test_index()
+{
+  uxml_node_t *root, *n, *k;
+  char *xml, path[64];
+  const char *names[3] = { "nodeA", "nodeB", "attrA" };
+  int i, j, c, count, size = 100000;
+
+  /* wide node: many children with a few names, attribute has the same name as nodes */
+  if( (xml = (char *)malloc( size + 256 )) == NULL )
+    return 0;
+  c = sprintf( xml, "<nodeR attrA='valueR' attrB='valueB'>" );
+  for( i = 0; c < size; i++ )
+  {
+    c += sprintf( xml + c, "<%s>%d</%s>", names[ i % 3 ], i, names[ i % 3 ] );
+  }
+  c += sprintf( xml + c, "</nodeR>" );
+  count = i;
+  root = uxml_parse( xml, c, &e );
+  free( xml );
+  if( root == NULL )
+    return print_error( &e );
+  for( j = 0; j < 3; j++ )
+  {
+    for( i = 0, k = uxml_child( root ); k != NULL; k = uxml_next( k ) )
+    {
+      if( strcmp( uxml_name( k ), names[j] ) != 0 || uxml_node( root, "attrA" ) == k )
+        continue;
+      sprintf( path, "%s[%d]", names[j], i++ );
+      if( (n = uxml_node( root, path )) != k )
+      {
+        printf( "index failed at %s\n", path );
+        uxml_free( root );
+        return 0;
+      }
+    }
+    sprintf( path, "%s[%d]", names[j], i );
+    if( uxml_node( root, path ) != NULL )
+    {
+      printf( "index failed at %s\n", path );
+      uxml_free( root );
+      return 0;
+    }
+  }
+  if( strcmp( uxml_get( root, "attrA" ), "valueR" ) != 0 || strcmp( uxml_get( root, "attrB" ), "valueB" ) != 0 ||
+      strcmp( uxml_get( root, "nodeB" ), "1" ) != 0 || uxml_node( root, "nodeC" ) != NULL )
+  {
+    printf( "index failed\n" );
+    uxml_free( root );
+    return 0;
+  }
+  printf( "index: %d children, nodeB[1000]=%s\n", count, uxml_get( root, "nodeB[1000]" ) );
+  uxml_free( root );
+  return 1;
+}
+
+int test_path()
+{
+  uxml_node_t *root, *n;
+  uxml_path_t *path;
+  const char xml[] = 
+    "<nodeR attrR='valueR'>\n"
+    "  <nodeA attrA='1'><nodeC>contentC0</nodeC></nodeA>\n"
+    "  <nodeA attrA='2'><nodeC>contentC1</nodeC><nodeC>contentC2</nodeC></nodeA>\n"
+    "  <nodeB>3.5</nodeB>\n"
+    "</nodeR>\n";
+  const char *paths[] = { "", "/", "attrR", "nodeA", "nodeA[1]/attrA", "/nodeA[1]/nodeC[1]", "nodeA[1]/*[1]",
+    "*", "*[2]", "nodeA/nodeC/..", "nodeA//nodeC/", "nodeA/nodeC/../../nodeB", "nodeA[2]", "nodeD", ".." };
+  const char *errors[] = { "*a", "nodeA[", "nodeA[1", "nodeA[]", "nodeA[1x]", "nodeA[1]x", "..[1]", "[1]", "node]" };
+  int i;
+
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  if( root == NULL )
+    return print_error( &e );
+  for( i = 0; i < (int)(sizeof( paths ) / sizeof( paths[0] )); i++ )
+  {
+    path = uxml_path_compile( paths[i], &e );
+    n = uxml_node( root, "nodeA[1]" );
+    if( path == NULL || uxml_node_p( root, path ) != uxml_node( root, paths[i] ) ||
+        uxml_node_p( n, path ) != uxml_node( n, paths[i] ) )
+    {
+      printf( "path failed at \"%s\"\n", paths[i] );
+      uxml_path_free( path );
+      uxml_free( root );
+      return 0;
+    }
+    uxml_path_free( path );
+  }
+  path = uxml_path_compile( "/nodeA[1]/nodeC[1]", &e );
+  printf( "path: \"%s\"", uxml_get_p( root, path ) );
+  uxml_path_free( path );
+  path = uxml_path_compile( "nodeB", &e );
+  printf( ", %d", uxml_int_p( root, path ) );
+#if !defined( UXML_DISABLE_DOUBLE )
+  printf( ", %g", uxml_double_p( root, path ) );
+#endif
+  printf( ", errors:" );
+  uxml_path_free( path );
+  for( i = 0; i < (int)(sizeof( errors ) / sizeof( errors[0] )); i++ )
+  {
+    if( (path = uxml_path_compile( errors[i], &e )) != NULL )
+    {
+      printf( "\npath failed at \"%s\"\n", errors[i] );
+      uxml_path_free( path );
+      uxml_free( root );
+      return 0;
+    }
+    printf( " %s(%d)", e.text, e.column );
+  }
+  printf( "\n" );
+  uxml_free( root );
+  return 1;
+}
+
+int test_numbers()
+{
+  uxml_node_t *root;
+  const char xml[] = 
+    "<nodeR zero='0' neg=' -12 ' hex='0x7fffFFFFffffFFFF' big='18446744073709551615' over='18446744073709551616'"
+    " min='-9223372036854775808' t='true' f='0' bad='12a' empty=''>\n"
+    "  <real>-2.5e-3</real><inf>-INF</inf><nan>NaN</nan><tiny>1e-320</tiny><huge>1e309</huge>\n"
+    "  <long>0.1000000000000000055511151231257827021181583404541015625000000000000000001</long>\n"
+    "</nodeR>\n";
+  const char *names[] = { "zero", "neg", "hex", "big", "over", "min", "t", "f", "bad", "empty", "none" };
+  long long i64;
+  unsigned long long u64;
+  int i, k, b, status[4];
+#if !defined( UXML_DISABLE_DOUBLE )
+  const char *reals[] = { "real", "inf", "nan", "tiny", "huge", "long" };
+  char buffer[ 256 ], number[ 128 ];
+  double d, r;
+#endif
+
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  if( root == NULL )
+    return print_error( &e );
+  printf( "numbers:" );
+  for( i = 0; i < (int)(sizeof( names ) / sizeof( names[0] )); i++ )
+  {
+    status[0] = uxml_int64_e( root, names[i], &i64 );
+    status[1] = uxml_uint64_e( root, names[i], &u64 );
+    status[2] = uxml_bool_e( root, names[i], &b );
+#if !defined( UXML_DISABLE_DOUBLE )
+    status[3] = uxml_double_e( root, names[i], &d );
+    printf( " %s=%lld/%llu/%d/%g(%d%d%d%d)", names[i], i64, u64, b, d, status[0], status[1], status[2], status[3] );
+#else
+    printf( " %s=%lld/%llu/%d(%d%d%d)", names[i], i64, u64, b, status[0], status[1], status[2] );
+#endif
+  }
+#if !defined( UXML_DISABLE_DOUBLE )
+  printf( "\nreals:" );
+  for( i = 0; i < (int)(sizeof( reals ) / sizeof( reals[0] )); i++ )
+  {
+    status[0] = uxml_double_e( root, reals[i], &d );
+    printf( " %s=%.17g(%d)", reals[i], d, status[0] );
+  }
+#endif
+  printf( "\n" );
+  k = uxml_cache_values( root, 1 ) && uxml_int64( root, "neg" ) == -12 && uxml_int64( root, "neg" ) == -12 &&
+      uxml_uint64( root, "neg" ) == 0 && uxml_bool( root, "t" ) && uxml_int64( root, "bad" ) == 0;
+#if !defined( UXML_DISABLE_DOUBLE )
+  k = k && uxml_double( root, "neg" ) == -12.0 && uxml_double( root, "bad" ) == 12.0 && uxml_double( root, "bad" ) == 12.0 &&
+      uxml_double_e( root, "bad", &d ) == UXML_INVALID && d == 0.0;
+#endif
+  if( !k || !uxml_cache_values( root, 0 ) )
+  {
+    printf( "value cache failed\n" );
+    uxml_free( root );
+    return 0;
+  }
+  uxml_free( root );
+#if !defined( UXML_DISABLE_DOUBLE )
+  /* numbers, which are followed by text, are kept by uxml_double only; underflow and overflow are out of range */
+  sprintf( buffer, "<n><w>3.5 kg</w><e>2e kg</e><u>1e-400</u><o>-1e400</o><z>0e-400</z></n>" );
+  if( (root = uxml_parse( buffer, strlen( buffer ), &e )) == NULL )
+    return print_error( &e );
+  k = uxml_double( root, "w" ) == 3.5 && uxml_double_e( root, "w", &d ) == UXML_INVALID && d == 0.0 &&
+      uxml_double( root, "e" ) == 2.0 && uxml_double_e( root, "u", &d ) == UXML_RANGE && d == 0.0 &&
+      uxml_double_e( root, "o", &d ) == UXML_RANGE && d == -HUGE_VAL && uxml_double_e( root, "z", &d ) == UXML_OK && d == 0.0;
+  uxml_free( root );
+  if( !k )
+  {
+    printf( "uxml_double failed with trailing text or out of range\n" );
+    return 0;
+  }
+  srand( 1 );
+  for( i = 0; i < 100000; i++ )                 /* conversion is the same as strtod in "C" locale */
+  {
+    k = 0;
+    if( rand() % 2 )
+      number[ k++ ] = '-';
+    for( b = rand() % ((i % 10 == 0) ? 40: 20) + 1; b-- > 0; )
+      number[ k++ ] = (char)('0' + rand() % 10);
+    if( rand() % 2 )
+    {
+      number[ k++ ] = '.';
+      for( b = rand() % 20; b-- > 0; )
+        number[ k++ ] = (char)('0' + rand() % 10);
+    }
+    if( rand() % 2 )
+      k += sprintf( number + k, "e%d", rand() % 700 - 350 );
+    number[ k ] = 0;
+    sprintf( buffer, "<n>%s</n>", number );
+    if( (root = uxml_parse( buffer, strlen( buffer ), &e )) == NULL )
+      return print_error( &e );
+    d = uxml_double( root, "" );
+    r = strtod( number, NULL );
+    if( memcmp( &d, &r, sizeof( d ) ) != 0 )
+    {
+      printf( "uxml_double failed at \"%s\": %.17g\n", number, d );
+      uxml_free( root );
+      return 0;
+    }
+    uxml_free( root );
+  }
+#endif
+  return 1;
+}
+
+typedef struct _item_t
+{
+  const char *name;
+  int id;
+  long long stock;
+  double price;
+  int sale;
+  uxml_node_t *node;
+  const char *first;
+} item_t;
+
+int test_bind()
+{
+  uxml_node_t *root;
+  item_t *items;
+  size_t count, i;
+  char path[64];
+  int ok;
+  const char xml[] = 
+    "<shop>\n"
+    "  <items>\n"
+    "    <item id='1' sale='true'><name>apple</name><price>1.25</price><stock>10</stock><tag>a</tag></item>\n"
+    "    <item id='2'><name>pear</name><price><value>2.5</value></price><stock>-3</stock></item>\n"
+    "    <item id='x' sale='0'><stock>99999999999</stock><name>plum</name><name>fig</name></item>\n"
+    "  </items>\n"
+    "  <items><item id='4'><tag>b</tag><tag>c</tag></item></items>\n"
+    "</shop>\n";
+  static const uxml_field_t fields[] = {
+    { "name", UXML_FIELD_STRING, offsetof( item_t, name ) },
+    { "id", UXML_FIELD_INT, offsetof( item_t, id ) },
+    { "stock", UXML_FIELD_INT64, offsetof( item_t, stock ) },
+#if !defined( UXML_DISABLE_DOUBLE )
+    { "price", UXML_FIELD_DOUBLE, offsetof( item_t, price ) },
+#endif
+    { "sale", UXML_FIELD_BOOL, offsetof( item_t, sale ) },
+    { "", UXML_FIELD_NODE, offsetof( item_t, node ) },
+    { "tag[1]", UXML_FIELD_STRING, offsetof( item_t, first ) } };
+  static const uxml_field_t invalid[] = { { "name[", UXML_FIELD_STRING, 0 } };
+
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  if( root == NULL )
+    return print_error( &e );
+  if( (items = (item_t *)uxml_bind( root, "items/item", fields, sizeof( fields ) / sizeof( fields[0] ),
+                                    sizeof( item_t ), &count, &e )) == NULL )
+  {
+    uxml_free( root );
+    return print_error( &e );
+  }
+  printf( "bind:" );
+  for( i = 0; i < count; i++ )  /* the same values as by separate calls */
+  {
+    sprintf( path, "items[%d]/item[%d]", (i < 3) ? 0: 1, (i < 3) ? (int)i: 0 );
+    ok = items[i].node == uxml_node( root, path ) && items[i].name == uxml_get( items[i].node, "name" ) &&
+         items[i].stock == uxml_int64( items[i].node, "stock" ) && items[i].sale == uxml_bool( items[i].node, "sale" ) &&
+         items[i].first == uxml_get( items[i].node, "tag[1]" );
+#if !defined( UXML_DISABLE_DOUBLE )
+    ok = ok && items[i].price == uxml_double( items[i].node, "price" );
+#endif
+    if( !ok )
+    {
+      printf( "\nbind failed at record %d\n", (int)i );
+      free( items );
+      uxml_free( root );
+      return 0;
+    }
+    printf( " %s/%d/%lld/%g/%d/%s", items[i].name ? items[i].name: "-", items[i].id, items[i].stock,
+            items[i].price, items[i].sale, items[i].first ? items[i].first: "-" );
+  }
+  free( items );
+  items = (item_t *)uxml_bind( root, "nodeC", fields, 1, sizeof( item_t ), &count, &e );
+  printf( ", %d records of nodeC", (int)count );
+  free( items );
+  items = (item_t *)uxml_bind( root, "items/item", invalid, 1, sizeof( item_t ), &count, &e );
+  printf( ", error: %s(%d)\n", items == NULL ? e.text: "none", e.column );
+  free( items );
+  uxml_free( root );
+  return 1;
+}
+
+int test_iter()
+{
+  uxml_node_t *root, *n;
+  uxml_iter_t it;
+  const char xml[] = 
+    "<nodeR attrR='valueR'>\n"
+    "  <records><record>1</record><record>2</record><other/></records>\n"
+    "  <records/>\n"
+    "  <records><record>3</record></records>\n"
+    "  <nodeB attrB='4'><record>5</record></nodeB>\n"
+    "</nodeR>\n";
+  const char *paths[] = { "records/record", "*/record", "records/*", "*", "records[2]/record", 
+    "records/record/..", "/records/record[0]", "", "nodeC", "nodeB/attrB", "*[1]/*", "record[", "records/nodeC" };
+  char path[64];
+  int i, j;
+
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  if( root == NULL )
+    return print_error( &e );
+  /* iterator yields the same nodes as index-based loop */
+  it = uxml_find( root, "records/record" );
+  for( i = 0; ; i++ )
+  {
+    sprintf( path, "records[%d]", i );
+    if( (n = uxml_node( root, path )) == NULL )
+      break;
+    for( j = 0; ; j++ )
+    {
+      sprintf( path, "records[%d]/record[%d]", i, j );
+      if( (n = uxml_node( root, path )) == NULL )
+        break;
+      if( uxml_iter_next( &it ) != n )
+      {
+        printf( "iter failed at %s\n", path );
+        uxml_free( root );
+        return 0;
+      }
+    }
+  }
+  if( uxml_iter_next( &it ) != NULL || uxml_iter_next( &it ) != NULL )
+  {
+    printf( "iter failed at end\n" );
+    uxml_free( root );
+    return 0;
+  }
+  printf( "iter:" );
+  for( i = 0; i < (int)(sizeof( paths ) / sizeof( paths[0] )); i++ )
+  {
+    printf( " \"%s\"(%d:", paths[i], (int)uxml_count( root, paths[i] ) );
+    for( it = uxml_find( root, paths[i] ); (n = uxml_iter_next( &it )) != NULL; )
+    {
+      printf( " %s=%s", uxml_name( n ), uxml_get( n, "" ) );
+    }
+    printf( ")" );
+  }
+  printf( "\n" );
+  uxml_free( root );
+  return 1;
+}
+
+int test_query()
+{
+  uxml_node_t *root, **nodes;
+  uxml_query_t *query;
+  const char xml[] = 
+    "<shop>\n"
+    "  <order id='1' status='open'><item>apple</item><item>pear</item></order>\n"
+    "  <order id='2' status='closed'><item>plum</item></order>\n"
+    "  <archive>\n"
+    "    <order id='3' status='open'><item>fig</item><note><order id='4' status='open'/></note></order>\n"
+    "  </archive>\n"
+    "  <id>7</id>\n"
+    "</shop>\n";
+  const char *queries[] = { "//order[@status='open']", "//order/item[last()]", "//item[0]", "//order[@id='3']//order",
+    "/order[1]/@id", "//@id", "//order[item='plum']", "//item/..", "//order[@status='open'][1]", "order[@id][item]",
+    "archive//*", "archive//@status", ".", "/", "id", "//order[@status='none']", "//nodeC" };
+  const char *errors[] = { "order[", "order[x", "order[@id=1]", "order[@id='1", "//", "order/", "*x", "order]x", 
+    "//..", "order[@]", "order[]" };
+  size_t i, k, count;
+
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  if( root == NULL )
+    return print_error( &e );
+  printf( "query:" );
+  for( i = 0; i < sizeof( queries ) / sizeof( queries[0] ); i++ )
+  {
+    if( (query = uxml_query_compile( queries[i], &e )) == NULL || (nodes = uxml_select( root, query, &count )) == NULL )
+    {
+      printf( "\nquery failed at \"%s\"\n", queries[i] );
+      uxml_query_free( query );
+      uxml_free( root );
+      return 0;
+    }
+    printf( " \"%s\"(%d:", queries[i], (int)count );
+    for( k = 0; nodes[k] != NULL; k++ )
+    {
+      if( uxml_node( nodes[k], "id" ) != NULL && uxml_child( uxml_node( nodes[k], "id" ) ) == NULL )
+        printf( " %s#%s", uxml_name( nodes[k] ), uxml_get( nodes[k], "id" ) );
+      else
+        printf( " %s=%s", uxml_name( nodes[k] ), uxml_get( nodes[k], NULL ) );
+    }
+    printf( ")" );
+    free( nodes );
+    uxml_query_free( query );
+  }
+  printf( "\nquery errors:" );
+  for( i = 0; i < sizeof( errors ) / sizeof( errors[0] ); i++ )
+  {
+    if( (query = uxml_query_compile( errors[i], &e )) != NULL )
+    {
+      printf( "\nquery failed at \"%s\"\n", errors[i] );
+      uxml_query_free( query );
+      uxml_free( root );
+      return 0;
+    }
+    printf( " %s(%d)", e.text, e.column );
+  }
+  printf( "\n" );
+  uxml_free( root );
+  return 1;
+}
+
+#if !defined( UXML_DISABLE_THREADS )
+int test_parallel()
+{
+  uxml_node_t *root, *root_mt;
+  char *xml;
+  int i, n, size = 1000000;
+
+  /* long list of nodes under root, content of root between them */
+  if( (xml = (char *)malloc( size + 256 )) == NULL )
+    return 0;
+  n = sprintf( xml, "<?xml version='1.0'?>\n<nodeR attrR='valueR'> contentR" );
+  for( i = 0; n < size; i++ )
+  {
+    n += sprintf( xml + n, "\n  <nodeA attrA='%d'>\n    <nodeB>content &amp; %d</nodeB>%s\n  </nodeA>%s",
+      i, i, (i % 7 == 0) ? "<nodeA/>": "", (i % 1000 == 0) ? " contentR" : "" );
+  }
+  n += sprintf( xml + n, "\n</nodeR>\n" );
+
+  root = uxml_parse( xml, n, &e );
+  root_mt = uxml_parse_parallel( xml, n, 4, &e );
+  free( xml );
+  if( root == NULL || root_mt == NULL )
+  {
+    uxml_free( root );
+    uxml_free( root_mt );
+    return print_error( &e );
+  }
+  if( !same_tree( root, root_mt ) || uxml_int( root_mt, "nodeA[1000]/attrA" ) != 1000 || 
+      !same_select( root, root_mt, "//nodeB" ) || !same_select( root, root_mt, "//nodeA[@attrA='5000']/nodeB" ) )
+  {
+    printf( "parallel failed\n" );
+    uxml_free( root );
+    uxml_free( root_mt );
+    return 0;
+  }
+  printf( "parallel: %d nodes ok, root content size %d\n", i, (int)uxml_size( root_mt, NULL ) );
+  uxml_free( root );
+  uxml_free( root_mt );
+  return 1;
+}
+#endif
+
+int test_write()
+{
+  uxml_node_t *root, *copy;
+  char buffer[512], small[16];
+  size_t n, i;
+  const char xml[] = 
+    "<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<nodeR attrR='a &lt; b &amp; \"c\"'>\n"
+    "  text <nodeA/> more &gt; text\n"
+    "  <nodeB attrB='&#9;x&#10;'> &#32;b&#32;&#32; c&#32;</nodeB>\n"
+    "  <nodeC><nodeD>d</nodeD><nodeD/></nodeC>\n"
+    "</nodeR>\n";
+  const char *paths[] = { "attrR", "", "nodeB/attrB", "nodeB", "nodeC/nodeD", "nodeA" };
+
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  if( root == NULL )
+    return print_error( &e );
+  n = uxml_write( root, buffer, sizeof( buffer ), UXML_WRITE_COMPACT );
+  printf( "write: %s\n", buffer );
+  if( uxml_write( root, small, sizeof( small ), UXML_WRITE_COMPACT ) != n || strlen( small ) != sizeof( small ) - 1 ||
+      uxml_write( root, NULL, 0, UXML_WRITE_INDENT ) <= n )
+  {
+    printf( "write truncation failed\n" );
+    uxml_free( root );
+    return 0;
+  }
+  /* parsing of output gives the same contents */
+  if( (copy = uxml_parse( buffer, n, &e )) == NULL )
+  {
+    uxml_free( root );
+    return print_error( &e );
+  }
+  for( i = 0; i < sizeof( paths ) / sizeof( paths[0] ); i++ )
+  {
+    if( strcmp( uxml_get( root, paths[i] ), uxml_get( copy, paths[i] ) ) != 0 )
+    {
+      printf( "write failed at \"%s\": \"%s\"\n", paths[i], uxml_get( copy, paths[i] ) );
+      uxml_free( copy );
+      uxml_free( root );
+      return 0;
+    }
+  }
+  uxml_free( copy );
+  uxml_free( root );
+  srand( 1 );
+  for( i = 0; i < 10000; i++ )         /* random text with escaped spaces and special characters */
+  {
+    char text[64], *t = text;
+    size_t k, m = (size_t)(rand() % 8);
+
+    for( k = 0; k < m; k++ )
+    {
+      int c = " \t\nab<>&\""[ rand() % 9 ];
+      t += sprintf( t, (rand() % 2 || strchr( "<>&\"", c ) != NULL) ? "&#%d;": "%c", c );
+    }
+    sprintf( buffer, "<n a=\"%s\">%s</n>", text, text );
+    if( (root = uxml_parse( buffer, strlen( buffer ), &e )) == NULL )
+      return print_error( &e );
+    n = uxml_write( root, buffer, sizeof( buffer ), UXML_WRITE_INDENT );
+    if( (copy = uxml_parse( buffer, n, &e )) == NULL || strcmp( uxml_get( root, "" ), uxml_get( copy, "" ) ) != 0 ||
+        strcmp( uxml_get( root, "a" ), uxml_get( copy, "a" ) ) != 0 )
+    {
+      printf( "write failed at \"%s\"\n", text );
+      uxml_free( copy );
+      uxml_free( root );
+      return 0;
+    }
+    uxml_free( copy );
+    uxml_free( root );
+  }
+  root = uxml_parse( xml, sizeof( xml ), &e );
+  fflush( stdout );
+  if( !uxml_write_fd( uxml_node( root, "nodeC" ), fileno( stdout ), UXML_WRITE_INDENT ) )
+  {
+    printf( "uxml_write_fd failed\n" );
+    uxml_free( root );
+    return 0;
+  }
+  uxml_free( root );
+  return 1;
+}
+
+typedef struct _output_t
+{
+  char *data;
+  size_t size;
+  int parts;
+} output_t;
+
+int on_flush( void *user, const char *data, size_t size )
+{
+  output_t *o = (output_t *)user;
+  char *c;
+
+  if( (c = (char *)realloc( o->data, o->size + size + 1 )) == NULL )
+    return 0;
+  o->data = c;
+  memcpy( o->data + o->size, data, size );
+  o->size += size;
+  o->data[ o->size ] = 0;
+  o->parts++;
+  return 1;
+}
+
+int test_writer()
+{
+  uxml_writer_t *w;
+  uxml_node_t *root;
+  output_t o = { NULL, 0, 0 };
+  char name[32], data[256], b[512];
+  int i;
+
+  for( i = 0; i < (int)sizeof( data ); i++ )
+    data[i] = (char)i;
+  /* large output is passed by parts, it is parsed back */
+  w = uxml_writer_create( on_flush, &o, UXML_WRITE_INDENT );
+  uxml_writer_start_element( w, "items" );
+  for( i = 0; i < 10000; i++ )
+  {
+    sprintf( name, "%d", i );
+    uxml_writer_start_element( w, "item" );
+    uxml_writer_attribute( w, "id", name );
+    uxml_writer_attribute( w, "note", "a<b & \"c\"" );
+    uxml_writer_text( w, "text ", 5 );
+    uxml_writer_text( w, name, strlen( name ) );
+    uxml_writer_start_element( w, "data" );
+    uxml_writer_base64( w, data, (size_t)(i % 7) ); /* base64 by parts is the same sequence */
+    uxml_writer_base64( w, data + i % 7, sizeof( data ) - (size_t)(i % 7) );
+    uxml_writer_end_element( w );
+    uxml_writer_start_element( w, "empty" );
+    uxml_writer_end_element( w );
+    uxml_writer_end_element( w );
+  }
+  if( !uxml_writer_finish( w, &e ) )
+  {
+    uxml_writer_free( w );
+    free( o.data );
+    return print_error( &e );
+  }
+  uxml_writer_free( w );
+  uxml_encode64( b, sizeof( b ), data, sizeof( data ) );
+  if( (root = uxml_parse( o.data, o.size, &e )) == NULL )
+  {
+    free( o.data );
+    return print_error( &e );
+  }
+  printf( "writer: %d bytes by %d parts, %d items, item[9999]: id=%s note=%s text=\"%s\" data %s\n", (int)o.size, o.parts,
+          (int)uxml_count( root, "item" ), uxml_get( root, "item[9999]/id" ), uxml_get( root, "item[9999]/note" ),
+          uxml_get( root, "item[9999]" ), strcmp( uxml_get( root, "item[9999]/data" ), b ) == 0 ? "ok": "failed" );
+  uxml_free( root );
+  free( o.data );
+  o.data = NULL;
+  o.size = 0;
+  /* errors */
+  w = uxml_writer_create( on_flush, &o, UXML_WRITE_COMPACT );
+  uxml_writer_start_element( w, "a" );
+  uxml_writer_text( w, "x", 1 );
+  i = uxml_writer_attribute( w, "b", "c" );
+  printf( "writer errors: %d %d", i, uxml_writer_finish( w, &e ) );
+  printf( " %s,", e.text );
+  uxml_writer_free( w );
+  w = uxml_writer_create( on_flush, &o, UXML_WRITE_COMPACT );
+  i = uxml_writer_end_element( w );
+  printf( " %d %d", i, uxml_writer_finish( w, &e ) );
+  printf( " %s,", e.text );
+  uxml_writer_free( w );
+  w = uxml_writer_create( on_flush, &o, UXML_WRITE_COMPACT );
+  uxml_writer_start_element( w, "a" );
+  uxml_writer_end_element( w );
+  i = uxml_writer_start_element( w, "b" );
+  printf( " %d %d", i, uxml_writer_finish( w, &e ) );
+  printf( " %s\n", e.text );
+  uxml_writer_free( w );
+  free( o.data );
+  fflush( stdout );
+  w = uxml_writer_create_fd( fileno( stdout ), UXML_WRITE_INDENT );
+  uxml_writer_start_element( w, "nodeR" );
+  uxml_writer_attribute( w, "attrR", "valueR" );
+  uxml_writer_start_element( w, "nodeA" );
+  uxml_writer_text( w, "text  with\tspaces ", 18 );
+  uxml_writer_end_element( w );
+  uxml_writer_start_element( w, "nodeB" );
+  uxml_writer_base64( w, "9876543210", 10 );
+  uxml_writer_end_element( w );
+  uxml_writer_start_element( w, "nodeC" );
+  uxml_writer_start_element( w, "nodeD" );
+  if( !uxml_writer_finish( w, &e ) )
+  {
+    uxml_writer_free( w );
+    return print_error( &e );
+  }
+  uxml_writer_free( w );
+  return 1;
+}
+
+int test_mutate()
+{
+  uxml_node_t *root, *server, *n, **nodes;
+  uxml_query_t *query;
+  char xml[2048], *x = xml, out[2048];
+  size_t count;
+  int i;
+
+  x += sprintf( x, "<config version='1'><server host='a' port='80'>old<opt/>text</server>" );
+  for( i = 0; i < 40; i++ )
+    x += sprintf( x, "<item>%d</item>", i );
+  sprintf( x, "</config>" );
+  if( (root = uxml_parse( xml, strlen( xml ), &e )) == NULL )
+    return print_error( &e );
+  server = uxml_node( root, "server" );
+  uxml_cache_values( root, 1 );
+  printf( "mutate: port=%lld item[35]=%s", uxml_int64( server, "port" ), uxml_get( root, "item[35]" ) );
+  /* content and existing attributes are changed, converted values are dropped */
+  i = uxml_set_attr( server, "port", "8080" ) && uxml_set_content( root, "server", "new & <b>" ) && uxml_set_content( root, "item[1]", NULL );
+  printf( " set=%d port=%lld server=\"%s\" item[1]=\"%s\"", i, uxml_int64( server, "port" ), uxml_get( root, "server" ), uxml_get( root, "item[1]" ) );
+  /* indexed children are removed */
+  i = uxml_remove( uxml_node( root, "item[0]" ) ) && uxml_remove( uxml_node( root, "item[38]" ) ) && uxml_remove( uxml_node( server, "host" ) );
+  printf( " remove=%d %d %d count=%d item[0]=%s item[34]=%s last=%s\n", i, uxml_remove( root ), uxml_remove( uxml_node( server, "opt" ) ),
+    (int)uxml_count( root, "item" ), uxml_get( root, "item[0]" ), uxml_get( root, "item[34]" ), uxml_get( uxml_last_child( root ), NULL ) );
+  uxml_write( server, out, sizeof( out ), UXML_WRITE_COMPACT );
+  printf( "mutate: %s\n", out );
+  /* new nodes, attributes and names; changed tree is written and parsed back */
+  n = uxml_add_child( server, "added", "x & y" );
+  if( n == NULL || !uxml_set_attr( server, "mode", "fast" ) || !uxml_set_attr( n, "id", "7" ) || !uxml_set_attr( n, "id", "8" ) ||
+      uxml_add_child( uxml_node( server, "mode" ), "a", NULL ) != NULL || strcmp( uxml_get( root, "server/added/id" ), "8" ) != 0 ||
+      uxml_int64( root, "server/added/id" ) != 8 || uxml_add_child( root, "item", "new" ) == NULL ||
+      strcmp( uxml_get( root, "item[38]" ), "new" ) != 0 || uxml_prev( uxml_node( server, "mode" ) ) != uxml_node( server, "port" ) )
+  {
+    printf( "mutate: add failed\n" );
+    uxml_free( root );
+    return 0;
+  }
+  for( i = 0; i < 40; i++ )
+  {
+    sprintf( xml, "%d", i );
+    uxml_add_child( n, "sub", xml );
+  }
+  uxml_remove( uxml_node( n, "sub[0]" ) );
+  uxml_set_user( n, "sub[30]", &count );
+  uxml_set_user( root, "item[2]", &i );
+  if( strcmp( uxml_get( n, "sub[35]" ), "36" ) != 0 || strcmp( uxml_get( uxml_last_child( n ), NULL ), "39" ) != 0 ||
+      uxml_node( n, "sub[35]/.." ) != n || uxml_user( n, "sub[30]" ) != &count || uxml_user( n, "sub[31]" ) != NULL ||
+      uxml_user( root, "item[2]" ) != &i )
+  {
+    printf( "mutate: children of new node failed\n" );
+    uxml_free( root );
+    return 0;
+  }
+  /* selection follows document order of changed tree */
+  x = out;
+  if( (query = uxml_query_compile( "//@*", &e )) == NULL )
+    return print_error( &e );
+  nodes = uxml_select( root, query, &count );
+  for( i = 0; nodes != NULL && i < (int)count; i++ )
+    x += sprintf( x, "%s ", uxml_name( nodes[i] ) );
+  free( nodes );
+  uxml_query_free( query );
+  if( strcmp( out, "version port mode id " ) != 0 )
+  {
+    printf( "mutate: select failed: %s\n", out );
+    uxml_free( root );
+    return 0;
+  }
+  count = uxml_write( root, out, sizeof( out ), UXML_WRITE_COMPACT );
+  uxml_free( root );
+  if( (root = uxml_parse( out, count, &e )) == NULL )
+    return print_error( &e );
+  if( strcmp( uxml_get( root, "server/mode" ), "fast" ) != 0 || strcmp( uxml_get( root, "server/added" ), "x & y" ) != 0 ||
+      uxml_count( root, "item" ) != 39 || uxml_count( root, "server/added/sub" ) != 39 )
+  {
+    printf( "mutate: changed tree is written wrong: %s\n", out );
+    uxml_free( root );
+    return 0;
+  }
+  uxml_free( root );
+  return 1;
+}
+
+int test_context()
+{
+  uxml_context_t *ctx;
+  uxml_node_t *root, *copy;
+  char xml[8192], *x, a[8192], b[8192];
+  int i, k, same = 0;
+
+  if( (ctx = uxml_context_create()) == NULL )
+    return 0;
+  for( i = 0; i < 20; i++ )            /* documents of different sizes, many small nodes make array of nodes grow */
+  {
+    x = xml + sprintf( xml, "<doc n='%d'>text %d", i, i );
+    for( k = 0; k < (i % 5) * 100; k++ )
+      x += sprintf( x, (k % 2) ? "<a/>": "<b%d x='%d'>&lt;%d</b%d>", k % 7, k, k, k % 7 );
+    sprintf( x, "</doc>" );
+    if( (root = uxml_parse_ctx( ctx, xml, strlen( xml ), &e )) == NULL || (copy = uxml_parse( xml, strlen( xml ), &e )) == NULL )
+    {
+      uxml_context_free( ctx );
+      return print_error( &e );
+    }
+    uxml_write( root, a, sizeof( a ), UXML_WRITE_COMPACT );
+    uxml_write( copy, b, sizeof( b ), UXML_WRITE_COMPACT );
+    same += (strcmp( a, b ) == 0);
+    uxml_free( copy );
+    if( i % 3 == 0 )                   /* tree's own data is released, buffers stay in context */
+    {
+      uxml_set_content( root, "", "changed" );
+      uxml_cache_values( root, 1 );
+      uxml_node( root, "a[30]" );
+      uxml_free( root );
+    }
+  }
+  root = uxml_parse_ctx( ctx, "<a><b></a>", 10, &e );
+  printf( "context: %d of 20 trees are the same, error: %s", same, root == NULL ? e.text: "none" );
+  k = (same == 20 && root == NULL);
+  root = uxml_parse_ctx( ctx, "<a x='1'><b>2</b></a>", 21, &e );
+  if( root == NULL )
+  {
+    uxml_context_free( ctx );
+    return print_error( &e );
+  }
+  printf( ", after error: %s %s\n", uxml_get( root, "x" ), uxml_get( root, "b" ) );
+  k = k && strcmp( uxml_get( root, "x" ), "1" ) == 0 && strcmp( uxml_get( root, "b" ), "2" ) == 0;
+  uxml_context_free( ctx );
+  if( !k )
+  {
+    printf( "context failed\n" );
+    return 0;
+  }
+  return 1;
+}
+
 int test_base64()
 {
   char b[64], d[64];
@@ -152,6 +1502,21 @@ int main()
     "<?xml version='1.0' encoding='UTF-8'?>\n"
     "<!-- comment -->\n"
     "<nodeR attrR=\"&lt;&gt;&amp;&apos;&quot;&#64;&#x4A;\"> &lt; &gt; &amp; &apos; &quot; &#64; &#x4A; </nodeR>\n";
+  const char test_long[] = 
+    "<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<nodeR attrR=\"value_value_value_value_value_value_value_value_value_value_value_value_R\">\n"
+    "<!-- comment_comment_comment_comment_comment_comment_comment_comment_comment -->\n"
+    "content_content_content_content_content_content_content_content_content_R1 &amp;"
+    "content_content_content_content_content_content_content_content_content_R2<!-- c -->R3\n"
+    "<node_node_node_node_node_node_node_node_node_node_node_node_node_node_A/>\n"
+    "</nodeR>\n";
+  const char test_spaces[] = 
+    "<?xml version='1.0' encoding='UTF-8'?>\n"
+    "<nodeR>\r\n"
+    "\t\t  contentR1 \t\r\n contentR2                                                            contentR3\n"
+    "  \t<nodeA>   contentA1&#32;&#32;contentA2\t&amp; contentA3   </nodeA>\r\n"
+    "                                                                          contentR4\n"
+    "</nodeR>\n";
 
   if( !test( test_header_and_empty_root ) ) return 1;
   if( !test( test_root_comment ) ) return 1;
@@ -162,7 +1527,32 @@ int main()
   if( !test( test_node_attr2 ) ) return 1;
   if( !test( test_nodes ) ) return 1;
   if( !test( test_escape ) ) return 1;
+  if( !test( test_long ) ) return 1;
+  if( !test( test_spaces ) ) return 1;
   if( !test_navigate() ) return 1;
+  if( !test_grow() ) return 1;
+  if( !test_deep() ) return 1;
+  if( !test_end() ) return 1;
+  if( !test_reader() ) return 1;
+  if( !test_push() ) return 1;
+  if( !test_read_end() ) return 1;
+  if( !test_ref() ) return 1;
+  if( !test_insitu() ) return 1;
+  if( !test_names() ) return 1;
+  if( !test_index() ) return 1;
+  if( !test_path() ) return 1;
+  if( !test_numbers() ) return 1;
+  if( !test_bind() ) return 1;
+  if( !test_extract() ) return 1;
+  if( !test_iter() ) return 1;
+  if( !test_query() ) return 1;
+#if !defined( UXML_DISABLE_THREADS )
+  if( !test_parallel() ) return 1;
+#endif
+  if( !test_write() ) return 1;
+  if( !test_writer() ) return 1;
+  if( !test_mutate() ) return 1;
+  if( !test_context() ) return 1;
   if( !test_base64() ) return 1;
   return 0;
 }
@@ -1,6 +1,48 @@
 #include <uxml.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <errno.h>
+
+#if !defined( UXML_DISABLE_SIMD )
+#if defined( __AVX2__ )
+#include <immintrin.h>
+#elif defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+#define UXML_SSE2
+#endif
+#endif
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#endif
+
+#if defined( _WIN32 )
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#if !defined( UXML_DISABLE_THREADS )
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+#endif
+
+#if !defined( UXML_DISABLE_MMAP )
+#if defined( _WIN32 )
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#endif
 
 enum { NONE,
        NODE_NAME, NODE_TAG, NODE_CONTENT_TRIM_0, NODE_CONTENT_0,
@@ -77,43 +119,283 @@ enum { NONE,
 
 */
 
+/* maximal nesting of nodes, 0 - limited by memory only */
+#if !defined( UXML_MAX_DEPTH )
+#define UXML_MAX_DEPTH 0
+#endif
+
+/* size of reader's buffer, long content is passed to reader by parts of this size */
+#if !defined( UXML_READER_BUFFER )
+#define UXML_READER_BUFFER 4096
+#endif
+
+/* size of writer's buffer, output is passed to file by parts of this size */
+#if !defined( UXML_WRITE_BUFFER )
+#define UXML_WRITE_BUFFER 65536
+#endif
+
+/* count of children, which are looked through before the index of children is built, 0 - no index.
+ * Index is built by lookups, so lookups in one tree from concurrent threads must be synchronized, if it is enabled. */
+#if !defined( UXML_INDEX_CHILDREN )
+#define UXML_INDEX_CHILDREN 0
+#endif
+
+/* maximal count of threads and minimal size of XML data for one thread in parallel parse */
+#if !defined( UXML_MAX_THREADS )
+#define UXML_MAX_THREADS 64
+#endif
+#if !defined( UXML_MIN_PART )
+#define UXML_MIN_PART 65536
+#endif
+
 /* entity type - node, attribute or process instruction */
 enum { XML_NONE, XML_NODE, XML_ATTR, XML_INST };
 
+/* data, which is not needed by reader and is not stored */
+enum { SKIP_CONTENT = 1, SKIP_VALUE = 2 };
+
+/* no location in XML data or text data */
+#define NO_INDEX ((size_t)-1)
+
+/* node's flags: content refers to XML data, it is not terminated with zero byte */
+#define CONTENT_REF 2
+
+/* compact node's flags: content is a copy in the arena, it is indexed in the table of copies */
+#define CONTENT_EXT 8
+
+/* node's flags: node is added after parse, it is allocated in the arena */
+#define NODE_ADDED 16
+
+/* node's flags: children are changed after parse, they are not indexed */
+#define CHILDREN_CHANGED 32
+
+#if defined( UXML_COMPACT )
+/* compact nodes refer to nodes and texts by 32-bit indices, so document is limited to 4 GB */
+typedef unsigned int uxml_index_t;
+#define UXML_INDEX_MAX 0xFFFFFFFFU
+
+/* nodes, which are added after parse, have indices from ADDED_INDEX, parsed ones are below it */
+#define ADDED_INDEX 0x80000000U
+#define UXML_NODES_MAX (ADDED_INDEX - 1)
+
+/* added nodes are allocated in chunks of the arena, chunk number c keeps ADDED_CHUNK << c nodes */
+#define ADDED_CHUNK 16
+#define ADDED_CHUNKS 27
+#endif
+
+/* open node while parse */
+typedef struct _uxml_frame_t
+{
+  size_t node;                      /* index of node */
+  int state;                        /* outer state, restored at end of node */
+  size_t last_child;                /* last child node or attribute, 0 - no children yet */
+  size_t content_begin;             /* content begin in text data, 0 - no content yet */
+  size_t content_end;               /* and content end, of course */
+  size_t name;                      /* node's name in XML data */
+  size_t name_len;                  /* node's name length */
+  unsigned char *parts;             /* previous parts of content, which is split by child nodes, in-situ parse only */
+  size_t parts_size;                /* and their size */
+#if defined( UXML_COMPACT )
+  size_t parts_ext;                 /* index of joined parts in the table of copies, NO_INDEX - parts are not joined yet */
+#endif
+} uxml_frame_t;
+
+/* interned name, its index in the table of names is name's ID */
+typedef struct _uxml_symbol_t
+{
+  size_t name;                      /* location of name in text data */
+  size_t length;                    /* length of name */
+  unsigned int hash;                /* hash of name */
+  unsigned char *copy;              /* copy of name in the arena, if name is added after parse, or NULL */
+} uxml_symbol_t;
+
+/* run of children with the same name in the index of children */
+typedef struct _uxml_run_t
+{
+  size_t name;                      /* ID of name */
+  size_t begin;                     /* location of first child in the index */
+  size_t attrs;                     /* count of attributes, they precede nodes */
+  size_t count;                     /* count of children */
+} uxml_run_t;
+
+/* index of children of one node, children are grouped by name in document order */
+typedef struct _uxml_children_t
+{
+  size_t parent;                    /* index of parent node */
+  uxml_run_t *run;                  /* runs of children with the same name */
+  size_t *hash;                     /* hash table of runs by name's ID, run's index plus one, 0 - empty slot */
+  size_t mask;                      /* size of hash table minus one */
+  size_t *child;                    /* indices of children, grouped by runs */
+} uxml_children_t;
+
+/* type of converted value */
+enum { VALUE_NONE, VALUE_INT64, VALUE_UINT64, VALUE_DOUBLE, VALUE_BOOL };
+
+/*
+ * Converted value of node's content, it is cached, if cache is enabled
+ */
+typedef struct _uxml_value_t
+{
+  union
+  {
+    long long i;
+    unsigned long long u;
+    double d;
+  } v;                              /* value, 0 in case of error, except real number followed by other text */
+  int type;                         /* VALUE_INT64 ... VALUE_BOOL, VALUE_NONE - not converted yet */
+  int status;                       /* UXML_OK, UXML_MISSING, UXML_INVALID or UXML_RANGE */
+} uxml_value_t;
+
 typedef struct _uxml_t
 {
   const unsigned char *xml;         /* original XML data */
-  int xml_index;                    /* current character when parse */
-  int xml_size;                     /* size of original XML data */
+  size_t xml_index;                 /* current character when parse */
+  size_t xml_size;                  /* size of original XML data */
   unsigned char *text;              /* text data, extracted from original XML */
-  int text_index;                   /* current write index */
-  int text_size;        /* text data size, in bytes */
+  size_t text_index;                /* current write index */
+  size_t text_size;                 /* text data size, in bytes */
   uxml_node_t *node;                /* array of nodes, first element - emtpy, second element - root node */
-  int node_index;                   /* current node while parse */
-  int nodes_count;      /* count of nodes */
+  size_t node_index;                /* current node while parse */
+  size_t nodes_count;               /* count of nodes */
+  size_t nodes_size;                /* allocated count of nodes while parse */
   int state;                        /* current state */
   unsigned int c;                   /* queue of last 4 characters, least byte means last character */
   unsigned int escape;              /* escape flags for last 4 characters, least bit is corresponded to last character */
-  int line;                         /* current line, freeze at error position */
-  int column;                       /* current column, freeze at error position */
+  size_t line;                      /* current line, freeze at error position */
+  size_t column;                    /* current column, freeze at error position */
   const char *error;                /* error's text */
-  int initial_allocated;
+  size_t initial_allocated;
+  size_t block_index;               /* begin of 64-byte block of XML data, indexed by block bitmaps */
+  unsigned long long block_bits;    /* structural characters of block, least bit is corresponded to first character */
+  unsigned long long block_space;   /* spaces of block */
+  unsigned long long block_lf;      /* line feeds of block */
+  unsigned long long block_cr;      /* carriage returns of block */
+  uxml_frame_t *stack;              /* open nodes, last one is current node */
+  size_t depth;                     /* count of open nodes */
+  size_t stack_size;                /* allocated count of stack frames */
+  size_t root;                      /* index of root node, 0 - not found yet */
+  size_t inst;                      /* index of process instruction while parse */
+  size_t attr;                      /* index of last attribute while tag parse */
+  size_t name_end;                  /* node's end name in XML data */
+  int comment_state;                /* state before comment */
+  uxml_reader_t *reader;            /* reader's callbacks, uxml_read only */
+  size_t token;                     /* begin of current token in reader's buffer */
+  size_t value;                     /* attribute's value in reader's buffer */
+  int words;                        /* content has words already */
+  int skip;                         /* SKIP_CONTENT, SKIP_VALUE - reader doesn't need content or attribute's values */
+  int final;                        /* XML data is not continued */
+  size_t esc_len;                   /* length of escape sequence, which is collected after current token, plus one, 0 - no escape */
+  int bom;                          /* count of checked bytes of byte order mark, push parser only */
+  size_t zeros;                     /* zero bytes at end of last part, they are skipped at end of data, push parser only */
+  int insitu;                       /* text data is stored to XML data itself */
+  int ref;                          /* contents refer to XML data, if they are the same */
+  unsigned char *arena;             /* last block of zero-terminated copies of contents */
+  size_t arena_index;               /* current write index in arena */
+  size_t arena_size;                /* size of arena's last block */
+  uxml_symbol_t *names;             /* table of interned names, ID 0 is empty name */
+  size_t names_count;               /* count of names */
+  size_t names_size;                /* allocated count of names */
+  size_t *names_hash;               /* hash table of names' IDs, 0 - empty slot */
+  size_t names_mask;                /* size of hash table minus one, size is power of two */
+  size_t name_begin;                /* location of current name in text data, while parse */
+  uxml_children_t **children;       /* hash table of indices of children by parent's index, allocated on first use */
+  size_t children_count;            /* count of indexed nodes */
+  size_t children_mask;             /* size of hash table minus one */
+  uxml_value_t *values;             /* cache of converted values by index of node, NULL - no cache */
+  int modified;                     /* tree is changed after parse, nodes of array are not in document order */
+  struct _uxml_context_t *context;  /* context, which keeps buffers of tree, NULL - tree is one block */
+#if defined( UXML_COMPACT )
+  void **user;                      /* user's pointers of nodes, allocated on first use */
+  unsigned char **ext;              /* table of contents, which are copied to the arena */
+  size_t ext_count;                 /* count of copies */
+  size_t ext_size;                  /* allocated size of table */
+  uxml_node_t **added;              /* chunks of nodes, which are added after parse, allocated on first use */
+  size_t added_count;               /* count of added nodes */
+#endif
 } uxml_t;
 
+#if defined( UXML_COMPACT )
+/*
+ * Compact node: 36 bytes instead of 80, links are indices in array of nodes,
+ * name is ID of interned name, content is offset in text data or XML data (with CONTENT_REF),
+ * or index in the table of copies (with CONTENT_EXT).
+ * Instance is found by own index, because tree's instance precedes its array of nodes,
+ * user's pointers are kept in separate array. Nodes, which are added after parse,
+ * are kept in chunks of the arena, each chunk is preceded by pointer to instance.
+ */
+struct _uxml_node_t
+{
+  uxml_index_t self;      /* index of this node */
+  uxml_index_t name;      /* ID of element's name */
+  uxml_index_t content;   /* element's content / attribute value */
+  uxml_index_t size;      /* size of element's content */
+  uxml_index_t parent;    /* index of parent element, 0 means no parent */
+  uxml_index_t child;     /* index of first child element (for XML_NODE only), 0 means no child */
+  uxml_index_t next;      /* index of next element (not for XML_INST), 0 means last element */
+#if !defined( UXML_DISABLE_PREV )
+  uxml_index_t prev;      /* index of previous element, first element refers to the last one */
+#endif
+  unsigned char type;     /* element's type - XML_NODE, XML_ATTR, XML_INST */
+  unsigned char flags;    /* CONTENT_REF, CONTENT_EXT, CHILDREN_CHANGED */
+};
+
+static uxml_t *uxml_added_instance( const uxml_node_t *n );
+static uxml_node_t *uxml_added_link( const uxml_node_t *n, uxml_index_t i );
+
+#define INSTANCE( n ) (((n)->self & ADDED_INDEX) == 0 ? (uxml_t *)((n) - (n)->self) - 1: uxml_added_instance( n ))
+#define LINK( n, field ) ((n)->field == 0 ? NULL: \
+  (((n)->field | (n)->self) & ADDED_INDEX) == 0 ? (n) + ((ptrdiff_t)(n)->field - (ptrdiff_t)(n)->self): uxml_added_link( n, (n)->field ))
+#define SET_LINK( p, n, field, i ) ((n)->field = (uxml_index_t)(i))
+#define SET_NODE( p, n, field, c ) ((void)(p), (n)->field = ((c) != NULL ? (c)->self: 0))
+#define TEXT_IN( text, i ) ((uxml_index_t)(i))
+#define XML_AT( p, i ) ((uxml_index_t)(i))
+#define NAME_ID( n ) ((n)->name)
+#define NAME( p, n ) ((p)->names[ (n)->name ].copy != NULL ? (p)->names[ (n)->name ].copy: (p)->text + (p)->names[ (n)->name ].name)
+#define CONTENT( p, n ) \
+  (((n)->flags & CONTENT_EXT) != 0 ? (p)->ext[ (n)->content ]: (((n)->flags & CONTENT_REF) != 0 ? (unsigned char *)(p)->xml: (p)->text) + (n)->content)
+#else
 struct _uxml_node_t
 {
-  int type;               /* element's type - XML_NODE, XML_ATTR, XML_INST */
-  unsigned char *name;    /* element's name */
+  unsigned char type;     /* element's type - XML_NODE, XML_ATTR, XML_INST */
+  unsigned char flags;    /* CONTENT_REF, NODE_ADDED, CHILDREN_CHANGED */
+  unsigned int name_id;   /* ID of interned name, it shares 8 bytes with type and flags */
+  unsigned char *name;    /* element's name, interned copy */
   unsigned char *content; /* element's content / attribute value */
-  int size;               /* size of element's content */
-  int name_length;        /* length of name */
+  size_t size;            /* size of element's content */
   uxml_t *instance;       /* UXML instance */
   uxml_node_t *parent;    /* index of parent element */
   uxml_node_t *child;     /* index of first child element (for XML_NODE only), 0 means no child */
   uxml_node_t *next;      /* index of next element (not for XML_INST), 0 means last element */
+#if !defined( UXML_DISABLE_PREV )
+  uxml_node_t *prev;      /* index of previous element, first element refers to the last one */
+#endif
   void *user;             /* user pointer */
 };
 
+#define INSTANCE( n ) ((n)->instance)
+#define LINK( n, field ) ((n)->field)
+#define SET_LINK( p, n, field, i ) ((n)->field = (p)->node + (i))
+#define SET_NODE( p, n, field, c ) ((void)(p), (n)->field = (c))
+#define TEXT_IN( text, i ) ((text) + (i))
+#define XML_AT( p, i ) ((unsigned char *)(p)->xml + (i))
+#define NAME_ID( n ) ((n)->name_id)
+#define NAME( p, n ) ((n)->name)
+#define CONTENT( p, n ) ((n)->content)
+#endif
+
+/* location in text data */
+#define TEXT_AT( p, i ) TEXT_IN( (p)->text, i )
+
+/* link node \c n to previous sibling \c i, and first sibling \c first to \c n as last one */
+#if !defined( UXML_DISABLE_PREV )
+#define SET_PREV( p, first, n, i ) (SET_LINK( p, n, prev, i ), SET_LINK( p, first, prev, (n) - (p)->node ))
+#else
+#define SET_PREV( p, first, n, i ) ((void)0)
+#endif
+
+/* length of node's name */
+#define NAME_LENGTH( p, n ) ((p)->names[ NAME_ID( n ) ].length)
+
 /*
 #define isdigit( c ) (c>='0'&&c<='9')
 #define isalpha( c ) ((c>='A'&&c<='Z')||(c>='a'&&c<='z'))
@@ -138,13 +420,351 @@ static const unsigned int uxml_isspace_tab32[8]={0x00002600,0x00000001,0x0000000
 #define isalpha( c ) ((uxml_isalpha_tab32[ c >> 5 ] >> (c & 0x1F))&1)
 #define isspace( c ) ((uxml_isspace_tab32[ c >> 5 ] >> (c & 0x1F))&1)
 
+/* structural characters: all control characters and spaces, '"', '&', '\'', '/', '<', '=', '>' */
+static const unsigned int uxml_isstruct_tab32[8]={0xFFFFFFFF,0x700080C5,0x00000000,0x00000000,0x00000000,0x00000000,0x00000000,0x00000000};
+
+#define isstruct( c ) ((uxml_isstruct_tab32[ c >> 5 ] >> (c & 0x1F))&1)
+
+#if defined( _MSC_VER ) && defined( _M_X64 )
+static int uxml_ctz64( unsigned long long v )
+{
+  unsigned long i;
+  _BitScanForward64( &i, v );
+  return (int)i;
+}
+
+static int uxml_msb64( unsigned long long v )
+{
+  unsigned long i;
+  _BitScanReverse64( &i, v );
+  return (int)i;
+}
+
+#define uxml_popcount64( v ) ((int)__popcnt64( v ))
+#elif defined( __GNUC__ )
+#define uxml_ctz64( v ) __builtin_ctzll( v )
+#define uxml_msb64( v ) (63 - __builtin_clzll( v ))
+#define uxml_popcount64( v ) __builtin_popcountll( v )
+#else
+static int uxml_ctz64( unsigned long long v )
+{
+  int i;
+  for( i = 0; (v & 1) == 0; v >>= 1, i++ );
+  return i;
+}
+
+static int uxml_msb64( unsigned long long v )
+{
+  int i;
+  for( i = -1; v != 0; v >>= 1, i++ );
+  return i;
+}
+
+static int uxml_popcount64( unsigned long long v )
+{
+  int i;
+  for( i = 0; v != 0; v &= v - 1, i++ );
+  return i;
+}
+#endif
+
+/*
+ * Stage 1: mark structural characters, spaces and line breaks of 64-byte block,
+ * which begin at index \c block.
+ * Characters behind end of XML data are marked as structural too.
+ */
+static void uxml_index_block( uxml_t *p, size_t block )
+{
+  const unsigned char *s = p->xml + block;
+  unsigned long long bits = 0, space = 0, lf = 0, cr = 0;
+  size_t i, n = p->xml_size - block;
+
+#if defined( __AVX2__ ) && !defined( UXML_DISABLE_SIMD )
+  if( n >= 64 )
+  {
+    for( i = 0; i < 64; i += 32 )
+    {
+      __m256i v = _mm256_loadu_si256( (const __m256i *)(s + i) );
+      __m256i l = _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\n' ) );
+      __m256i r = _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\r' ) );
+      __m256i w = _mm256_or_si256( _mm256_or_si256( l, r ),
+                  _mm256_or_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( ' ' ) ), _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\t' ) ) ) );
+      __m256i m = _mm256_cmpeq_epi8( _mm256_min_epu8( v, _mm256_set1_epi8( ' ' ) ), v ); /* v <= ' ' */
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '<' ) ) );
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '>' ) ) );
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '&' ) ) );
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\"' ) ) );
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\'' ) ) );
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '=' ) ) );
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '/' ) ) );
+      bits |= (unsigned long long)(unsigned int)_mm256_movemask_epi8( m ) << i;
+      space |= (unsigned long long)(unsigned int)_mm256_movemask_epi8( w ) << i;
+      lf |= (unsigned long long)(unsigned int)_mm256_movemask_epi8( l ) << i;
+      cr |= (unsigned long long)(unsigned int)_mm256_movemask_epi8( r ) << i;
+    }
+  }
+  else
+#elif defined( UXML_SSE2 )
+  if( n >= 64 )
+  {
+    for( i = 0; i < 64; i += 16 )
+    {
+      __m128i v = _mm_loadu_si128( (const __m128i *)(s + i) );
+      __m128i l = _mm_cmpeq_epi8( v, _mm_set1_epi8( '\n' ) );
+      __m128i r = _mm_cmpeq_epi8( v, _mm_set1_epi8( '\r' ) );
+      __m128i w = _mm_or_si128( _mm_or_si128( l, r ),
+                  _mm_or_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( ' ' ) ), _mm_cmpeq_epi8( v, _mm_set1_epi8( '\t' ) ) ) );
+      __m128i m = _mm_cmpeq_epi8( _mm_min_epu8( v, _mm_set1_epi8( ' ' ) ), v ); /* v <= ' ' */
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '<' ) ) );
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '>' ) ) );
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '&' ) ) );
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '\"' ) ) );
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '\'' ) ) );
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '=' ) ) );
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '/' ) ) );
+      bits |= (unsigned long long)(unsigned int)_mm_movemask_epi8( m ) << i;
+      space |= (unsigned long long)(unsigned int)_mm_movemask_epi8( w ) << i;
+      lf |= (unsigned long long)(unsigned int)_mm_movemask_epi8( l ) << i;
+      cr |= (unsigned long long)(unsigned int)_mm_movemask_epi8( r ) << i;
+    }
+  }
+  else
+#endif
+  {
+    for( i = 0; i < n && i < 64; i++ )
+    {
+      bits |= (unsigned long long)isstruct( s[i] ) << i;
+      space |= (unsigned long long)isspace( s[i] ) << i;
+      lf |= (unsigned long long)(s[i] == '\n') << i;
+      cr |= (unsigned long long)(s[i] == '\r') << i;
+    }
+    if( n < 64 )
+    {
+      bits |= ~0ULL << n;              /* stop at end of data */
+    }
+  }
+  p->block_index = block;
+  p->block_bits = bits;
+  p->block_space = space;
+  p->block_lf = lf;
+  p->block_cr = cr;
+}
+
+/*
+ * Count characters, which may begin a node: '<' of node or process instruction, and '=' of attribute.
+ * '<' of end tag or comment, which is followed by '/' or '!', is not counted.
+ * Every node has one of them, so it is upper bound of nodes count in \c n bytes of XML data.
+ */
+static size_t uxml_count_nodes( const unsigned char *s, size_t n )
+{
+  size_t i = 0, count = 0;
+#if defined( __AVX2__ ) && !defined( UXML_DISABLE_SIMD )
+  unsigned long long sum[4];
+  size_t k;
+
+  while( n - i > 32 )                  /* next character is checked too */
+  {
+    __m256i acc = _mm256_setzero_si256();
+
+    for( k = 0; k != 255 && n - i > 32; k++, i += 32 ) /* byte counters, 255 steps at most */
+    {
+      __m256i v = _mm256_loadu_si256( (const __m256i *)(s + i) );
+      __m256i w = _mm256_loadu_si256( (const __m256i *)(s + i + 1) );
+      __m256i m = _mm256_or_si256( _mm256_cmpeq_epi8( w, _mm256_set1_epi8( '/' ) ), _mm256_cmpeq_epi8( w, _mm256_set1_epi8( '!' ) ) );
+      m = _mm256_andnot_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '<' ) ) );
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '=' ) ) );
+      acc = _mm256_sub_epi8( acc, m );
+    }
+    _mm256_storeu_si256( (__m256i *)sum, _mm256_sad_epu8( acc, _mm256_setzero_si256() ) );
+    count += (size_t)(sum[0] + sum[1] + sum[2] + sum[3]);
+  }
+#elif defined( UXML_SSE2 )
+  unsigned long long sum[2];
+  size_t k;
+
+  while( n - i > 16 )                  /* next character is checked too */
+  {
+    __m128i acc = _mm_setzero_si128();
+
+    for( k = 0; k != 255 && n - i > 16; k++, i += 16 ) /* byte counters, 255 steps at most */
+    {
+      __m128i v = _mm_loadu_si128( (const __m128i *)(s + i) );
+      __m128i w = _mm_loadu_si128( (const __m128i *)(s + i + 1) );
+      __m128i m = _mm_or_si128( _mm_cmpeq_epi8( w, _mm_set1_epi8( '/' ) ), _mm_cmpeq_epi8( w, _mm_set1_epi8( '!' ) ) );
+      m = _mm_andnot_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '<' ) ) );
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '=' ) ) );
+      acc = _mm_sub_epi8( acc, m );
+    }
+    _mm_storeu_si128( (__m128i *)sum, _mm_sad_epu8( acc, _mm_setzero_si128() ) );
+    count += (size_t)(sum[0] + sum[1]);
+  }
+#endif
+  for( ; i < n; i++ )
+  {
+    if( s[i] == '=' || (s[i] == '<' && (i + 1 == n || (s[i+1] != '/' && s[i+1] != '!'))) )
+      count++;
+  }
+  return count;
+}
+
+/*
+ * Shift queue of last characters and escape flags by \c r non-escaped characters
+ */
+static void uxml_shift( uxml_t *p, const unsigned char *s, size_t r )
+{
+  size_t i;
+
+  p->escape = (r < 32) ? (p->escape << r): 0;
+  if( r >= 4 )
+  {
+    p->c = ((unsigned int)s[r-4] << 24) | ((unsigned int)s[r-3] << 16) | ((unsigned int)s[r-2] << 8) | s[r-1];
+  }
+  else
+  {
+    for( i = 0; i != r; i++ )
+    {
+      p->c = (p->c << 8) | s[i];
+    }
+  }
+}
+
+/*
+ * Stage 2: jump over run of regular characters, which begin at current position.
+ * Characters are stored to the text buffer, if \c store is set.
+ * Returns length of run.
+ */
+static size_t uxml_run( uxml_t *p, int store )
+{
+  const unsigned char *s = p->xml + p->xml_index;
+  unsigned long long bits;
+  size_t i, r = 0;
+
+  for( i = p->xml_index; ; i = (i | 63) + 1 )
+  {
+    if( (i & ~63) != p->block_index )
+    {
+      uxml_index_block( p, i & ~63 );
+    }
+    if( (bits = p->block_bits >> (i & 63)) != 0 )
+    {
+      r = i + uxml_ctz64( bits ) - p->xml_index;
+      break;
+    }
+  }
+  if( r != 0 )
+  {
+    uxml_shift( p, s, r );             /* before store: in-situ text may overlap the run */
+    if( store )
+    {
+      if( r <= 16 && p->xml_index + 16 <= p->xml_size && !p->insitu ) /* short run, text buffer has place for the rest of data */
+        memcpy( p->text + p->text_index, s, 16 );
+      else
+        memmove( p->text + p->text_index, s, r );
+      p->text_index += r;
+    }
+    p->xml_index += r;
+    p->column += r;                    /* run has no line breaks */
+  }
+  return r;
+}
+
+/*
+ * Stage 2 for element's content: copy words in bulk and replace spaces between
+ * them with one space, like NODE_CONTENT_TRIM and NODE_CONTENT states do.
+ * Stops at '<', '&' or other structural character, it is dispatched by state machine.
+ * \c begin is set to location of first word, if content has no words yet.
+ * Returns count of stored bytes.
+ */
+static size_t uxml_content_run( uxml_t *p, size_t *begin )
+{
+  const unsigned char *s = p->xml + p->xml_index;
+  unsigned long long bits, lf, eol;
+  size_t i, stored = 0;
+  int k, n;
+
+  for( i = p->xml_index; ; )
+  {
+    if( (i & ~63) != p->block_index )
+    {
+      uxml_index_block( p, i & ~63 );
+    }
+    k = i & 63;
+    if( p->state == NODE_CONTENT_TRIM ) /* skip spaces */
+    {
+      bits = ~p->block_space >> k;     /* non-space characters, behind end of data too */
+      lf = p->block_lf >> k;
+      eol = (p->block_lf | p->block_cr) >> k;
+      if( bits != 0 )
+      {
+        n = uxml_ctz64( bits );
+        lf &= (1ULL << n) - 1;
+        eol &= (1ULL << n) - 1;
+      }
+      else
+      {
+        n = 64 - k;                    /* whole rest of block is spaces */
+      }
+      if( eol != 0 )
+      {
+        p->line += uxml_popcount64( lf );
+        p->column = n - 1 - uxml_msb64( eol );
+      }
+      else
+      {
+        p->column += n;
+      }
+      i += n;
+      if( bits == 0 )
+        continue;
+      if( (p->block_bits >> (k + n)) & 1 ) /* no word after spaces */
+        break;
+      if( *begin != 0 )
+      {
+        p->text[ p->text_index++ ] = ' '; /* store one space instead several */
+        stored++;
+      }
+      else
+      {
+        *begin = p->text_index;        /* the content begin */
+      }
+      p->state = NODE_CONTENT;
+    }
+    else                               /* copy word */
+    {
+      bits = p->block_bits >> k;
+      n = (bits != 0) ? uxml_ctz64( bits ): 64 - k;
+      if( n <= 16 && i + 16 <= p->xml_size && !p->insitu ) /* short word, text buffer has place for the rest of data */
+      {
+        memcpy( p->text + p->text_index, p->xml + i, 16 );
+      }
+      else
+      {
+        memmove( p->text + p->text_index, p->xml + i, n );
+      }
+      p->text_index += n;
+      p->column += n;
+      stored += n;
+      i += n;
+      if( bits == 0 )
+        continue;
+      if( ((p->block_space >> (k + n)) & 1) == 0 ) /* no spaces after word */
+        break;
+      p->state = NODE_CONTENT_TRIM;
+    }
+  }
+  uxml_shift( p, s, i - p->xml_index );
+  p->xml_index = i;
+  return stored;
+}
+
 /*
  * Get character, dispatch escape sequences in contents and attributes
  */
 static int uxml_get_escape( uxml_t *p )
 {
   /* escape sequences in attribute value or the content */
-  int i, t, code = 0, dec = 0, hex = 0, v = 0;
+  size_t i;
+  int t, code = 0, dec = 0, hex = 0, v = 0;
 
   for( i = p->xml_index; p->xml_index != p->xml_size; )
   {
@@ -259,1241 +879,5937 @@ static int uxml_get_escape( uxml_t *p )
 }
 
 /*
- * parse process instruction
+ * Move nodes to new array of nodes and/or new text buffer.
+ * Array of nodes must be already copied to new location,
+ * pointers in copied nodes are converted from old locations to new ones.
+ * Compact nodes have no pointers, they don't need it.
  */
-static int uxml_parse_inst( uxml_t *p )
+static void uxml_relocate( uxml_t *p, uxml_t *instance, uxml_node_t *node, unsigned char *text )
 {
-  int c0;
-  int state = p->state;                /* keep current state */
-  int node_index = p->node_index;      /* index of process instruction node */
-  uxml_node_t *n = NULL;               /* node for process instruction */
-  uxml_node_t *a = NULL;               /* node for attribute reading */
+#if !defined( UXML_COMPACT )
+  uxml_node_t *n;
+  size_t i;
 
-  if( p->node != NULL )                /* real parsing? */
+  for( i = 1, n = node + 1; i != p->node_index; i++, n++ ) /* first node is empty, skip it */
   {
-    n = p->node + p->node_index;       /* use current node */
+    if( text != p->text )
+    {
+      n->name = text + (n->name - p->text);
+      if( (n->flags & CONTENT_REF) == 0 )
+        n->content = text + (n->content - p->text);
+    }
+    n->instance = instance;
+    if( n->parent != NULL )
+      n->parent = node + (n->parent - p->node);
+    if( n->child != NULL )
+      n->child = node + (n->child - p->node);
+    if( n->next != NULL )
+      n->next = node + (n->next - p->node);
+#if !defined( UXML_DISABLE_PREV )
+    if( n->prev != NULL )
+      n->prev = node + (n->prev - p->node);
+#endif
+  }
+#else
+  (void)p; (void)instance; (void)node; (void)text;
+#endif
+}
+
+/*
+ * Grow array of nodes twice
+ */
+static int uxml_grow_nodes( uxml_t *p )
+{
+  uxml_node_t *node;
 
-    n->type = XML_INST;                /* type of node */
-    n->name = p->text + p->text_index; /* name of instruction */
-    n->name_length = 0;
-    n->content = p->text;              /* there is no content, tag only */
-    n->size = 0;                       /* size of content is 0 */
-    n->instance = p;                   /* our instance */
-    n->parent = NULL;                  /* no parent */
-    n->child = NULL;                   /* no child node(s) */
+#if defined( UXML_COMPACT )
+  if( 2 * p->nodes_size > UXML_NODES_MAX )
+  {
+    p->error = "Too many nodes for compact nodes";
+    return 0;
+  }
+#endif
+  if( (node = (uxml_node_t *)malloc( 2 * p->nodes_size * sizeof( uxml_node_t ) )) == NULL )
+  {
+    p->error = "Insufficient memory";
+    return 0;
   }
-  p->node_index++;                     /* next node */
+  memcpy( node, p->node, p->node_index * sizeof( uxml_node_t ) );
+  uxml_relocate( p, p, node, p->text );
+  if( p->node != (uxml_node_t *)(p + 1) ) /* array, which follows instance, is freed with it */
+    free( p->node );
+  p->node = node;
+  p->nodes_size *= 2;
+  return 1;
+}
 
-  p->state = INST_NAME;                /* new state - read instruction name */
-  while( p->xml_index != p->xml_size ) /* can read new character? */
+/*
+ * Grow text buffer to have place for extra bytes.
+ * Text buffer always keep place for the rest of XML data:
+ * every character of XML produces one byte of text at most,
+ * only content moving (see uxml_close_node) needs extra space.
+ */
+static int uxml_grow_text( uxml_t *p, size_t extra )
+{
+  unsigned char *text;
+  size_t size = p->text_size;
+
+  while( size < p->text_index + (p->xml_size - p->xml_index) + extra + 2 )
   {
-    c0 = p->xml[ p->xml_index++ ];     /* get new character */
-    p->column++;
-    p->c <<= 8;
-    p->escape <<= 1;
-    switch( c0 )
-    {
-    case '&':                    /* is there escape? */
-      if( (p->state & ENABLE_ESCAPE) != 0 ) /* escape sequences only in attribute value or the content */
-      {
-        if( (c0 = uxml_get_escape( p )) == 0 )
-          return 0;
-        p->escape |= 1;
-      }
-      break;
-    case '\n': p->column = 0; p->line++; break;
-    case '\r': p->column = 0; break;
-    default: break;
-    }
-    p->c |= c0;
-    if( p->state == INST_NAME )        /* is name reading ? */
-    {
-      if( !isspace( c0 ) )           /* non-space character? that is name */
-      {
-        if( p->text != NULL )          /* if text buffer present, */
-        {
-          p->text[ p->text_index ] = c0; /* store current character of name */
-          n->name_length++;
-        }
-        p->text_index++;               /* go to next character */
-      }
-      else                             /* name over */
-      {
-        p->text_index++;               /* end name with zero-byte */
-        p->state = INST_TAG;           /* go to read whole tag */
-      }
-    }
-    else if( p->state == INST_TAG )
-    {
-      if( isalpha( c0 ) )            /* attribute begin with alphabet character? */
-      {
-        p->state = INST_ATTR_NAME;     /* go to new state */
-        if( n != NULL )                /* while real parsing */
-        {
-          if( n->child == NULL )       /* and no one attribute was parsed yet */
+    size *= 2;
+  }
+  if( size == p->text_size )
+  {
+    return 1;
+  }
+#if defined( UXML_COMPACT )
+  if( size > UXML_INDEX_MAX )
+  {
+    p->error = "Too large text for compact nodes";
+    return 0;
+  }
+#endif
+  if( (text = (unsigned char *)malloc( size )) == NULL )
+  {
+    p->error = "Insufficient memory";
+    return 0;
+  }
+  memcpy( text, p->text, p->text_index );
+  uxml_relocate( p, p, p->node, text );
+  free( p->text );
+  p->text = text;
+  p->text_size = size;
+  return 1;
+}
+
+/*
+ * Allocate \c n bytes in the arena, which keeps texts out of text data until uxml_free.
+ * Arena is a list of blocks, every block begins with pointer to previous block.
+ * Returns NULL if there is no memory.
+ */
+static unsigned char *uxml_arena_alloc( uxml_t *p, size_t n )
+{
+  unsigned char *a;
+  size_t size;
+
+  if( p->arena_size - p->arena_index < n )
+  {
+    for( size = (p->arena_size != 0) ? 2 * p->arena_size: 1024; size < sizeof( unsigned char * ) + n; size *= 2 );
+    if( (a = (unsigned char *)malloc( size )) == NULL )
+      return NULL;
+    memcpy( a, &p->arena, sizeof( unsigned char * ) ); /* link to previous block */
+    p->arena = a;
+    p->arena_index = sizeof( unsigned char * );
+    p->arena_size = size;
+  }
+  a = p->arena + p->arena_index;
+  p->arena_index += n;
+  return a;
+}
+
+/*
+ * Free all blocks of the arena
+ */
+static void uxml_free_arena( uxml_t *p )
+{
+  unsigned char *a, *prev;
+
+  for( a = p->arena; a != NULL; a = prev )
+  {
+    memcpy( &prev, a, sizeof( unsigned char * ) );
+    free( a );
+  }
+  p->arena = NULL;
+#if defined( UXML_COMPACT )
+  free( p->ext );                      /* table of copies in the arena */
+  p->ext = NULL;
+  free( p->added );                    /* table of chunks in the arena */
+  p->added = NULL;
+  p->added_count = 0;
+#endif
+}
+
+/*
+ * Copy content, which refers to XML data, to the arena and terminate it with zero byte
+ */
+static unsigned char *uxml_arena_copy( uxml_t *p, const unsigned char *s, size_t n )
+{
+  unsigned char *a;
+
+  if( (a = uxml_arena_alloc( p, n + 1 )) != NULL )
+  {
+    memcpy( a, s, n );
+    a[n] = 0;
+  }
+  return a;
+}
+
+#if defined( UXML_COMPACT )
+/*
+ * Add text in the arena to the table of copies, compact node refers to it by index.
+ * Returns index of copy, or NO_INDEX if there is no memory.
+ */
+static size_t uxml_ext( uxml_t *p, unsigned char *s )
+{
+  unsigned char **ext;
+
+  if( p->ext_count == p->ext_size )
+  {
+    if( (ext = (unsigned char **)realloc( p->ext, (p->ext_size != 0 ? 2 * p->ext_size: 16) * sizeof( unsigned char * ) )) == NULL )
+      return NO_INDEX;
+    p->ext = ext;
+    p->ext_size = (p->ext_size != 0) ? 2 * p->ext_size: 16;
+  }
+  p->ext[ p->ext_count ] = s;
+  return p->ext_count++;
+}
+
+/*
+ * Locate added node with index \c i: returns its offset in chunk, and number of chunk in \c chunk.
+ * Chunk of nodes is preceded by pointer to instance and followed by user's pointers of its nodes.
+ */
+static size_t uxml_added_offset( uxml_index_t i, size_t *chunk )
+{
+  size_t a = i & ~ADDED_INDEX, c = 0;
+
+  while( a >= ((size_t)ADDED_CHUNK << c) )
+  {
+    a -= (size_t)ADDED_CHUNK << c;
+    c++;
+  }
+  *chunk = c;
+  return a;
+}
+
+static uxml_t *uxml_added_instance( const uxml_node_t *n )
+{
+  uxml_t *p;
+  size_t c;
+
+  memcpy( &p, (const unsigned char *)(n - uxml_added_offset( n->self, &c )) - sizeof( uxml_t * ), sizeof( uxml_t * ) );
+  return p;
+}
+
+/*
+ * Node with index \c i, which is linked to added node \c n, or added node, which is linked to parsed one
+ */
+static uxml_node_t *uxml_added_link( const uxml_node_t *n, uxml_index_t i )
+{
+  uxml_t *p = INSTANCE( n );
+  size_t c, a;
+
+  if( (i & ADDED_INDEX) == 0 )
+    return p->node + i;
+  a = uxml_added_offset( i, &c );
+  return p->added[c] + a;
+}
+
+/*
+ * Location of user's pointer of added node \c n
+ */
+static void **uxml_added_user( const uxml_node_t *n )
+{
+  size_t c, a = uxml_added_offset( n->self, &c );
+
+  return (void **)(n - a + ((size_t)ADDED_CHUNK << c)) + a;
+}
+
+/*
+ * Allocate node after parse, chunks are not moved, so nodes keep their addresses.
+ * Returns NULL if there is no memory, or too many nodes are added.
+ */
+static uxml_node_t *uxml_added_alloc( uxml_t *p )
+{
+  unsigned char *chunk;
+  uxml_node_t *n;
+  size_t c, a, size;
+
+  if( p->added_count == (size_t)ADDED_CHUNK * (((size_t)1 << ADDED_CHUNKS) - 1) )
+    return NULL;
+  if( p->added == NULL && (p->added = (uxml_node_t **)calloc( ADDED_CHUNKS, sizeof( uxml_node_t * ) )) == NULL )
+    return NULL;
+  if( (a = uxml_added_offset( (uxml_index_t)p->added_count, &c )) == 0 ) /* first node of next chunk */
+  {
+    size = (size_t)ADDED_CHUNK << c;
+    if( (chunk = uxml_arena_alloc( p, sizeof( uxml_t * ) + size * (sizeof( uxml_node_t ) + sizeof( void * )) )) == NULL )
+      return NULL;
+    memcpy( chunk, &p, sizeof( uxml_t * ) );
+    memset( chunk + sizeof( uxml_t * ) + size * sizeof( uxml_node_t ), 0, size * sizeof( void * ) );
+    p->added[c] = (uxml_node_t *)(chunk + sizeof( uxml_t * ));
+  }
+  n = p->added[c] + a;
+  memset( n, 0, sizeof( uxml_node_t ) );
+  n->self = (uxml_index_t)(ADDED_INDEX | p->added_count++);
+  return n;
+}
+#endif
+
+/*
+ * Hash of name, FNV-1a
+ */
+static unsigned int uxml_hash( const unsigned char *s, size_t n )
+{
+  unsigned int h = 2166136261U;
+  size_t i;
+
+  for( i = 0; i != n; i++ )
+  {
+    h = (h ^ s[i]) * 16777619U;
+  }
+  return h;
+}
+
+/*
+ * Find interned name, returns its ID, 0 - name is not interned
+ */
+static size_t uxml_find_name( const uxml_t *p, const unsigned char *s, size_t length, unsigned int hash )
+{
+  const uxml_symbol_t *name;
+  size_t i, id;
+
+  for( i = hash & p->names_mask; (id = p->names_hash[i]) != 0; i = (i + 1) & p->names_mask )
+  {
+    name = p->names + id;
+    if( name->hash == hash && name->length == length &&
+        memcmp( (name->copy != NULL) ? name->copy: p->text + name->name, s, length ) == 0 )
+      return id;
+  }
+  return 0;
+}
+
+/*
+ * Intern new name, which is located in text data.
+ * Hash table is kept half-empty at most, it grows twice with the table of names.
+ * Returns ID of name, 0 - there is no memory.
+ */
+static size_t uxml_add_name( uxml_t *p, size_t name, size_t length, unsigned int hash )
+{
+  uxml_symbol_t *names;
+  size_t *table, i, id, mask;
+
+  if( p->names_count == UINT_MAX )     /* IDs of names are 32-bit in nodes */
+    return 0;
+  if( p->names_count == p->names_size )
+  {
+    if( (names = (uxml_symbol_t *)realloc( p->names, 2 * p->names_size * sizeof( uxml_symbol_t ) )) == NULL )
+      return 0;
+    p->names = names;
+    p->names_size *= 2;
+  }
+  if( 2 * (p->names_count + 1) > p->names_mask + 1 )
+  {
+    mask = 2 * p->names_mask + 1;
+    if( (table = (size_t *)calloc( mask + 1, sizeof( size_t ) )) == NULL )
+      return 0;
+    for( id = 1; id != p->names_count; id++ )
+    {
+      for( i = p->names[ id ].hash & mask; table[i] != 0; i = (i + 1) & mask );
+      table[i] = id;
+    }
+    free( p->names_hash );
+    p->names_hash = table;
+    p->names_mask = mask;
+  }
+  id = p->names_count++;
+  p->names[ id ].name = name;
+  p->names[ id ].length = length;
+  p->names[ id ].hash = hash;
+  p->names[ id ].copy = NULL;
+  for( i = hash & p->names_mask; p->names_hash[i] != 0; i = (i + 1) & p->names_mask );
+  p->names_hash[i] = id;
+  return id;
+}
+
+/*
+ * Free the table of names
+ */
+static void uxml_free_names( uxml_t *p )
+{
+  free( p->names );
+  free( p->names_hash );
+  p->names = NULL;
+  p->names_hash = NULL;
+}
+
+/*
+ * Name of node \c i is over: terminate it and intern it.
+ * Name, which is interned already, is dropped from text data,
+ * node refers to its first copy.
+ */
+static int uxml_end_name( uxml_t *p, size_t i )
+{
+  const unsigned char *s = p->text + p->name_begin;
+  size_t length = p->text_index - p->name_begin, id;
+  unsigned int hash = uxml_hash( s, length );
+
+  p->text[ p->text_index++ ] = 0;
+  if( (id = uxml_find_name( p, s, length, hash )) != 0 )
+  {
+    p->text_index = p->name_begin;     /* drop the copy */
+  }
+  else if( (id = uxml_add_name( p, p->name_begin, length, hash )) == 0 )
+  {
+    p->error = "Insufficient memory";
+    return 0;
+  }
+#if defined( UXML_COMPACT )
+  p->node[i].name = (uxml_index_t)id;
+#else
+  p->node[i].name = p->text + p->names[ id ].name;
+  p->node[i].name_id = (unsigned int)id;
+#endif
+  return 1;
+}
+
+/*
+ * Get new node, its name begin at current text location
+ */
+static size_t uxml_new_node( uxml_t *p, int type, size_t parent )
+{
+  uxml_node_t *n;
+
+  if( p->node_index == p->nodes_size )
+  {
+    if( !uxml_grow_nodes( p ) )
+      return 0;
+  }
+  n = p->node + p->node_index;
+  n->type = type;                      /* type of node */
+  n->flags = 0;
+#if defined( UXML_COMPACT )
+  n->name = 0;                         /* name is not interned yet */
+#else
+  n->name = p->text + p->text_index;   /* name of node */
+  n->name_id = 0;
+#endif
+  p->name_begin = p->text_index;
+  n->content = TEXT_AT( p, 0 );        /* there is no content yet */
+  n->size = 0;                         /* size of content is 0 */
+#if defined( UXML_COMPACT )
+  n->self = (uxml_index_t)p->node_index;
+  n->parent = (uxml_index_t)parent;
+  n->child = 0;                        /* no child node(s) yet */
+  n->next = 0;                         /* no next node (yet) */
+#if !defined( UXML_DISABLE_PREV )
+  n->prev = 0;                         /* no previous node (yet) */
+#endif
+#else
+  n->instance = p;                     /* our instance */
+  n->parent = (parent != 0) ? p->node + parent: NULL;
+  n->child = NULL;                     /* no child node(s) yet */
+  n->next = NULL;                      /* no next node (yet) */
+#if !defined( UXML_DISABLE_PREV )
+  n->prev = NULL;                      /* no previous node (yet) */
+#endif
+  n->user = NULL;
+#endif
+  return p->node_index++;
+}
+
+/*
+ * Push new frame to the stack of open nodes
+ */
+static uxml_frame_t *uxml_push( uxml_t *p )
+{
+  uxml_frame_t *f;
+
+#if UXML_MAX_DEPTH != 0
+  if( p->depth >= UXML_MAX_DEPTH )
+  {
+    p->error = "Too deep nesting of nodes";
+    return NULL;
+  }
+#endif
+  if( p->depth == p->stack_size )
+  {
+    if( (f = (uxml_frame_t *)realloc( p->stack, 2 * p->stack_size * sizeof( uxml_frame_t ) )) == NULL )
+    {
+      p->error = "Insufficient memory";
+      return NULL;
+    }
+    p->stack = f;
+    p->stack_size *= 2;
+  }
+  f = p->stack + p->depth++;
+  f->state = p->state;                 /* keep current state */
+  f->name = p->xml_index - 1;          /* node's name - on step before */
+  f->name_len = 1;                     /* node's name length - 1 character at least */
+  return f;
+}
+
+/*
+ * Open new node, its first character of name is already read
+ */
+static size_t uxml_open_node( uxml_t *p )
+{
+  uxml_frame_t *f;
+  size_t i;
+
+  if( p->insitu && p->depth != 0 )
+  {
+    f = p->stack + p->depth - 1;
+    if( f->content_end != f->content_begin && f->content_end == p->text_index ) /* part of content stays at its place */
+    {
+      p->text[ p->text_index++ ] = 0;  /* terminate it, there is place of '<' */
+    }
+  }
+  if( (i = uxml_new_node( p, XML_NODE, p->depth != 0 ? p->stack[ p->depth - 1 ].node: 0 )) == 0 )
+    return 0;
+  if( (f = uxml_push( p )) == NULL )
+    return 0;
+
+  f->node = i;                         /* new current node */
+  f->last_child = 0;                   /* no children nodes yet */
+  f->content_begin = 0;
+  f->content_end = 0;
+  f->parts = NULL;
+  f->parts_size = 0;
+#if defined( UXML_COMPACT )
+  f->parts_ext = NO_INDEX;
+#endif
+  p->attr = 0;                         /* no attributes yet */
+
+  p->text[ p->text_index++ ] = p->xml[ p->xml_index - 1 ]; /* store first character of name */
+  p->state = NODE_NAME;                /* new state - read node name */
+  return i;
+}
+
+/*
+ * Refer to XML data instead of text data, where XML data has the same content of node \c i.
+ * \c content is location in XML data, NO_INDEX - there is no location.
+ * Names are not referred, they are interned.
+ */
+static void uxml_ref( uxml_t *p, size_t i, size_t content )
+{
+  uxml_node_t *n = p->node + i;
+
+  if( content != NO_INDEX && n->size != 0 && memcmp( CONTENT( p, n ), p->xml + content, n->size ) == 0 )
+  {
+    n->content = XML_AT( p, content );
+    n->flags |= CONTENT_REF;
+  }
+}
+
+/*
+ * In-situ parse: content, which is split by child nodes, can't be moved to the end of text data.
+ * Current part of content is joined to previous parts: first part stays at its place,
+ * next parts are joined in the arena. Next part continues at current text location.
+ */
+static int uxml_join_content( uxml_t *p, uxml_frame_t *f )
+{
+  unsigned char *s;
+  size_t k = f->content_end - f->content_begin;
+
+  if( k != 0 )
+  {
+    if( f->parts == NULL )
+    {
+      f->parts = p->text + f->content_begin;
+    }
+    else
+    {
+      if( (s = uxml_arena_alloc( p, f->parts_size + k + 1 )) == NULL )
+      {
+        p->error = "Insufficient memory";
+        return 0;
+      }
+      memcpy( s, f->parts, f->parts_size );
+      memcpy( s + f->parts_size, p->text + f->content_begin, k ); /* part begins with space, if needed */
+      s[ f->parts_size + k ] = 0;
+#if defined( UXML_COMPACT )
+      if( f->parts_ext == NO_INDEX && (f->parts_ext = uxml_ext( p, s )) == NO_INDEX )
+      {
+        p->error = "Insufficient memory";
+        return 0;
+      }
+      p->ext[ f->parts_ext ] = s;      /* one copy per node, it is replaced by longer one */
+#endif
+      f->parts = s;
+      k += f->parts_size;
+    }
+    f->parts_size = k;
+  }
+  if( f->parts != NULL )
+  {
+    f->content_begin = p->text_index;
+    f->content_end = p->text_index;
+  }
+  return 1;
+}
+
+/*
+ * Close current node, link it to parent node
+ */
+static int uxml_close_node( uxml_t *p )
+{
+  uxml_frame_t *f = p->stack + --p->depth, *parent;
+  size_t k;
+
+  p->node[ f->node ].content = TEXT_AT( p, f->content_begin );
+  if( f->parts != NULL )               /* in-situ content is split by child nodes */
+  {
+    if( !uxml_join_content( p, f ) )
+      return 0;
+#if defined( UXML_COMPACT )
+    if( f->parts_ext != NO_INDEX )
+    {
+      p->node[ f->node ].content = (uxml_index_t)f->parts_ext;
+      p->node[ f->node ].flags |= CONTENT_EXT;
+    }
+    else
+    {
+      p->node[ f->node ].content = TEXT_AT( p, f->parts - p->text );
+    }
+#else
+    p->node[ f->node ].content = f->parts;
+#endif
+  }
+  if( p->ref )
+  {
+    k = NO_INDEX;
+    if( p->node[ f->node ].size != 0 ) /* content may end before spaces and end tag only */
+    {
+      for( k = p->name_end - 2; k > 0 && isspace( p->xml[ k - 1 ] ); k-- );
+      k -= p->node[ f->node ].size;
+    }
+    uxml_ref( p, f->node, k );
+  }
+  p->state = f->state;                 /* restore outer state */
+  if( p->depth == 0 )                  /* root node is over */
+    return 1;
+
+  parent = f - 1;
+  if( LINK( p->node + parent->node, child ) == NULL ) /* if this is first child */
+  {
+    SET_LINK( p, p->node + parent->node, child, f->node ); /* parent will point to it */
+  }
+  if( parent->last_child != 0 )
+  {
+    SET_LINK( p, p->node + parent->last_child, next, f->node ); /* set-up next field of last child node */
+  }
+  SET_PREV( p, LINK( p->node + parent->node, child ), p->node + f->node, parent->last_child );
+  parent->last_child = f->node;        /* new last child */
+
+  if( p->insitu )
+  {
+    return uxml_join_content( p, parent );
+  }
+  if( (k = parent->content_end - parent->content_begin) != 0 ) /* if non-empty content */
+  {
+    if( !uxml_grow_text( p, k ) )      /* content will be moved, need more space */
+      return 0;
+    memcpy( p->text + p->text_index, p->text + parent->content_begin, k ); /* copy content to new location */
+    parent->content_begin = p->text_index; /* new content's begin location */
+    p->text_index += k;                /* go to the next character */
+    parent->content_end = p->text_index; /* new content's end location */
+  }
+  return 1;
+}
+
+/*
+ * Add new attribute to node or process instruction,
+ * first character of attribute's name is already read
+ */
+static size_t uxml_new_attr( uxml_t *p, size_t parent, int c0 )
+{
+  size_t i;
+
+  if( (i = uxml_new_node( p, XML_ATTR, parent )) == 0 )
+    return 0;
+  if( p->attr != 0 )                   /* if it is not first attribute */
+  {
+    SET_LINK( p, p->node + p->attr, next, i ); /* fill next of previous attribute */
+  }
+  else                                 /* no one attribute was parsed yet */
+  {
+    SET_LINK( p, p->node + parent, child, i ); /* store attribute index */
+  }
+  SET_PREV( p, LINK( p->node + parent, child ), p->node + i, p->attr );
+  p->attr = i;                         /* current node for attribute */
+  p->text[ p->text_index++ ] = c0;     /* store first character of attribute's name */
+  return i;
+}
+
+/*
+ * parse document: process instructions, comments and nodes, until the end of data.
+ * Open nodes are kept in the stack, so nesting is limited by memory only.
+ */
+static int uxml_parse_doc( uxml_t *p )
+{
+  uxml_frame_t *f = (p->depth != 0) ? p->stack + p->depth - 1: NULL; /* current open node */
+  size_t n;
+  int c0;
+
+  while( p->xml_index != p->xml_size ) /* can read new character? */
+  {
+    switch( p->state )                 /* jump to next structural character */
+    {
+    case NODE_NAME:
+      f->name_len += uxml_run( p, 1 );
+      break;
+    case NODE_ATTR_NAME:
+      uxml_run( p, 1 );
+      break;
+    case NODE_ATTR_VALUE_DQ:
+    case NODE_ATTR_VALUE_SQ:
+      p->node[ p->attr ].size += uxml_run( p, 1 );
+      break;
+    case NODE_CONTENT_TRIM:
+    case NODE_CONTENT:                 /* but not just after "<", "<!" or "<!-" */
+      if( (p->c & 0x000000FFU) != '<' &&
+          (p->c & 0x0000FFFFU) != (('<' << 8) | '!') &&
+          (p->c & 0x00FFFFFFU) != (('<' << 16) | ('!' << 8) | '-') )
+      {
+        if( (n = uxml_content_run( p, &f->content_begin )) != 0 )
+        {
+          p->node[ f->node ].size += n;
+          f->content_end = p->text_index;
+        }
+      }
+      break;
+    case COMMENT:
+      uxml_run( p, 0 );
+      break;
+    default:
+      break;
+    }
+    if( p->xml_index == p->xml_size )
+      break;
+    c0 = p->xml[ p->xml_index++ ];     /* get new character */
+    p->column++; 
+    p->c <<= 8;
+    p->escape <<= 1;
+    switch( c0 )
+    {
+    case '&':                    /* is there escape? */
+      if( (p->state & ENABLE_ESCAPE) != 0 ) /* escape sequences only in attribute value or the content */
+      {
+        if( (c0 = uxml_get_escape( p )) == 0 )
+          return 0;
+        p->escape |= 1;
+      }
+      break;
+    case '\n': p->column = 0; p->line++; break;
+    case '\r': p->column = 0; break;
+    default: break;
+    }
+    p->c |= c0;
+    if( p->state == NODE_NAME )        /* is name reading ? */
+    {
+      if( (p->c & 0x0000FFFFU) == (('/' << 8) | '>') )
+      {
+        if( !uxml_end_name( p, f->node ) )
+          return 0;
+        if( !uxml_close_node( p ) )    /* dispatch done */
+          return 0;
+        if( p->depth != 0 )
+          f--;                         /* parent node is current now */
+      }
+      else if( c0 == '/' )
+      {
+        continue;
+      }
+      else if( c0 == '>' )
+      {
+        if( !uxml_end_name( p, f->node ) )
+          return 0;
+        p->state = NODE_CONTENT_TRIM;  /* start content dispatch */
+      }
+      else if( !isspace( c0 ) )           /* non-space character? that is name */
+      {
+        p->text[ p->text_index++ ] = c0; /* store current character of name */
+        f->name_len++;                 /* length of node's name */
+      }
+      else                             /* name over */
+      {
+        if( !uxml_end_name( p, f->node ) )
+          return 0;
+        p->state = NODE_TAG;           /* go to read whole tag */
+      }
+    }
+    else if( p->state == NODE_TAG )
+    {
+      if( isalpha( c0 ) )            /* attribute begin with alphabet character? */
+      {
+        p->state = NODE_ATTR_NAME;     /* go to new state */
+        if( !uxml_new_attr( p, f->node, c0 ) )
+          return 0;
+        f->last_child = p->attr;       /* new last child */
+      }
+      else if( (p->c & 0x0000FFFFU) == (('/' << 8) | '>') )
+      {
+        if( !uxml_close_node( p ) )    /* dispatch done */
+          return 0;
+        if( p->depth != 0 )
+          f--;                         /* parent node is current now */
+      }
+      else if( c0 == '>' )           /* node tag over */
+      {
+        p->state = NODE_CONTENT_TRIM;  /* start content dispatch */
+      }
+      else if( !isspace( c0 ) && c0 != '/' )      /* all other non-spaced symbols (digits, specials) */
+      {
+        p->error = "Invalid character"; /* means error */
+        return 0;
+      }
+    }
+    else if( p->state == NODE_ATTR_NAME )
+    {
+      if( isspace( c0 ) )
+      {
+        p->state = NODE_ATTR_EQ;       /* new state */
+        if( !uxml_end_name( p, p->attr ) )
+          return 0;
+      }
+      else if( c0 == '=' )
+      {
+        p->state = NODE_ATTR_EQ_FOUND; /* new state */
+        if( !uxml_end_name( p, p->attr ) )
+          return 0;
+      }
+      else
+      {
+        p->text[ p->text_index++ ] = c0; /* store next character of attribute's name */
+      }
+    }
+    else if( p->state == NODE_ATTR_EQ )
+    {
+      if( c0 == '=' )
+      {
+        p->state = NODE_ATTR_EQ_FOUND;
+      }
+      else if( !isspace( c0 ) )
+      {
+        p->error = "Extra character after attribute's name";
+        return 0;
+      }
+    }
+    else if( p->state == NODE_ATTR_EQ_FOUND )
+    {
+      if( c0 == '\"' )               /* start attribute's value reading "value" */
+      {
+        p->state = NODE_ATTR_VALUE_DQ; /* double quoted value */
+        p->node[ p->attr ].content = TEXT_AT( p, p->text_index ); /* content points to attribute's value */
+      }
+      else if( c0 == '\'' )          /* start attribute's value reading 'value' */
+      {
+        p->state = NODE_ATTR_VALUE_SQ; /* single quoted value */
+        p->node[ p->attr ].content = TEXT_AT( p, p->text_index ); /* content points to attribute's value */
+      }
+      else if( !isspace( c0 ) )      /* error in other non-space character */
+      {
+        p->error = "Attribute value must begin with '\"' or '\''";
+        return 0;
+      }
+    }
+    else if( p->state == NODE_ATTR_VALUE_DQ )
+    {
+      if( c0 == '\"' && ((p->escape & 1) == 0) ) /* value ended? */
+      {
+        p->text[ p->text_index++ ] = 0; /* end value with zero byte */
+        p->state = NODE_TAG;           /* return to tag dispatch */
+        if( p->ref )
+        {
+          uxml_ref( p, p->attr, p->xml_index - 1 - p->node[ p->attr ].size );
+        }
+      }
+      else
+      {
+        p->text[ p->text_index++ ] = c0; /* store next value character */
+        p->node[ p->attr ].size++;
+      }
+    }
+    else if( p->state == NODE_ATTR_VALUE_SQ )
+    {
+      if( c0 == '\'' && ((p->escape & 1) == 0) ) /* value ended? */
+      {
+        p->text[ p->text_index++ ] = 0; /* end value with zero byte */
+        p->state = NODE_TAG;           /* return to tag dispatch */
+        if( p->ref )
+        {
+          uxml_ref( p, p->attr, p->xml_index - 1 - p->node[ p->attr ].size );
+        }
+      }
+      else
+      {
+        p->text[ p->text_index++ ] = c0; /* store next value character */
+        p->node[ p->attr ].size++;
+      }
+    }
+    else if( p->state == NODE_CONTENT_TRIM || p->state == NODE_CONTENT )
+    {
+      if( ( (p->c & 0x0000FFFFU) == (('<' << 8) | '!') && ((p->escape & 3) != 3) ) ||
+          ( (p->c & 0x00FFFFFFU) == (('<' << 16) | ('!' << 8) | '-') && ((p->escape & 7) != 7) ) )
+      {
+        continue;
+      }
+      if( ((p->c & 0x0000FF00U) == ('<' << 8)) && ((p->escape & 2) == 0) )
+      {
+        if( isalpha( c0 ) )          /* open new node? */
+        {
+          if( !uxml_open_node( p ) )
+            return 0;
+          f = p->stack + p->depth - 1;
+        }
+        else if( c0 == '/' && ((p->escape & 1) == 0) )
+        {
+          p->text[ p->text_index++ ] = 0; /* end content with zero byte */
+          p->name_end = 0;             /* end name is not found yet */
+          p->state = NODE_END;
+        }
+        else
+        {
+          p->error = "Invalid character";
+          return 0;
+        }
+      }
+      else if( p->c == (('<' << 24) | ('!' << 16) | ('-' << 8) | '-') && ((p->escape & 0xFU) != 0xFU) )
+      {
+        p->comment_state = p->state;   /* keep state before comment occured */
+        p->state = COMMENT;            /* comment in */
+      }
+      else if( c0 != '<' || (p->escape & 1) )           /* regular symbol of content */
+      {
+        if( p->state == NODE_CONTENT_TRIM )
+        {
+          if( !isspace( c0 ) )       /* non-space character? */
+          {
+            p->state = NODE_CONTENT;
+            if( f->content_begin != 0 )
+            {
+              p->text[ p->text_index++ ] = ' '; /* store one space instead several */
+              p->node[ f->node ].size++;
+            }
+            else
+            {
+              f->content_begin = p->text_index; /* the content begin. */
+            }
+            p->text[ p->text_index++ ] = c0; /* next character */
+            p->node[ f->node ].size++;
+            f->content_end = p->text_index; /* and content's end */
+          }
+        }
+        else                           /* need to read content */
+        {
+          if( isspace( c0 ) && ((p->escape & 1) == 0) )        /* all empty non-escaped characters will replaced with one space */
+          {
+            p->state = NODE_CONTENT_TRIM;
+          }
+          else
+          {
+            p->text[ p->text_index++ ] = c0; /* next character */
+            p->node[ f->node ].size++;
+            f->content_end = p->text_index; /* and content's end */
+          }
+        }
+      }
+    }
+    else if( p->state == COMMENT )     /* is there comments inside? */
+    {
+      if( (p->c & 0x00FFFFFFU) == (('-' << 16) | ('-' << 8) | '>') ) /* comment over? */
+      {
+        p->state = p->comment_state;   /* restore state */
+      }
+    }
+    else if( p->state == NODE_END )    /* node end tag */
+    {
+      if( p->name_end == 0 )           /* entry to end? */
+      {
+        p->name_end = p->xml_index - 1; /* keep end-name */
+      }
+      if( c0 == '>' )                /* node-end tag over? */
+      {
+        size_t i;
+
+        if( (p->xml_index - p->name_end - 1) != f->name_len )
+        {
+          p->error = "Different length of node's name";
+          return 0;
+        }
+        for( i = 0; i != f->name_len; i++ )
+        {
+          if( (p->insitu ? NAME( p, p->node + f->node )[i]: p->xml[ f->name + i ]) != p->xml[ p->name_end + i ] ) /* in-situ name is stored over XML data */
+          {
+            p->error = "Different name at end of node";
+            return 0;
+          }
+        }
+        if( !uxml_close_node( p ) )    /* dispatch done */
+          return 0;
+        if( p->depth != 0 )
+          f--;                         /* parent node is current now */
+      }
+    }
+    else if( p->state == NONE )
+    {
+      if( (p->c & 0x0000FF00U) == ('<' << 8) && isalpha( c0 ) )
+      {
+        if( p->root == 0 )
+        {
+          p->root = p->node_index;
+          if( !uxml_open_node( p ) )
+            return 0;
+          f = p->stack;
+        }
+        else
+        {
+          p->error = "Multiple root node";
+          return 0;
+        }
+      }
+      else if( (p->c & 0x0000FFFFU) == (('<' << 8) | '?') )
+      {
+        if( (p->inst = uxml_new_node( p, XML_INST, 0 )) == 0 )
+          return 0;
+        p->attr = 0;                   /* no attributes yet */
+        p->state = INST_NAME;          /* new state - read instruction name */
+      }
+      else if( p->c == (('<' << 24) | ('!' << 16) | ('-' << 8) | '-') )
+      {
+        p->comment_state = NONE;
+        p->state = COMMENT;
+      }
+      else if( !(( (p->c & 0x00FFFFFFU) == (('<' << 16) | ('!' << 8) | '-') ) ||
+                 ( (p->c & 0x0000FFFFU) == (('<' << 8) | '!') ) ||
+                 ( c0 == '<' )) )
+      {
+        if( !isspace( c0 ) )
+        {
+          p->error = "Unrelated character";
+          return 0;
+        }
+      }
+    }
+    else if( p->state == INST_NAME )   /* is name reading ? */
+    {
+      if( !isspace( c0 ) )           /* non-space character? that is name */
+      {
+        p->text[ p->text_index++ ] = c0; /* store current character of name */
+      }
+      else                             /* name over */
+      {
+        if( !uxml_end_name( p, p->inst ) )
+          return 0;
+        p->state = INST_TAG;           /* go to read whole tag */
+      }
+    }
+    else if( p->state == INST_TAG )
+    {
+      if( isalpha( c0 ) )            /* attribute begin with alphabet character? */
+      {
+        p->state = INST_ATTR_NAME;     /* go to new state */
+        if( !uxml_new_attr( p, p->inst, c0 ) )
+          return 0;
+      }
+      else if( (p->c & 0x0000FFFFU) == (('?' << 8) | '>') )
+      {
+        p->state = NONE;               /* dispatch done */
+      }
+      else if( !(c0 == '?') )
+      {
+        if( !isspace( c0 ) )
+        {
+          p->error = "Invalid character";
+          return 0;
+        }
+      }
+    }
+    else if( p->state == INST_ATTR_NAME )
+    {
+      if( isspace( c0 ) )           /* attribute's name end with '=' */
+      {
+        p->state = INST_ATTR_EQ;       /* new state */
+        if( !uxml_end_name( p, p->attr ) )
+          return 0;
+      }
+      else if( c0 == '=' )           /* attribute's name end with '=' */
+      {
+        p->state = INST_ATTR_EQ_FOUND; /* new state */
+        if( !uxml_end_name( p, p->attr ) )
+          return 0;
+      }
+      else                             /* all other characters means error */
+      {
+        p->text[ p->text_index++ ] = c0; /* store next character of attribute's name */
+      }
+    }
+    else if( p->state == INST_ATTR_EQ )
+    {
+      if( c0 == '=' )
+      {
+        p->state = INST_ATTR_EQ_FOUND;
+      }
+      else if( !isspace( c0 ) )
+      {
+        p->error = "Extra character after attribute's name";
+        return 0;
+      }
+    }
+    else if( p->state == INST_ATTR_EQ_FOUND )
+    {
+      if( c0 == '\"' )               /* start attribute's value reading "value" */
+      {
+        p->state = INST_ATTR_VALUE_DQ; /* double quoted value */
+        p->node[ p->attr ].content = TEXT_AT( p, p->text_index ); /* content points to attribute's value */
+      }
+      else if( c0 == '\'' )          /* start attribute's value reading 'value' */
+      {
+        p->state = INST_ATTR_VALUE_SQ; /* single quoted value */
+        p->node[ p->attr ].content = TEXT_AT( p, p->text_index ); /* content points to attribute's value */
+      }
+      else if( !isspace( c0 ) )      /* error in other non-space character */
+      {
+        p->error = "Attribute value must begin with '\"' or '\''";
+        return 0;
+      }
+    }
+    else if( p->state == INST_ATTR_VALUE_DQ )
+    {
+      if( c0 == '\"' && ((p->escape & 1) == 0) ) /* value ended? */
+      {
+        p->text[ p->text_index++ ] = 0; /* end value with zero byte */
+        p->state = INST_TAG;           /* return to tag dispatch */
+        if( p->ref )
+        {
+          uxml_ref( p, p->attr, p->xml_index - 1 - p->node[ p->attr ].size );
+        }
+      }
+      else
+      {
+        p->text[ p->text_index++ ] = c0; /* store next value character */
+        p->node[ p->attr ].size++;
+      }
+    }
+    else if( p->state == INST_ATTR_VALUE_SQ )
+    {
+      if( c0 == '\'' && ((p->escape & 1) == 0) ) /* value ended? */
+      {
+        p->text[ p->text_index++ ] = 0; /* end value with zero byte */
+        p->state = INST_TAG;           /* return to tag dispatch */
+        if( p->ref )
+        {
+          uxml_ref( p, p->attr, p->xml_index - 1 - p->node[ p->attr ].size );
+        }
+      }
+      else
+      {
+        p->text[ p->text_index++ ] = c0; /* store next value character */
+        p->node[ p->attr ].size++;
+      }
+    }
+  }
+  return 1;
+}
+
+/*
+ * Check state at end of XML data, returns error's text, or NULL if document is complete.
+ * Unterminated comment after root node is ignored.
+ */
+static const char *uxml_end_error( const uxml_t *p )
+{
+  if( p->depth != 0 )
+    return "Unterminated node";
+  switch( p->state & ~ENABLE_ESCAPE )
+  {
+  case INST_NAME:
+  case INST_TAG:
+  case INST_ATTR_NAME:
+  case INST_ATTR_EQ:
+  case INST_ATTR_EQ_FOUND:
+  case INST_ATTR_VALUE_DQ_0:
+  case INST_ATTR_VALUE_SQ_0:
+    return "Unterminated process instruction";
+  }
+  return (p->root == 0) ? "No root node": NULL;
+}
+
+/*
+ * Check, that whole document was parsed, returns index of root node
+ */
+static size_t uxml_parse_finish( uxml_t *p )
+{
+  p->error = uxml_end_error( p );
+  return (p->error == NULL) ? p->root: 0;
+}
+
+/*
+ * Fill error description, position is limited to the range of its fields
+ */
+static void uxml_error( uxml_t *p, uxml_error_t *error )
+{
+  if( error != NULL )
+  {
+    error->text = p->error;
+    error->line = (p->line < INT_MAX) ? (int)p->line: INT_MAX;
+    error->column = (p->column < INT_MAX) ? (int)p->column: INT_MAX;
+  }
+}
+
+/*
+ * Initialize parser's instance for XML data
+ */
+static void uxml_init( uxml_t *p, const char *xml_data, size_t xml_length )
+{
+  for( ; xml_length != 0 && xml_data[ xml_length - 1 ] == 0; xml_length-- );
+
+  p->xml = (const unsigned char *)xml_data;
+  p->xml_index = 0;
+  p->xml_size = xml_length;
+  p->state = NONE;
+  p->c = 0;
+  p->escape = 0;
+  p->line = 1;
+  p->column = 0;
+  p->error = NULL;
+  p->block_index = NO_INDEX;           /* no block indexed yet */
+  p->depth = 0;
+  p->stack_size = 16;
+  p->stack = NULL;
+  p->root = 0;
+  p->node = NULL;
+  p->insitu = 0;
+  p->ref = 0;
+  p->arena = NULL;
+  p->arena_index = 0;
+  p->arena_size = 0;
+  p->names = NULL;
+  p->names_hash = NULL;
+  p->children = NULL;
+  p->children_count = 0;
+  p->values = NULL;
+  p->modified = 0;
+  p->context = NULL;
+#if defined( UXML_COMPACT )
+  p->user = NULL;
+  p->ext = NULL;
+  p->ext_count = 0;
+  p->ext_size = 0;
+  p->added = NULL;
+  p->added_count = 0;
+#endif
+
+  if( p->xml_size >= 3 )               /* if we have 3 bytes at least, */
+  {                                    /* check for UTF-8 byte order mark */
+    if( p->xml[0] == 0xEF && p->xml[1] == 0xBB && p->xml[2] == 0xBF )
+    {
+      p->xml += 3;                     /* simple skip BOM */
+      p->xml_size -= 3;
+    }
+  }
+}
+
+/*
+ * Begin parse with allocated buffers: empty name, empty content and empty first node
+ */
+static void uxml_start( uxml_t *p )
+{
+  p->names[0].name = 0;                /* ID 0 - empty name at begin of text data */
+  p->names[0].length = 0;
+  p->names[0].hash = uxml_hash( NULL, 0 );
+  p->names[0].copy = NULL;
+  p->names_count = 1;
+  if( !p->insitu )
+  {
+    p->text[0] = 0;                    /* empty content */
+  }
+  memset( p->node, 0, sizeof( uxml_node_t ) ); /* first node is empty */
+  p->text_index = 1;
+  p->node_index = 1;
+}
+
+/*
+ * Count of nodes, which is enough for the rest of XML data: empty first node and every node,
+ * which may begin there, see uxml_count_nodes. Failed attribute without '=' is counted by margin.
+ */
+static size_t uxml_nodes_size( const uxml_t *p )
+{
+  return uxml_count_nodes( p->xml + p->xml_index, p->xml_size - p->xml_index ) + 3;
+}
+
+/*
+ * Allocate working buffers for the rest of XML data, array of nodes is allocated by caller.
+ * Single pass: text buffer is enough for whole XML data, array of nodes - for every node,
+ * both grow only if content of node is moved (see uxml_close_node) or nodes are miscounted.
+ * In-situ text data is XML data itself, it is already set,
+ * its first byte becomes empty content after parse.
+ */
+static int uxml_alloc( uxml_t *p )
+{
+#if defined( UXML_COMPACT )
+  if( p->xml_size > UXML_INDEX_MAX - 3 )
+  {
+    p->error = "Too large document for compact nodes";
+    return 0;
+  }
+#endif
+  p->text_size = (p->xml_size - p->xml_index) + 3;
+  if( !p->insitu )
+  {
+    p->text = (unsigned char *)malloc( p->text_size );
+  }
+  p->stack = (uxml_frame_t *)malloc( p->stack_size * sizeof( uxml_frame_t ) );
+  p->names_size = 64;
+  p->names_mask = 127;
+  p->names = (uxml_symbol_t *)malloc( p->names_size * sizeof( uxml_symbol_t ) );
+  p->names_hash = (size_t *)calloc( p->names_mask + 1, sizeof( size_t ) );
+  if( p->text == NULL || p->stack == NULL || p->names == NULL || p->names_hash == NULL )
+  {
+    if( !p->insitu )
+      free( p->text );
+    free( p->stack );
+    uxml_free_names( p );
+    p->text = NULL;
+    p->stack = NULL;
+    p->error = "Insufficient memory";
+    return 0;
+  }
+  uxml_start( p );
+  return 1;
+}
+
+/*
+ * Move array of nodes behind instance to new block of \c size nodes: array grew while parse,
+ * or it is too large. Old instance is freed.
+ * Returns new instance, or NULL if there is no memory.
+ */
+static uxml_t *uxml_pack_nodes( uxml_t *p, size_t size )
+{
+  uxml_t *t;
+
+  if( (t = (uxml_t *)malloc( sizeof( uxml_t ) + size * sizeof( uxml_node_t ) )) == NULL )
+    return NULL;
+  memcpy( t + 1, p->node, p->node_index * sizeof( uxml_node_t ) );
+  uxml_relocate( p, t, (uxml_node_t *)(t + 1), p->text );
+  if( p->node != (uxml_node_t *)(p + 1) )
+    free( p->node );
+  memcpy( t, p, sizeof( uxml_t ) );
+  free( p );
+  t->node = (uxml_node_t *)(t + 1);
+  t->nodes_size = size;
+  return t;
+}
+
+/*
+ * Copy interned names and contents, which don't refer to XML data, from text data of instance to new text data.
+ * Empty contents are pointed to empty string at begin of text data.
+ * If \c text is NULL, nothing is copied, size of new text data is calculated only.
+ * Returns size of new text data.
+ */
+static size_t uxml_ref_text( uxml_t *p, unsigned char *text )
+{
+  uxml_node_t *n;
+  size_t i, k = 1;
+
+  if( text != NULL )
+  {
+    text[0] = 0;                       /* empty content */
+  }
+  for( i = 1; i != p->names_count; i++ ) /* every name is copied once */
+  {
+    if( text != NULL )
+    {
+      memcpy( text + k, p->text + p->names[i].name, p->names[i].length );
+      text[ k + p->names[i].length ] = 0;
+      p->names[i].name = k;
+    }
+    k += p->names[i].length + 1;
+  }
+  for( i = 1, n = p->node + 1; i != p->node_index; i++, n++ )
+  {
+#if !defined( UXML_COMPACT )
+    if( text != NULL )
+    {
+      n->name = text + p->names[ n->name_id ].name;
+    }
+#endif
+    if( (n->flags & CONTENT_REF) == 0 )
+    {
+      if( n->size == 0 )
+      {
+        if( text != NULL )
+          n->content = TEXT_IN( text, 0 );
+      }
+      else
+      {
+        if( text != NULL )
+        {
+          memcpy( text + k, CONTENT( p, n ), n->size );
+          text[ k + n->size ] = 0;
+          n->content = TEXT_IN( text, k );
+        }
+        k += n->size + 1;
+      }
+    }
+  }
+  return k;
+}
+
+/*
+ * Parse XML data of initialized instance. Instance of tree is followed by its array of nodes,
+ * nodes are stored to their final place while parse, text data is allocated separately.
+ */
+static uxml_node_t *uxml_parse_tree( uxml_t *instance, uxml_error_t *error )
+{
+  uxml_t *p, *t;
+  unsigned char *text;
+  size_t root, texts, nodes = uxml_nodes_size( instance );
+
+  if( (p = (uxml_t *)malloc( sizeof( uxml_t ) + nodes * sizeof( uxml_node_t ) )) == NULL )
+  {
+    if( error != NULL )
+    {
+      error->text = "Insufficient memory";
+      error->line = error->column = 0;
+    }
+    return NULL;
+  }
+  memcpy( p, instance, sizeof( uxml_t ) );
+  p->node = (uxml_node_t *)(p + 1);
+  p->nodes_size = nodes;
+  if( !uxml_alloc( p ) )
+  {
+    if( error != NULL )
+    {
+      error->text = p->error;
+      error->line = error->column = 0;
+    }
+    free( p );
+    return NULL;
+  }
+
+  root = uxml_parse_doc( p ) ? uxml_parse_finish( p ): 0;
+  free( p->stack );                    /* open nodes are not needed anymore */
+  p->stack = NULL;
+  texts = p->text_index;
+  text = NULL;
+  if( root != 0 && (p->node != (uxml_node_t *)(p + 1) || p->nodes_size > 2 * p->node_index + 64) )
+  {                                    /* array grew, or there are many miscounted nodes */
+    if( (t = uxml_pack_nodes( p, p->node_index )) == NULL )
+      root = 0;
+    else
+      p = t;
+  }
+  if( root != 0 && p->ref )            /* only names and contents, which don't refer to XML data, are kept */
+  {
+    texts = uxml_ref_text( p, NULL );
+    if( (text = (unsigned char *)malloc( texts + 1 )) == NULL )
+      root = 0;
+  }
+  if( root == 0 )
+  {
+    if( p->error == NULL )
+    {
+      p->error = "Insufficient memory";
+      p->line = p->column = 0;
+    }
+    uxml_error( p, error );
+    if( !p->insitu )
+      free( p->text );
+    if( p->node != (uxml_node_t *)(p + 1) )
+      free( p->node );
+    uxml_free_arena( p );
+    uxml_free_names( p );
+    free( p );
+    return NULL;
+  }
+  if( p->insitu )
+  {
+    p->text[0] = 0;                    /* empty content */
+  }
+  else
+  {
+    if( p->ref )
+    {
+      uxml_ref_text( p, text );
+      free( p->text );
+      p->text = text;
+      p->text_size = texts + 1;
+    }
+    p->text[ texts ] = 0;
+  }
+
+  p->initial_allocated = sizeof( uxml_t ) + p->nodes_size * sizeof( uxml_node_t ) + (p->insitu ? 0: p->text_size) +
+                         p->names_size * sizeof( uxml_symbol_t ) + (p->names_mask + 1) * sizeof( size_t );
+  p->text_index = texts;
+  p->text_size = texts;
+  p->nodes_count = p->node_index;
+  p->nodes_size = p->node_index;
+  SET_LINK( p, p->node, next, root );
+  return p->node + root;
+}
+
+uxml_node_t *uxml_parse( const char *xml_data, const size_t xml_length, uxml_error_t *error )
+{
+  uxml_t instance;
+
+  uxml_init( &instance, xml_data, xml_length );
+  return uxml_parse_tree( &instance, error );
+}
+
+uxml_node_t *uxml_parse_ref( const char *xml_data, const size_t xml_length, uxml_error_t *error )
+{
+  uxml_t instance;
+
+  uxml_init( &instance, xml_data, xml_length );
+  instance.ref = 1;
+  return uxml_parse_tree( &instance, error );
+}
+
+uxml_node_t *uxml_parse_insitu( char *xml_data, const size_t xml_length, uxml_error_t *error )
+{
+  uxml_t instance;
+
+  uxml_init( &instance, xml_data, xml_length );
+  instance.insitu = 1;
+  instance.text = (unsigned char *)xml_data; /* before byte order mark, if any */
+  return uxml_parse_tree( &instance, error );
+}
+
+#if !defined( UXML_DISABLE_THREADS )
+
+/* part of XML data, which is parsed by own thread */
+typedef struct _uxml_part_t
+{
+  uxml_t p;                            /* parser of part */
+  int last;                            /* part contains end of document */
+  size_t name;                         /* name of root node in XML data */
+  size_t name_len;
+  uxml_t *tree;                        /* resulting tree, when part is moved to it */
+  size_t node_offset;                  /* location of part's nodes in tree */
+  size_t text_offset;                  /* location of part's text in tree */
+  size_t root;                         /* index of root node in tree */
+  size_t root_text;                    /* location of root's content in tree */
+  size_t content;                      /* location of part of root's content, NO_INDEX - no content */
+  size_t first;                        /* first child of root in part, 0 - no children */
+  size_t *remap;                       /* IDs of part's names in the tree, NULL - names are not merged yet */
+} uxml_part_t;
+
+/*
+ * Parse part of XML data, which begins with child node of root.
+ * The root node is substituted by node 1 of part, it is open already.
+ */
+static void uxml_parse_part( uxml_part_t *part )
+{
+  uxml_t *p = &part->p;
+  uxml_frame_t *f;
+
+  p->nodes_size = uxml_nodes_size( p );
+  if( (p->node = (uxml_node_t *)malloc( p->nodes_size * sizeof( uxml_node_t ) )) == NULL || !uxml_alloc( p ) )
+    return;
+  if( part->name != 0 )                /* not first part */
+  {
+    if( !uxml_new_node( p, XML_NODE, 0 ) || (f = uxml_push( p )) == NULL ) /* substitution of root node */
+      return;
+    f->node = 1;
+    f->state = NONE;
+    f->last_child = 0;
+    f->content_begin = 0;
+    f->content_end = 0;
+    f->name = part->name;
+    f->name_len = part->name_len;
+    f->parts = NULL;
+    f->parts_size = 0;
+#if defined( UXML_COMPACT )
+    f->parts_ext = NO_INDEX;
+#endif
+    p->root = 1;
+  }
+  if( uxml_parse_doc( p ) && part->last )
+  {
+    uxml_parse_finish( p );
+  }
+}
+
+/*
+ * Move nodes and text of part to the tree, convert pointers
+ */
+static void uxml_move_part( uxml_part_t *part )
+{
+  uxml_t *p = &part->p, *tree = part->tree;
+  uxml_node_t *n, *node = tree->node + part->node_offset;
+  unsigned char *text = tree->text + part->text_offset;
+  uxml_frame_t *f;
+  size_t i, first = (part->name != 0) ? 2: 1; /* node 1 of next parts is substitution of root */
+
+#if defined( UXML_COMPACT )
+#define UXML_PART_NODE( x ) ( ((x) == 0) ? 0: \
+  ((x) == 1 && first == 2) ? (uxml_index_t)part->root: (uxml_index_t)(part->node_offset + (x) - first) )
+#else
+#define UXML_PART_NODE( x ) ( ((x) == NULL) ? NULL: \
+  ((x) == p->node + 1 && first == 2) ? tree->node + part->root: node + ((x) - p->node - first) )
+#endif
+
+  memcpy( text, p->text, p->text_index );
+  if( part->content != NO_INDEX )      /* part of root's content */
+  {
+    f = p->stack;
+    if( part->content != 0 )
+    {
+      tree->text[ part->root_text + part->content - 1 ] = ' ';
+    }
+    memcpy( tree->text + part->root_text + part->content, p->text + f->content_begin, f->content_end - f->content_begin );
+  }
+  for( i = first, n = node; i != p->node_index; i++, n++ )
+  {
+    *n = p->node[i];
+#if defined( UXML_COMPACT )
+    n->self = (uxml_index_t)(part->node_offset + i - first);
+    n->content += (uxml_index_t)part->text_offset;
+#else
+    n->name = text + (n->name - p->text);
+    n->content = text + (n->content - p->text);
+    n->instance = tree;
+#endif
+    n->parent = UXML_PART_NODE( n->parent );
+    n->child = UXML_PART_NODE( n->child );
+    n->next = UXML_PART_NODE( n->next );
+#if !defined( UXML_DISABLE_PREV )
+    n->prev = UXML_PART_NODE( n->prev );
+#endif
+  }
+#undef UXML_PART_NODE
+  free( p->text );
+  free( p->node );
+  p->text = NULL;
+  p->node = NULL;
+}
+
+/*
+ * Convert IDs of names in moved part to IDs of the same names in the tree
+ */
+static void uxml_remap_part( uxml_part_t *part )
+{
+  uxml_node_t *n = part->tree->node + part->node_offset;
+  size_t i, count = part->p.node_index - 2; /* next parts only */
+
+  for( i = 0; i != count; i++, n++ )
+  {
+#if defined( UXML_COMPACT )
+    n->name = (uxml_index_t)part->remap[ n->name ];
+#else
+    n->name_id = (unsigned int)part->remap[ n->name_id ];
+#endif
+  }
+}
+
+/*
+ * Intern names of next parts to the tree, which has names of first part already
+ */
+static int uxml_merge_names( uxml_part_t *part, int n )
+{
+  uxml_t *p, *tree = part[0].tree;
+  uxml_symbol_t *name;
+  size_t id, k;
+  int i;
+
+  for( i = 1; i < n; i++ )
+  {
+    p = &part[i].p;
+    if( (part[i].remap = (size_t *)malloc( p->names_count * sizeof( size_t ) )) == NULL )
+      return 0;
+    part[i].remap[0] = 0;
+    for( id = 1; id != p->names_count; id++ )
+    {
+      name = p->names + id;
+      k = part[i].text_offset + name->name; /* name is moved to the tree already */
+      if( (part[i].remap[ id ] = uxml_find_name( tree, tree->text + k, name->length, name->hash )) == 0 &&
+          (part[i].remap[ id ] = uxml_add_name( tree, k, name->length, name->hash )) == 0 )
+        return 0;
+    }
+  }
+  return 1;
+}
+
+#if defined( _WIN32 )
+static DWORD WINAPI uxml_part_thread( LPVOID arg )
+#else
+static void *uxml_part_thread( void *arg )
+#endif
+{
+  uxml_part_t *part = (uxml_part_t *)arg;
+
+  if( part->tree == NULL )
+  {
+    uxml_parse_part( part );
+  }
+  else if( part->remap == NULL )
+  {
+    uxml_move_part( part );
+  }
+  else
+  {
+    uxml_remap_part( part );
+  }
+  return 0;
+}
+
+/*
+ * Run all parts in threads, first part is run in current thread
+ */
+static void uxml_run_parts( uxml_part_t *part, int n )
+{
+  int i;
+#if defined( _WIN32 )
+  HANDLE thread[ UXML_MAX_THREADS ];
+
+  for( i = 1; i < n; i++ )
+  {
+    if( (thread[i] = CreateThread( NULL, 0, uxml_part_thread, part + i, 0, NULL )) == NULL )
+      uxml_part_thread( part + i );    /* no thread, run it here */
+  }
+  uxml_part_thread( part );
+  for( i = 1; i < n; i++ )
+  {
+    if( thread[i] != NULL )
+    {
+      WaitForSingleObject( thread[i], INFINITE );
+      CloseHandle( thread[i] );
+    }
+  }
+#else
+  pthread_t thread[ UXML_MAX_THREADS ];
+  int started[ UXML_MAX_THREADS ];
+
+  for( i = 1; i < n; i++ )
+  {
+    if( !(started[i] = (pthread_create( thread + i, NULL, uxml_part_thread, part + i ) == 0)) )
+      uxml_part_thread( part + i );    /* no thread, run it here */
+  }
+  uxml_part_thread( part );
+  for( i = 1; i < n; i++ )
+  {
+    if( started[i] )
+      pthread_join( thread[i], NULL );
+  }
+#endif
+}
+
+/*
+ * Get name of node at \c i: name begins after '<', returns its length
+ */
+static size_t uxml_scan_name( const unsigned char *xml, size_t i, size_t size )
+{
+  size_t k;
+
+  for( k = i; k != size && !isspace( xml[k] ) && xml[k] != '>' && xml[k] != '/'; k++ );
+  return k - i;
+}
+
+/*
+ * Fast scan for next node begin from \c i, process instructions and comments are skipped.
+ * Returns index of '<', or NO_INDEX if there is no node.
+ */
+static size_t uxml_scan_node( const unsigned char *xml, size_t i, size_t size )
+{
+  const unsigned char *s;
+
+  for( ; (s = (const unsigned char *)memchr( xml + i, '<', size - i )) != NULL; i++ )
+  {
+    i = (size_t)(s - xml);
+    if( i + 1 == size )
+      break;
+    if( isalpha( xml[i+1] ) )
+      return i;
+    if( xml[i+1] == '?' )              /* skip process instruction */
+    {
+      for( i += 2; i + 1 < size && !(xml[i] == '?' && xml[i+1] == '>'); i++ );
+    }
+    else if( i + 3 < size && xml[i+1] == '!' && xml[i+2] == '-' && xml[i+3] == '-' ) /* skip comment */
+    {
+      for( i += 4; i + 2 < size && !(xml[i] == '-' && xml[i+1] == '-' && xml[i+2] == '>'); i++ );
+    }
+  }
+  return NO_INDEX;
+}
+
+uxml_node_t *uxml_parse_parallel( const char *xml_data, const size_t xml_length, const int threads, uxml_error_t *error )
+{
+  uxml_part_t part[ UXML_MAX_THREADS ];
+  uxml_t instance, *p = &instance, *tree;
+  uxml_node_t *root, *node;
+  const unsigned char *xml;
+  unsigned char *text;
+  size_t k, size, name, name_len, child, child_len, indent, nodes, texts, content, last;
+  int i, n;
+
+  uxml_init( p, xml_data, xml_length );
+  xml = p->xml;
+  size = p->xml_size;
+
+  /* boundary scan: root node, name and indent of its first child, */
+  /* then data is split at nodes with the same name and indent after space character */
+  n = (threads < UXML_MAX_THREADS) ? threads: UXML_MAX_THREADS;
+  if( (size_t)n > size / UXML_MIN_PART )
+  {
+    n = (int)(size / UXML_MIN_PART);
+  }
+  name = (n > 1) ? uxml_scan_node( xml, 0, size ): NO_INDEX;
+  child = (name != NO_INDEX) ? uxml_scan_node( xml, name + 1, size ): NO_INDEX;
+  if( child == NO_INDEX )
+    return uxml_parse( xml_data, xml_length, error );
+  for( indent = 0; child - indent > 0 && (xml[child-indent-1] == ' ' || xml[child-indent-1] == '\t'); indent++ );
+  if( child - indent == 0 || xml[child-indent-1] != '\n' ) /* first child is not indented */
+  {
+    indent = NO_INDEX;
+  }
+  name_len = uxml_scan_name( xml, ++name, size );
+  child_len = uxml_scan_name( xml, ++child, size );
+
+  memset( part, 0, sizeof( part ) );
+  for( i = 0, k = 0, last = child; i < n; i++ )
+  {
+    if( i != 0 )
+    {
+      k = (size_t)((double)size * i / n);
+      for( k = (k > last) ? k: last + 1; (k = uxml_scan_node( xml, k, size )) != NO_INDEX; k++ )
+      {
+        if( isspace( xml[k-1] ) && k + 1 + child_len < size &&
+            memcmp( xml + k + 1, xml + child, child_len ) == 0 &&
+            (isspace( xml[k+1+child_len] ) || xml[k+1+child_len] == '>' || xml[k+1+child_len] == '/') &&
+            (indent == NO_INDEX || (k - indent > last && xml[k-indent-1] == '\n' &&
+                            memcmp( xml + k - indent, xml + child - 1 - indent, indent ) == 0)) )
+          break;                       /* the same name and the same indent as first child */
+      }
+      if( k == NO_INDEX )              /* no more boundaries */
+        break;
+      last = k;
+      part[i-1].p.xml_size = k;
+      part[i].name = name;
+      part[i].name_len = name_len;
+      part[i].p.state = NODE_CONTENT_TRIM; /* part begins after space */
+      part[i].p.c = ((unsigned int)xml[k-3] << 16) | ((unsigned int)xml[k-2] << 8) | xml[k-1];
+    }
+    part[i].p.xml = xml;
+    part[i].p.xml_index = k;
+    part[i].p.xml_size = size;
+    part[i].p.line = 1;
+    part[i].p.block_index = NO_INDEX;  /* no block indexed yet */
+    part[i].p.stack_size = 16;
+  }
+  if( (n = i) < 2 )
+    return uxml_parse( xml_data, xml_length, error );
+  part[n-1].last = 1;
+
+  uxml_run_parts( part, n );
+
+  /* every part must finish at the content of root node, where next part begins */
+  for( i = 0, nodes = 1, texts = 0, content = 0; i < n; i++ )
+  {
+    p = &part[i].p;
+    if( p->error != NULL || p->stack == NULL ||
+        (!part[i].last && (p->depth != 1 || p->state != NODE_CONTENT_TRIM)) ||
+        (i == 0 && (p->stack[0].name != name || p->stack[0].name_len != name_len)) )
+      break;
+    part[i].node_offset = nodes;
+    part[i].text_offset = texts;
+    nodes += p->node_index - ((i != 0) ? 2: 1);
+    texts += p->text_index;
+    if( (k = p->stack[0].content_end - p->stack[0].content_begin) != 0 ) /* part of root's content */
+    {
+      content += (content != 0);       /* one space between parts */
+      part[i].content = content;
+      content += k;
+    }
+    else
+    {
+      part[i].content = NO_INDEX;
+    }
+    part[i].first = (i != 0 && LINK( p->node + 1, child ) != NULL) ? (size_t)(LINK( p->node + 1, child ) - p->node): 0;
+#if defined( UXML_COMPACT )
+    if( nodes > UXML_NODES_MAX || texts + content >= UXML_INDEX_MAX )
+      break;                           /* serial parse reports error */
+#endif
+  }
+  tree = NULL;
+  if( i != n || (tree = (uxml_t *)malloc( sizeof( uxml_t ) + nodes * sizeof( uxml_node_t ) )) == NULL ||
+      (text = (unsigned char *)malloc( texts + content + 1 )) == NULL )
+  {
+    free( tree );
+    for( i = 0; i < n; i++ )
+    {
+      free( part[i].p.text );
+      free( part[i].p.node );
+      free( part[i].p.stack );
+      uxml_free_names( &part[i].p );
+    }
+    return uxml_parse( xml_data, xml_length, error ); /* serial parse reports error, if any */
+  }
+
+  memcpy( tree, &part[0].p, sizeof( uxml_t ) );
+  tree->node = (uxml_node_t *)(tree + 1);
+  tree->text = text;
+  tree->node_index = tree->nodes_count = tree->nodes_size = nodes;
+  tree->text_index = tree->text_size = texts + content;
+  tree->initial_allocated = sizeof( uxml_t ) + nodes * sizeof( uxml_node_t ) + texts + content + 1;
+  tree->stack = NULL;
+  for( i = 0; i < n; i++ )
+  {
+    part[i].tree = tree;
+    part[i].root = part[0].p.root;
+    part[i].root_text = texts;
+  }
+  uxml_run_parts( part, n );           /* move parts to the tree in parallel */
+
+  /* names of all parts get IDs of the tree, first part has them already */
+  k = uxml_merge_names( part, n );
+  if( k )
+  {
+    uxml_run_parts( part + 1, n - 1 );
+  }
+  for( i = 1; i < n; i++ )
+  {
+    free( part[i].remap );
+    uxml_free_names( &part[i].p );
+  }
+  if( !k )
+  {
+    for( i = 0; i < n; i++ )
+    {
+      free( part[i].p.stack );
+    }
+    uxml_free_arena( tree );
+    uxml_free_names( tree );
+    free( tree->text );
+    free( tree );
+    return uxml_parse( xml_data, xml_length, error );
+  }
+  tree->initial_allocated += tree->names_size * sizeof( uxml_symbol_t ) + (tree->names_mask + 1) * sizeof( size_t );
+
+  /* stitch: link children of root from all parts */
+  root = tree->node + part[0].p.root;
+  last = part[0].p.stack[0].last_child;
+  for( i = 1; i < n; i++ )
+  {
+    if( part[i].first != 0 )           /* part has children of root */
+    {
+      node = tree->node + part[i].node_offset + part[i].first - 2;
+      if( LINK( root, child ) == NULL )
+      {
+        SET_LINK( tree, root, child, node - tree->node );
+      }
+      if( last != 0 )
+      {
+        SET_LINK( tree, tree->node + last, next, node - tree->node );
+      }
+      SET_PREV( tree, LINK( root, child ), node, last );
+      last = part[i].node_offset + part[i].p.stack[0].last_child - 2;
+    }
+  }
+#if !defined( UXML_DISABLE_PREV )
+  if( last != 0 )                      /* first child of root refers to the last one of last part */
+  {
+    SET_LINK( tree, LINK( root, child ), prev, last );
+  }
+#endif
+  for( i = 0; i < n; i++ )
+  {
+    free( part[i].p.stack );
+  }
+  memset( tree->node, 0, sizeof( uxml_node_t ) ); /* first node is empty */
+  root->content = TEXT_AT( tree, texts );
+  root->size = content;
+  tree->text[ texts + content ] = 0;
+  SET_LINK( tree, tree->node, next, root - tree->node );
+  return root;
+}
+
+#endif
+
+/*
+ * Reserve place in reader's buffer for extra bytes after current location and zero byte
+ */
+static int uxml_read_reserve( uxml_t *p, size_t extra )
+{
+  unsigned char *text;
+  size_t size = p->text_size;
+
+  while( size < p->text_index + extra + 1 )
+  {
+    size *= 2;
+  }
+  if( size != p->text_size )
+  {
+    if( (text = (unsigned char *)realloc( p->text, size )) == NULL )
+    {
+      p->error = "Insufficient memory";
+      return 0;
+    }
+    p->text = text;
+    p->text_size = size;
+  }
+  return 1;
+}
+
+/*
+ * Store characters of name, value or content to reader's buffer
+ */
+static int uxml_read_store( uxml_t *p, const unsigned char *s, size_t n )
+{
+  if( p->text_index + n + 1 > p->text_size && !uxml_read_reserve( p, n ) )
+    return 0;
+  memcpy( p->text + p->text_index, s, n );
+  p->text_index += n;
+  return 1;
+}
+
+/*
+ * Pass name of node or process instruction to reader's callback
+ */
+static int uxml_read_name( uxml_t *p, int (*callback)( void *user, const char *name ), size_t name )
+{
+  p->text[ p->text_index ] = 0;        /* end name with zero-byte */
+  if( callback != NULL && !callback( p->reader->user, (const char *)p->text + name ) )
+  {
+    if( p->error == NULL )
+      p->error = "Stopped by reader";
+    return 0;
+  }
+  return 1;
+}
+
+/*
+ * Pass stored attribute to reader's callback
+ */
+static int uxml_read_attr( uxml_t *p )
+{
+  uxml_reader_t *r = p->reader;
+
+  p->text[ p->text_index ] = 0;        /* end value with zero-byte */
+  if( r->attr != NULL &&
+      !r->attr( r->user, (const char *)p->text + p->token, (const char *)p->text + p->value, p->text_index - p->value ) )
+  {
+    if( p->error == NULL )
+      p->error = "Stopped by reader";
+    return 0;
+  }
+  p->text_index = p->token;
+  return 1;
+}
+
+/*
+ * Pass stored content to reader's callback
+ */
+static int uxml_read_flush( uxml_t *p )
+{
+  uxml_reader_t *r = p->reader;
+
+  if( p->text_index != p->token )
+  {
+    p->text[ p->text_index ] = 0;      /* end content with zero-byte */
+    if( r->text != NULL && !r->text( r->user, (const char *)p->text + p->token, p->text_index - p->token ) )
+    {
+      if( p->error == NULL )
+        p->error = "Stopped by reader";
+      return 0;
+    }
+    p->text_index = p->token;
+  }
+  return 1;
+}
+
+/*
+ * Store characters of content, full buffer is passed to reader
+ */
+static int uxml_read_content( uxml_t *p, const unsigned char *s, size_t n )
+{
+  size_t k;
+
+  if( (p->skip & SKIP_CONTENT) != 0 )  /* content is not needed, it isn't copied */
+    return 1;
+  while( n != 0 )
+  {
+    if( p->text_index - p->token >= UXML_READER_BUFFER - 1 )
+    {
+      if( !uxml_read_flush( p ) )
+        return 0;
+    }
+    k = UXML_READER_BUFFER - 1 - (p->text_index - p->token);
+    if( k > n )
+    {
+      k = n;
+    }
+    if( !uxml_read_store( p, s, k ) )
+      return 0;
+    s += k;
+    n -= k;
+  }
+  return 1;
+}
+
+/*
+ * Store characters of attribute's value, unless they are not needed
+ */
+static int uxml_read_value( uxml_t *p, const unsigned char *s, size_t n )
+{
+  return (p->skip & SKIP_VALUE) != 0 || uxml_read_store( p, s, n );
+}
+
+/*
+ * Open new node, its first character of name is already read.
+ * Names of open nodes are kept in reader's buffer, current token follows them.
+ */
+static uxml_frame_t *uxml_read_open( uxml_t *p )
+{
+  uxml_frame_t *f;
+
+  if( (f = uxml_push( p )) == NULL )
+    return NULL;
+  f->name = p->text_index;             /* node's name in buffer */
+  if( !uxml_read_store( p, p->xml + p->xml_index - 1, 1 ) ) /* store first character of name */
+    return NULL;
+  p->state = NODE_NAME;
+  return f;
+}
+
+/*
+ * Name of node is over, pass it to reader and keep it until the end of node
+ */
+static int uxml_read_start( uxml_t *p, uxml_frame_t *f )
+{
+  if( !uxml_read_name( p, p->reader->start, f->name ) )
+    return 0;
+  p->token = ++p->text_index;          /* skip zero-byte */
+  return 1;
+}
+
+/*
+ * Close current node, pass its name to reader's callback
+ */
+static int uxml_read_end( uxml_t *p )
+{
+  uxml_frame_t *f = p->stack + --p->depth;
+
+  p->state = f->state;                 /* restore outer state */
+  p->text_index = f->name + f->name_len;
+  if( !uxml_read_name( p, p->reader->end, f->name ) )
+    return 0;
+  p->token = p->text_index = f->name;  /* name is not needed anymore */
+  return 1;
+}
+
+/*
+ * Get next character for reader.
+ * Escape sequence may be split between parts of data, it is collected then.
+ * Returns character, or -1 in case of error or when more data is needed
+ */
+static int uxml_read_char( uxml_t *p )
+{
+  const unsigned char *s, *xml;
+  size_t n, xml_size;
+  int c0;
+
+  if( p->esc_len == 0 )                /* no escape sequence in progress */
+  {
+    c0 = p->xml[ p->xml_index++ ];     /* get new character */
+    p->column++; 
+    p->c <<= 8;
+    p->escape <<= 1;
+    switch( c0 )
+    {
+    case '&':                    /* is there escape? */
+      if( (p->state & ENABLE_ESCAPE) != 0 ) /* escape sequences only in attribute value or the content */
+      {
+        p->esc_len = 1;
+        break;
+      }
+      p->c |= c0;
+      return c0;
+    case '\n': p->column = 0; p->line++; p->c |= c0; return c0;
+    case '\r': p->column = 0; p->c |= c0; return c0;
+    default: p->c |= c0; return c0;
+    }
+  }
+  s = (const unsigned char *)memchr( p->xml + p->xml_index, ';', p->xml_size - p->xml_index );
+  if( p->esc_len == 1 && (s != NULL || p->final) ) /* whole escape sequence is here */
+  {
+    c0 = uxml_get_escape( p );
+  }
+  else                                 /* collect escape sequence after current token */
+  {
+    n = (s != NULL) ? (size_t)(s - p->xml - p->xml_index) + 1: p->xml_size - p->xml_index;
+    if( !uxml_read_reserve( p, p->esc_len - 1 + n ) )
+      return -1;
+    memcpy( p->text + p->text_index + p->esc_len - 1, p->xml + p->xml_index, n );
+    p->esc_len += n;
+    p->xml_index += n;
+    if( s == NULL )
+      return -1;                       /* wait for next part of data */
+    xml = p->xml;                      /* decode collected sequence */
+    xml_size = p->xml_size;
+    n = p->xml_index;
+    p->xml = p->text + p->text_index;
+    p->xml_index = 0;
+    p->xml_size = p->esc_len - 1;
+    c0 = uxml_get_escape( p );
+    p->xml = xml;
+    p->xml_size = xml_size;
+    p->xml_index = n;
+  }
+  p->esc_len = 0;
+  if( c0 == 0 )
+    return -1;
+  p->escape |= 1;
+  p->c |= c0;
+  return c0;
+}
+
+/*
+ * read document: same states as uxml_parse_doc, but nodes are passed to the reader
+ * and only names of open nodes and current name, attribute or part of content are stored.
+ * Parsing is stopped at the end of data and may be continued with next part of data.
+ */
+static int uxml_read_doc( uxml_t *p )
+{
+  uxml_frame_t *f = (p->depth != 0) ? p->stack + p->depth - 1: NULL; /* current open node */
+  size_t n;
+  int c0;
+  unsigned char ch;
+
+  while( p->xml_index != p->xml_size ) /* can read new character? */
+  {
+    switch( (p->esc_len == 0) ? p->state: NONE ) /* jump to next structural character */
+    {
+    case NODE_NAME:
+    case NODE_ATTR_NAME:
+    case NODE_ATTR_VALUE_DQ:
+    case NODE_ATTR_VALUE_SQ:
+    case NODE_END:
+      if( (n = uxml_run( p, 0 )) != 0 )
+      {
+        if( (p->state == NODE_ATTR_VALUE_DQ || p->state == NODE_ATTR_VALUE_SQ) ?
+            !uxml_read_value( p, p->xml + p->xml_index - n, n ): !uxml_read_store( p, p->xml + p->xml_index - n, n ) )
+          return 0;
+        if( p->state == NODE_NAME )
+        {
+          f->name_len += n;
+        }
+      }
+      break;
+    case NODE_CONTENT:                 /* but not just after "<", "<!" or "<!-" */
+      if( (p->c & 0x000000FFU) != '<' &&
+          (p->c & 0x0000FFFFU) != (('<' << 8) | '!') &&
+          (p->c & 0x00FFFFFFU) != (('<' << 16) | ('!' << 8) | '-') )
+      {
+        if( (n = uxml_run( p, 0 )) != 0 && !uxml_read_content( p, p->xml + p->xml_index - n, n ) )
+          return 0;
+      }
+      break;
+    case COMMENT:
+      uxml_run( p, 0 );
+      break;
+    default:
+      break;
+    }
+    if( p->xml_index == p->xml_size )
+      break;
+    if( (c0 = uxml_read_char( p )) < 0 )
+    {
+      if( p->error != NULL )
+        return 0;
+      break;                           /* escape sequence is continued in next part of data */
+    }
+    ch = (unsigned char)c0;
+    if( p->state == NODE_NAME )        /* is name reading ? */
+    {
+      if( (p->c & 0x0000FFFFU) == (('/' << 8) | '>') )
+      {
+        if( !uxml_read_start( p, f ) || !uxml_read_end( p ) )
+          return 0;
+        if( p->depth != 0 )
+          f--;                         /* parent node is current now */
+      }
+      else if( c0 == '/' )
+      {
+        continue;
+      }
+      else if( c0 == '>' )
+      {
+        if( !uxml_read_start( p, f ) )
+          return 0;
+        p->state = NODE_CONTENT_TRIM;  /* start content dispatch */
+        p->words = 0;
+      }
+      else if( !isspace( c0 ) )           /* non-space character? that is name */
+      {
+        if( !uxml_read_store( p, &ch, 1 ) )
+          return 0;
+        f->name_len++;                 /* length of node's name */
+      }
+      else                             /* name over */
+      {
+        if( !uxml_read_start( p, f ) )
+          return 0;
+        p->state = NODE_TAG;           /* go to read whole tag */
+      }
+    }
+    else if( p->state == NODE_TAG || p->state == INST_TAG )
+    {
+      if( isalpha( c0 ) )            /* attribute begin with alphabet character? */
+      {
+        p->state = (p->state == NODE_TAG) ? NODE_ATTR_NAME: INST_ATTR_NAME;
+        if( !uxml_read_store( p, &ch, 1 ) )
+          return 0;
+      }
+      else if( p->state == INST_TAG )
+      {
+        if( (p->c & 0x0000FFFFU) == (('?' << 8) | '>') )
+        {
+          p->state = NONE;             /* dispatch done */
+        }
+        else if( c0 != '?' && !isspace( c0 ) )
+        {
+          p->error = "Invalid character";
+          return 0;
+        }
+      }
+      else if( (p->c & 0x0000FFFFU) == (('/' << 8) | '>') )
+      {
+        if( !uxml_read_end( p ) )      /* dispatch done */
+          return 0;
+        if( p->depth != 0 )
+          f--;                         /* parent node is current now */
+      }
+      else if( c0 == '>' )           /* node tag over */
+      {
+        p->state = NODE_CONTENT_TRIM;  /* start content dispatch */
+        p->words = 0;
+      }
+      else if( !isspace( c0 ) && c0 != '/' )      /* all other non-spaced symbols (digits, specials) */
+      {
+        p->error = "Invalid character"; /* means error */
+        return 0;
+      }
+    }
+    else if( p->state == NODE_ATTR_NAME || p->state == INST_ATTR_NAME )
+    {
+      if( isspace( c0 ) || c0 == '=' )
+      {
+        if( p->state == NODE_ATTR_NAME )
+        {
+          p->state = (c0 == '=') ? NODE_ATTR_EQ_FOUND: NODE_ATTR_EQ;
+        }
+        else
+        {
+          p->state = (c0 == '=') ? INST_ATTR_EQ_FOUND: INST_ATTR_EQ;
+        }
+        ch = 0;                        /* end name with zero byte */
+        p->value = p->text_index + 1;  /* value will follow the name */
+      }
+      if( !uxml_read_store( p, &ch, 1 ) )
+        return 0;
+    }
+    else if( p->state == NODE_ATTR_EQ || p->state == INST_ATTR_EQ )
+    {
+      if( c0 == '=' )
+      {
+        p->state = (p->state == NODE_ATTR_EQ) ? NODE_ATTR_EQ_FOUND: INST_ATTR_EQ_FOUND;
+      }
+      else if( !isspace( c0 ) )
+      {
+        p->error = "Extra character after attribute's name";
+        return 0;
+      }
+    }
+    else if( p->state == NODE_ATTR_EQ_FOUND || p->state == INST_ATTR_EQ_FOUND )
+    {
+      if( c0 == '\"' )               /* start attribute's value reading "value" */
+      {
+        p->state = (p->state == NODE_ATTR_EQ_FOUND) ? NODE_ATTR_VALUE_DQ: INST_ATTR_VALUE_DQ;
+      }
+      else if( c0 == '\'' )          /* start attribute's value reading 'value' */
+      {
+        p->state = (p->state == NODE_ATTR_EQ_FOUND) ? NODE_ATTR_VALUE_SQ: INST_ATTR_VALUE_SQ;
+      }
+      else if( !isspace( c0 ) )      /* error in other non-space character */
+      {
+        p->error = "Attribute value must begin with '\"' or '\''";
+        return 0;
+      }
+    }
+    else if( p->state == NODE_ATTR_VALUE_DQ || p->state == NODE_ATTR_VALUE_SQ ||
+             p->state == INST_ATTR_VALUE_DQ || p->state == INST_ATTR_VALUE_SQ )
+    {
+      if( c0 == ((p->state == NODE_ATTR_VALUE_DQ || p->state == INST_ATTR_VALUE_DQ) ? '\"': '\'') &&
+          ((p->escape & 1) == 0) )     /* value ended? */
+      {
+        if( !uxml_read_attr( p ) )
+          return 0;
+        p->state = (p->state == NODE_ATTR_VALUE_DQ || p->state == NODE_ATTR_VALUE_SQ) ? NODE_TAG: INST_TAG;
+      }
+      else if( !uxml_read_value( p, &ch, 1 ) ) /* store next value character */
+      {
+        return 0;
+      }
+    }
+    else if( p->state == NODE_CONTENT_TRIM || p->state == NODE_CONTENT )
+    {
+      if( ( (p->c & 0x0000FFFFU) == (('<' << 8) | '!') && ((p->escape & 3) != 3) ) ||
+          ( (p->c & 0x00FFFFFFU) == (('<' << 16) | ('!' << 8) | '-') && ((p->escape & 7) != 7) ) )
+      {
+        continue;
+      }
+      if( ((p->c & 0x0000FF00U) == ('<' << 8)) && ((p->escape & 2) == 0) )
+      {
+        if( isalpha( c0 ) )          /* open new node? */
+        {
+          if( !uxml_read_flush( p ) || (f = uxml_read_open( p )) == NULL )
+            return 0;
+          p->words = 0;                /* content after child node is passed separately */
+        }
+        else if( c0 == '/' && ((p->escape & 1) == 0) )
+        {
+          if( !uxml_read_flush( p ) )
+            return 0;
+          p->state = NODE_END;
+        }
+        else
+        {
+          p->error = "Invalid character";
+          return 0;
+        }
+      }
+      else if( p->c == (('<' << 24) | ('!' << 16) | ('-' << 8) | '-') && ((p->escape & 0xFU) != 0xFU) )
+      {
+        p->comment_state = p->state;   /* keep state before comment occured */
+        p->state = COMMENT;            /* comment in */
+      }
+      else if( c0 != '<' || (p->escape & 1) )           /* regular symbol of content */
+      {
+        if( p->state == NODE_CONTENT_TRIM )
+        {
+          if( !isspace( c0 ) )       /* non-space character? */
+          {
+            p->state = NODE_CONTENT;
+            if( p->words && !uxml_read_content( p, (const unsigned char *)" ", 1 ) ) /* store one space instead several */
+              return 0;
+            if( !uxml_read_content( p, &ch, 1 ) )
+              return 0;
+            p->words = 1;
+          }
+        }
+        else                           /* need to read content */
+        {
+          if( isspace( c0 ) && ((p->escape & 1) == 0) )        /* all empty non-escaped characters will replaced with one space */
+          {
+            p->state = NODE_CONTENT_TRIM;
+          }
+          else if( !uxml_read_content( p, &ch, 1 ) )
+          {
+            return 0;
+          }
+        }
+      }
+    }
+    else if( p->state == COMMENT )     /* is there comments inside? */
+    {
+      if( (p->c & 0x00FFFFFFU) == (('-' << 16) | ('-' << 8) | '>') ) /* comment over? */
+      {
+        p->state = p->comment_state;   /* restore state */
+      }
+    }
+    else if( p->state == NODE_END )    /* node end tag, its name is stored like token */
+    {
+      if( c0 == '>' )                /* node-end tag over? */
+      {
+        if( p->text_index - p->token != f->name_len )
+        {
+          p->error = "Different length of node's name";
+          return 0;
+        }
+        if( memcmp( p->text + f->name, p->text + p->token, f->name_len ) != 0 )
+        {
+          p->error = "Different name at end of node";
+          return 0;
+        }
+        if( !uxml_read_end( p ) )      /* dispatch done */
+          return 0;
+        if( p->depth != 0 )
+          f--;                         /* parent node is current now */
+      }
+      else if( !uxml_read_store( p, &ch, 1 ) )
+      {
+        return 0;
+      }
+    }
+    else if( p->state == NONE )
+    {
+      if( (p->c & 0x0000FF00U) == ('<' << 8) && isalpha( c0 ) )
+      {
+        if( p->root != 0 )
+        {
+          p->error = "Multiple root node";
+          return 0;
+        }
+        p->root = 1;
+        if( (f = uxml_read_open( p )) == NULL )
+          return 0;
+      }
+      else if( (p->c & 0x0000FFFFU) == (('<' << 8) | '?') )
+      {
+        p->state = INST_NAME;          /* new state - read instruction name */
+      }
+      else if( p->c == (('<' << 24) | ('!' << 16) | ('-' << 8) | '-') )
+      {
+        p->comment_state = NONE;
+        p->state = COMMENT;
+      }
+      else if( !(( (p->c & 0x00FFFFFFU) == (('<' << 16) | ('!' << 8) | '-') ) ||
+                 ( (p->c & 0x0000FFFFU) == (('<' << 8) | '!') ) ||
+                 ( c0 == '<' )) )
+      {
+        if( !isspace( c0 ) )
+        {
+          p->error = "Unrelated character";
+          return 0;
+        }
+      }
+    }
+    else if( p->state == INST_NAME )   /* is name reading ? */
+    {
+      if( !isspace( c0 ) )           /* non-space character? that is name */
+      {
+        if( !uxml_read_store( p, &ch, 1 ) )
+          return 0;
+      }
+      else                             /* name over */
+      {
+        if( !uxml_read_name( p, p->reader->inst, p->token ) )
+          return 0;
+        p->text_index = p->token;
+        p->state = INST_TAG;           /* go to read whole tag */
+      }
+    }
+  }
+  return 1;
+}
+
+/*
+ * Check, that whole document was read
+ */
+static int uxml_read_finish( uxml_t *p )
+{
+  if( p->error == NULL )
+  {
+    if( p->esc_len != 0 )
+    {
+      p->column += p->esc_len - 1;     /* collected characters */
+      p->error = "Unterminated escape";
+    }
+    else
+    {
+      p->error = uxml_end_error( p );
+    }
+  }
+  return p->error == NULL;
+}
+
+/*
+ * Prepare reader's instance, XML data is set by caller
+ */
+static int uxml_read_init( uxml_t *p, uxml_reader_t *reader )
+{
+  p->reader = reader;
+  p->token = 0;
+  p->words = 0;
+  p->skip = 0;
+  p->esc_len = 0;
+  p->text_index = 0;
+  p->text_size = UXML_READER_BUFFER;
+  p->text = (unsigned char *)malloc( p->text_size );
+  p->stack = (uxml_frame_t *)malloc( p->stack_size * sizeof( uxml_frame_t ) );
+  if( p->text == NULL || p->stack == NULL )
+  {
+    free( p->text );
+    free( p->stack );
+    p->error = "Insufficient memory";
+    return 0;
+  }
+  return 1;
+}
+
+int uxml_read( const char *xml_data, const size_t xml_length, uxml_reader_t *reader, uxml_error_t *error )
+{
+  uxml_t instance, *p = &instance;
+
+  uxml_init( p, xml_data, xml_length );
+  p->final = 1;                        /* whole XML data is here */
+  if( !uxml_read_init( p, reader ) )
+  {
+    uxml_error( p, error );
+    return 0;
+  }
+  if( !uxml_read_doc( p ) || !uxml_read_finish( p ) )
+  {
+    uxml_error( p, error );
+  }
+  free( p->text );
+  free( p->stack );
+  return p->error == NULL;
+}
+
+uxml_parser_t *uxml_parser_create( uxml_reader_t *reader )
+{
+  uxml_t *p;
+
+  if( (p = (uxml_t *)malloc( sizeof( uxml_t ) )) == NULL )
+    return NULL;
+  uxml_init( p, "", 0 );
+  p->final = 0;                        /* XML data will be passed by parts */
+  p->bom = 0;                          /* byte order mark is not checked yet */
+  p->zeros = 0;
+  if( !uxml_read_init( p, reader ) )
+  {
+    free( p );
+    return NULL;
+  }
+  return p;
+}
+
+/*
+ * Read part of XML data
+ */
+static int uxml_parser_part( uxml_parser_t *p, const char *data, const size_t length, uxml_error_t *error )
+{
+  p->xml = (const unsigned char *)data;
+  p->xml_index = 0;
+  p->xml_size = length;
+  p->block_index = NO_INDEX;           /* no block indexed yet */
+  while( p->bom < 3 && p->xml_index != length ) /* skip UTF-8 byte order mark, it may be split too */
+  {
+    if( p->xml[ p->xml_index ] != (unsigned char)"\xEF\xBB\xBF"[ p->bom ] )
+    {
+      if( p->bom != 0 )                /* partial mark */
+      {
+        p->column = 1;
+        p->error = "Unrelated character";
+        uxml_error( p, error );
+        return 0;
+      }
+      p->bom = 3;                      /* there is no mark */
+      break;
+    }
+    p->xml_index++;
+    p->bom++;
+  }
+  if( !uxml_read_doc( p ) )
+  {
+    uxml_error( p, error );
+    return 0;
+  }
+  return 1;
+}
+
+int uxml_parser_feed( uxml_parser_t *p, const char *data, const size_t length, uxml_error_t *error )
+{
+  static const char zeros[64] = { 0 };
+  size_t n, k;
+
+  if( p->error != NULL )               /* error was occured already */
+  {
+    uxml_error( p, error );
+    return 0;
+  }
+  /* trailing zero bytes are ignored like in uxml_parse, so they are kept until next part */
+  for( n = length; n != 0 && data[ n - 1 ] == 0; n-- );
+  if( n == 0 )
+  {
+    p->zeros += length;
+    return 1;
+  }
+  for( ; p->zeros != 0; p->zeros -= k ) /* zero bytes are followed by data, they are read */
+  {
+    k = (p->zeros < sizeof( zeros )) ? p->zeros: sizeof( zeros );
+    if( !uxml_parser_part( p, zeros, k, error ) )
+      return 0;
+  }
+  p->zeros = length - n;
+  return uxml_parser_part( p, data, n, error );
+}
+
+int uxml_parser_finish( uxml_parser_t *p, uxml_error_t *error )
+{
+  if( !uxml_read_finish( p ) )
+  {
+    uxml_error( p, error );
+    return 0;
+  }
+  return 1;
+}
+
+void uxml_parser_free( uxml_parser_t *p )
+{
+  if( p != NULL )
+  {
+    free( p->text );
+    free( p->stack );
+    free( p );
+  }
+}
+
+/*
+ * Step of extracted path
+ */
+typedef struct _uxml_xstep_t
+{
+  const char *name;                 /* name in user's path, NULL - any name */
+  size_t length;                    /* length of name */
+} uxml_xstep_t;
+
+/*
+ * State of extraction, it is user's pointer of internal reader
+ */
+typedef struct _uxml_extractor_t
+{
+  uxml_t *p;                        /* reader's instance */
+  size_t count;                     /* count of paths */
+  uxml_xstep_t *step;               /* steps of all paths */
+  size_t *first;                    /* first step of every path, and end of steps of last path */
+  size_t *matched;                  /* count of steps of every path, which are matched by open nodes */
+  size_t depth;                     /* count of open nodes */
+  size_t *begin;                    /* content's begin of every open node, NO_INDEX - node isn't matched */
+  size_t begin_size;                /* allocated count of begins */
+  char *content;                    /* contents of open matched nodes, one after another */
+  size_t content_index;             /* end of contents */
+  size_t content_size;              /* allocated size of contents */
+  uxml_extract_t callback;          /* user's callback */
+  void *user;                       /* user's pointer */
+} uxml_extractor_t;
+
+/*
+ * Check, whether step of path matches name
+ */
+static int uxml_extract_match( const uxml_xstep_t *t, const char *name )
+{
+  return t->name == NULL || (strncmp( t->name, name, t->length ) == 0 && name[ t->length ] == 0);
+}
+
+/*
+ * Grow buffer of contents for extra bytes and zero byte
+ */
+static int uxml_extract_reserve( uxml_extractor_t *x, size_t extra )
+{
+  char *content;
+  size_t size = x->content_size;
+
+  while( size < x->content_index + extra + 1 )
+  {
+    size *= 2;
+  }
+  if( size != x->content_size )
+  {
+    if( (content = (char *)realloc( x->content, size )) == NULL )
+    {
+      x->p->error = "Insufficient memory";
+      return 0;
+    }
+    x->content = content;
+    x->content_size = size;
+  }
+  return 1;
+}
+
+/*
+ * Set, what is needed from current node: its content, if some path ends at it,
+ * or attributes, if some path ends at attribute of it
+ */
+static void uxml_extract_skip( uxml_extractor_t *x )
+{
+  size_t k;
+
+  x->p->skip = SKIP_VALUE | ((x->depth == 0 || x->begin[ x->depth - 1 ] == NO_INDEX) ? SKIP_CONTENT: 0);
+  for( k = 0; k != x->count && x->depth != 0; k++ )
+  {
+    if( x->matched[k] == x->depth && x->first[ k + 1 ] - x->first[k] == x->depth + 1 )
+    {
+      x->p->skip &= ~SKIP_VALUE;
+      break;
+    }
+  }
+}
+
+static int uxml_extract_start( void *user, const char *name )
+{
+  uxml_extractor_t *x = (uxml_extractor_t *)user;
+  size_t k, *begin, d = x->depth++;
+
+  if( x->depth > x->begin_size )
+  {
+    if( (begin = (size_t *)realloc( x->begin, 2 * x->begin_size * sizeof( size_t ) )) == NULL )
+    {
+      x->p->error = "Insufficient memory";
+      return 0;
+    }
+    x->begin = begin;
+    x->begin_size *= 2;
+  }
+  x->begin[d] = NO_INDEX;
+  for( k = 0; k != x->count; k++ )
+  {
+    if( x->matched[k] == d && x->first[k] + d < x->first[ k + 1 ] && uxml_extract_match( x->step + x->first[k] + d, name ) )
+    {
+      if( ++x->matched[k] == x->first[ k + 1 ] - x->first[k] ) /* path ends at this node */
+        x->begin[d] = x->content_index;
+    }
+  }
+  uxml_extract_skip( x );
+  return 1;
+}
+
+static int uxml_extract_attr( void *user, const char *name, const char *value, size_t size )
+{
+  uxml_extractor_t *x = (uxml_extractor_t *)user;
+  size_t k;
+
+  if( (x->p->skip & SKIP_VALUE) != 0 ) /* attribute of process instruction too */
+    return 1;
+  for( k = 0; k != x->count; k++ )
+  {
+    if( x->matched[k] == x->depth && x->first[ k + 1 ] - x->first[k] == x->depth + 1 &&
+        uxml_extract_match( x->step + x->first[k] + x->depth, name ) &&
+        !x->callback( x->user, k, value, size ) )
+      return 0;
+  }
+  return 1;
+}
+
+static int uxml_extract_text( void *user, const char *text, size_t size )
+{
+  uxml_extractor_t *x = (uxml_extractor_t *)user;
+
+  if( !uxml_extract_reserve( x, size ) )
+    return 0;
+  memcpy( x->content + x->content_index, text, size );
+  x->content_index += size;
+  return 1;
+}
+
+static int uxml_extract_end( void *user, const char *name )
+{
+  uxml_extractor_t *x = (uxml_extractor_t *)user;
+  size_t k, d = --x->depth;
+
+  (void)name;
+  if( x->begin[d] != NO_INDEX )        /* pass content of matched node, then drop it */
+  {
+    x->content[ x->content_index ] = 0;
+    for( k = 0; k != x->count; k++ )
+    {
+      if( x->matched[k] == d + 1 && x->first[ k + 1 ] - x->first[k] == d + 1 &&
+          !x->callback( x->user, k, x->content + x->begin[d], x->content_index - x->begin[d] ) )
+        return 0;
+    }
+    x->content_index = x->begin[d];
+  }
+  for( k = 0; k != x->count; k++ )
+  {
+    if( x->matched[k] == d + 1 )
+      x->matched[k] = d;
+  }
+  /* content after child node continues stored content, spaces around child node are one space, like in the tree */
+  x->p->words = (d != 0 && x->begin[ d - 1 ] != NO_INDEX && x->content_index != x->begin[ d - 1 ]);
+  uxml_extract_skip( x );
+  return 1;
+}
+
+int uxml_extract( const char *xml_data, const size_t xml_length, const char * const *paths, const size_t count,
+                  uxml_extract_t callback, void *user, uxml_error_t *error )
+{
+  uxml_t instance, *p = &instance;
+  uxml_extractor_t extractor, *x = &extractor;
+  uxml_reader_t reader;
+  const char *s;
+  size_t i, k, steps = 0;
+  int ok = 0;
+
+  memset( &reader, 0, sizeof( reader ) );
+  reader.user = x;
+  reader.start = uxml_extract_start;
+  reader.attr = uxml_extract_attr;
+  reader.text = uxml_extract_text;
+  reader.end = uxml_extract_end;
+  memset( x, 0, sizeof( *x ) );
+  x->p = p;
+  x->count = count;
+  x->callback = callback;
+  x->user = user;
+  for( i = 0; i != count; i++ )        /* every step ends with '/' or end of path */
+  {
+    for( s = paths[i], steps++; *s != 0; s++ )
+    {
+      steps += (*s == '/');
+    }
+  }
+  x->begin_size = 16;
+  x->content_size = UXML_READER_BUFFER;
+  x->step = (uxml_xstep_t *)malloc( steps * sizeof( uxml_xstep_t ) + 1 );
+  x->first = (size_t *)malloc( (2 * count + 1) * sizeof( size_t ) );
+  x->begin = (size_t *)malloc( x->begin_size * sizeof( size_t ) );
+  x->content = (char *)malloc( x->content_size );
+  if( x->step == NULL || x->first == NULL || x->begin == NULL || x->content == NULL )
+  {
+    if( error != NULL )
+    {
+      error->text = "Insufficient memory";
+      error->line = error->column = 0;
+    }
+  }
+  else
+  {
+    x->matched = x->first + count + 1;
+    for( i = k = 0; i != count; i++ )  /* path begins with the name of root node, empty names are skipped */
+    {
+      x->first[i] = k;
+      x->matched[i] = 0;
+      for( s = paths[i]; *s != 0; )
+      {
+        if( *s == '/' )
+        {
+          s++;
+          continue;
+        }
+        x->step[k].name = s;
+        for( ; *s != 0 && *s != '/'; s++ );
+        x->step[k].length = (size_t)(s - x->step[k].name);
+        if( x->step[k].length == 1 && x->step[k].name[0] == '*' )
+        {
+          x->step[k].name = NULL;
+        }
+        k++;
+      }
+    }
+    x->first[count] = k;
+    uxml_init( p, xml_data, xml_length );
+    p->final = 1;                      /* whole XML data is here */
+    if( !uxml_read_init( p, &reader ) )
+    {
+      uxml_error( p, error );
+    }
+    else
+    {
+      p->skip = SKIP_CONTENT | SKIP_VALUE; /* nothing is needed outside of root node */
+      if( !uxml_read_doc( p ) || !uxml_read_finish( p ) )
+      {
+        uxml_error( p, error );
+      }
+      free( p->text );
+      free( p->stack );
+      ok = (p->error == NULL);
+    }
+  }
+  free( x->step );
+  free( x->first );
+  free( x->begin );
+  free( x->content );
+  return ok;
+}
+
+/*
+ * Free indices of children
+ */
+static void uxml_free_children( uxml_t *p )
+{
+  size_t i;
+
+  if( p->children != NULL )
+  {
+    for( i = 0; i <= p->children_mask; i++ )
+    {
+      free( p->children[i] );
+    }
+    free( p->children );
+    p->children = NULL;
+    p->children_count = 0;
+  }
+}
+
+/*
+ * Free data, which is allocated for tree after parse: arena, indices, cache of values, user's pointers
+ */
+static void uxml_release( uxml_t *p )
+{
+  uxml_free_arena( p );
+  uxml_free_children( p );
+  free( p->values );
+  p->values = NULL;
+#if defined( UXML_COMPACT )
+  free( p->user );
+  p->user = NULL;
+#endif
+}
+
+void uxml_free( uxml_node_t *node )
+{
+  uxml_t *p = INSTANCE( node );
+
+  uxml_release( p );
+  if( p->context != NULL )             /* buffers are kept by context for next parse */
+    return;
+  uxml_free_names( p );
+  if( !p->insitu )                     /* array of nodes follows instance, text data is separate */
+    free( p->text );
+  free( p );
+}
+
+/*
+ * Parse context: instance, which is followed by array of nodes, like in packed tree,
+ * text buffer and stack are kept between parses, table of names is kept by instance
+ */
+struct _uxml_context_t
+{
+  uxml_t *tree;                     /* instance of last tree, NULL - nothing is parsed yet */
+  size_t nodes_size;                /* allocated count of nodes after instance */
+  unsigned char *text;              /* text data */
+  size_t text_size;                 /* allocated size of text data */
+  uxml_frame_t *stack;              /* open nodes while parse */
+  size_t stack_size;                /* allocated count of stack frames */
+};
+
+uxml_context_t *uxml_context_create( void )
+{
+  uxml_context_t *ctx;
+
+  if( (ctx = (uxml_context_t *)malloc( sizeof( uxml_context_t ) )) == NULL )
+    return NULL;
+  ctx->tree = NULL;
+  ctx->nodes_size = 0;
+  ctx->text = NULL;
+  ctx->text_size = 0;
+  ctx->stack = NULL;
+  ctx->stack_size = 16;
+  return ctx;
+}
+
+/*
+ * Prepare buffers of context for the rest of XML data of \c instance, they grow only,
+ * and move instance to the context. Returns NULL if there is no memory.
+ */
+static uxml_t *uxml_context_alloc( uxml_context_t *ctx, uxml_t *instance )
+{
+  uxml_t *p = ctx->tree;
+  size_t nodes = uxml_nodes_size( instance );
+  size_t text = (instance->xml_size - instance->xml_index) + 3;
+
+  if( p == NULL || ctx->nodes_size < nodes )
+  {
+    if( (p = (uxml_t *)malloc( sizeof( uxml_t ) + nodes * sizeof( uxml_node_t ) )) == NULL )
+      return NULL;
+    uxml_init( p, "", 0 );             /* empty tree, until parse */
+    if( ctx->tree != NULL )            /* table of names is moved to new instance */
+    {
+      p->names = ctx->tree->names;
+      p->names_size = ctx->tree->names_size;
+      p->names_hash = ctx->tree->names_hash;
+      p->names_mask = ctx->tree->names_mask;
+      free( ctx->tree );
+    }
+    ctx->tree = p;
+    ctx->nodes_size = nodes;
+  }
+  if( ctx->text_size < text )
+  {
+    free( ctx->text );
+    if( (ctx->text = (unsigned char *)malloc( text )) == NULL )
+    {
+      ctx->text_size = 0;
+      return NULL;
+    }
+    ctx->text_size = text;
+  }
+  if( ctx->stack == NULL && (ctx->stack = (uxml_frame_t *)malloc( ctx->stack_size * sizeof( uxml_frame_t ) )) == NULL )
+    return NULL;
+  if( p->names == NULL )
+  {
+    p->names_size = 64;
+    p->names_mask = 127;
+    p->names = (uxml_symbol_t *)malloc( p->names_size * sizeof( uxml_symbol_t ) );
+    p->names_hash = (size_t *)calloc( p->names_mask + 1, sizeof( size_t ) );
+    if( p->names == NULL || p->names_hash == NULL )
+    {
+      uxml_free_names( p );
+      return NULL;
+    }
+  }
+  else
+  {
+    memset( p->names_hash, 0, (p->names_mask + 1) * sizeof( size_t ) );
+  }
+  instance->names = p->names;
+  instance->names_size = p->names_size;
+  instance->names_hash = p->names_hash;
+  instance->names_mask = p->names_mask;
+  memcpy( p, instance, sizeof( uxml_t ) );
+  p->node = (uxml_node_t *)(p + 1);
+  p->nodes_size = ctx->nodes_size;
+  p->text = ctx->text;
+  p->text_size = ctx->text_size;
+  p->stack = ctx->stack;
+  p->stack_size = ctx->stack_size;
+  p->context = ctx;
+  return p;
+}
+
+uxml_node_t *uxml_parse_ctx( uxml_context_t *ctx, const char *xml_data, const size_t xml_length, uxml_error_t *error )
+{
+  uxml_t instance, *p, *t;
+  size_t root;
+
+  if( ctx->tree != NULL )              /* previous tree is invalid from now */
+  {
+    uxml_release( ctx->tree );
+  }
+  uxml_init( &instance, xml_data, xml_length );
+#if defined( UXML_COMPACT )
+  if( instance.xml_size > UXML_INDEX_MAX - 3 )
+  {
+    instance.error = "Too large document for compact nodes";
+    uxml_error( &instance, error );
+    return NULL;
+  }
+#endif
+  if( (p = uxml_context_alloc( ctx, &instance )) == NULL )
+  {
+    if( error != NULL )
+    {
+      error->text = "Insufficient memory";
+      error->line = error->column = 0;
+    }
+    return NULL;
+  }
+  uxml_start( p );
+
+  root = uxml_parse_doc( p ) ? uxml_parse_finish( p ): 0;
+  ctx->text = p->text;                 /* buffers, which grew while parse, are kept */
+  ctx->text_size = p->text_size;
+  ctx->stack = p->stack;
+  ctx->stack_size = p->stack_size;
+  p->stack = NULL;
+  if( root != 0 && p->node != (uxml_node_t *)(p + 1) ) /* array of nodes grew, it must follow instance */
+  {
+    if( (t = uxml_pack_nodes( p, p->nodes_size )) == NULL )
+    {
+      p->error = "Insufficient memory";
+      root = 0;
+    }
+    else
+    {
+      ctx->tree = p = t;
+      ctx->nodes_size = p->nodes_size;
+    }
+  }
+  if( root == 0 )
+  {
+    uxml_error( p, error );
+    if( p->node != (uxml_node_t *)(p + 1) )
+      free( p->node );
+    p->node = (uxml_node_t *)(p + 1);
+    uxml_free_arena( p );
+    return NULL;
+  }
+  p->text[ p->text_index ] = 0;
+  p->initial_allocated = sizeof( uxml_t ) + ctx->nodes_size * sizeof( uxml_node_t ) + ctx->text_size +
+                         p->names_size * sizeof( uxml_symbol_t ) + (p->names_mask + 1) * sizeof( size_t );
+  p->text_size = p->text_index;
+  p->nodes_count = p->node_index;
+  p->nodes_size = p->node_index;
+  SET_LINK( p, p->node, next, root );
+  return p->node + root;
+}
+
+void uxml_context_free( uxml_context_t *ctx )
+{
+  if( ctx == NULL )
+    return;
+  if( ctx->tree != NULL )
+  {
+    uxml_release( ctx->tree );
+    uxml_free_names( ctx->tree );
+    free( ctx->tree );
+  }
+  free( ctx->text );
+  free( ctx->stack );
+  free( ctx );
+}
+
+/*
+ * Content refers to XML data, replace it with zero-terminated copy in the arena
+ */
+static int uxml_copy_ref( uxml_t *p, uxml_node_t *n )
+{
+  unsigned char *s;
+#if defined( UXML_COMPACT )
+  size_t i;
+#endif
+
+  if( (s = uxml_arena_copy( p, CONTENT( p, n ), n->size )) == NULL )
+    return 0;
+#if defined( UXML_COMPACT )
+  if( (i = uxml_ext( p, s )) == NO_INDEX )
+    return 0;
+  n->content = (uxml_index_t)i;
+  n->flags |= CONTENT_EXT;
+#else
+  n->content = s;
+#endif
+  n->flags &= ~CONTENT_REF;
+  return 1;
+}
+
+uxml_node_t *uxml_child( uxml_node_t *node )
+{
+  return LINK( node, child );
+}
+
+uxml_node_t *uxml_child_node( uxml_node_t *node )
+{
+  uxml_node_t *n = LINK( node, child );
+
+  while( n != NULL )
+  {
+    if( n->type == XML_NODE )
+      break;
+    n = LINK( n, next );
+  }
+  return n;
+}
+
+uxml_node_t *uxml_first_attr( uxml_node_t *node )
+{
+  uxml_node_t *n = LINK( node, child );
+
+  while( n != NULL )
+  {
+    if( n->type == XML_ATTR )
+      break;
+    n = LINK( n, next );
+  }
+  return n;
+}
+
+uxml_node_t *uxml_next_attr( uxml_node_t *node )
+{
+  uxml_node_t *n = LINK( node, next );
+
+  while( n != NULL )
+  {
+    if( n->type == XML_ATTR )
+      break;
+    n = LINK( n, next );
+  }
+  return n;
+}
+
+uxml_node_t *uxml_next( uxml_node_t *node )
+{
+  return LINK( node, next );
+}
+
+uxml_node_t *uxml_prev( uxml_node_t *node )
+{
+#if !defined( UXML_DISABLE_PREV )
+  uxml_node_t *n = LINK( node, parent );
+
+  if( n == NULL || LINK( n, child ) == node ) /* first node refers to the last one */
+    return NULL;
+  return LINK( node, prev );
+#else
+  uxml_node_t *prev = NULL, *n = LINK( node, parent );
+
+  if( n == NULL ) return NULL;
+  for( n = LINK( n, child ); n != node; n = LINK( n, next ) )
+  {
+    prev = n;
+  }
+  return prev;
+#endif
+}
+
+uxml_node_t *uxml_prev_attr( uxml_node_t *node )
+{
+  uxml_node_t *n = uxml_prev( node );
+
+  while( n != NULL )
+  {
+    if( n->type == XML_ATTR )
+      break;
+    n = uxml_prev( n );
+  }
+  return n;
+}
+
+uxml_node_t *uxml_last_child( uxml_node_t *node )
+{
+  uxml_node_t *n = LINK( node, child );
+
+#if !defined( UXML_DISABLE_PREV )
+  return (n != NULL) ? LINK( n, prev ): NULL;
+#else
+  if( n != NULL )
+  {
+    while( LINK( n, next ) != NULL )
+    {
+      n = LINK( n, next );
+    }
+  }
+  return n;
+#endif
+}
+
+const char *uxml_name( uxml_node_t *node )
+{
+  return (const char *)NAME( INSTANCE( node ), node );
+}
+
+const char *uxml_name_ref( uxml_node_t *node, size_t *length )
+{
+  uxml_t *p = INSTANCE( node );
+
+  if( length != NULL )
+    *length = NAME_LENGTH( p, node );
+  return (const char *)NAME( p, node );
+}
+
+/*
+ * Find run of children with name \c id in the index of children
+ */
+static const uxml_run_t *uxml_find_run( const uxml_children_t *c, size_t id )
+{
+  size_t i, r;
+
+  for( i = id & c->mask; (r = c->hash[i]) != 0; i = (i + 1) & c->mask )
+  {
+    if( c->run[ r - 1 ].name == id )
+      return c->run + r - 1;
+  }
+  return NULL;
+}
+
+/*
+ * Build index of children of node \c n: children are grouped by name,
+ * attributes precede nodes in every group, both are kept in document order.
+ * Returns NULL if there is no memory.
+ */
+static uxml_children_t *uxml_index_children( uxml_node_t *n )
+{
+  uxml_t *p = INSTANCE( n );
+  uxml_children_t *c;
+  uxml_run_t *run;
+  uxml_node_t *k;
+  size_t i, j, h, count = 0, runs = 0, mask, *hash;
+
+  for( k = LINK( n, child ); k != NULL; k = LINK( k, next ) )
+  {
+    count++;
+  }
+  for( mask = 1; mask < 2 * count; mask *= 2 );
+  mask--;
+  hash = (size_t *)calloc( mask + 1, sizeof( size_t ) );
+  run = (uxml_run_t *)malloc( count * sizeof( uxml_run_t ) );
+  if( hash == NULL || run == NULL )
+  {
+    free( hash );
+    free( run );
+    return NULL;
+  }
+  for( k = LINK( n, child ); k != NULL; k = LINK( k, next ) ) /* count children of every name */
+  {
+    for( i = NAME_ID( k ) & mask; hash[i] != 0 && run[ hash[i] - 1 ].name != NAME_ID( k ); i = (i + 1) & mask );
+    if( hash[i] == 0 )
+    {
+      hash[i] = ++runs;
+      run[ runs - 1 ].name = NAME_ID( k );
+      run[ runs - 1 ].attrs = 0;
+      run[ runs - 1 ].count = 0;
+    }
+    run[ hash[i] - 1 ].attrs += (k->type != XML_NODE);
+    run[ hash[i] - 1 ].count++;
+  }
+  free( hash );
+
+  for( mask = 1; mask < 2 * runs; mask *= 2 );
+  if( (c = (uxml_children_t *)malloc( sizeof( uxml_children_t ) + runs * sizeof( uxml_run_t ) +
+                                      (mask + count) * sizeof( size_t ) )) == NULL )
+  {
+    free( run );
+    return NULL;
+  }
+  c->parent = (size_t)(n - p->node);
+  c->run = (uxml_run_t *)(c + 1);
+  c->hash = (size_t *)(c->run + runs);
+  c->mask = mask - 1;
+  c->child = c->hash + mask;
+  memset( c->hash, 0, mask * sizeof( size_t ) );
+  for( i = 0, j = 0; i != runs; i++ )
+  {
+    c->run[i] = run[i];
+    c->run[i].begin = j;
+    for( h = run[i].name & c->mask; c->hash[h] != 0; h = (h + 1) & c->mask );
+    c->hash[h] = i + 1;
+    run[i].begin = j;                  /* next location of attribute */
+    j += run[i].count;
+    run[i].count = run[i].begin + run[i].attrs; /* next location of node */
+  }
+  for( k = LINK( n, child ); k != NULL; k = LINK( k, next ) ) /* fill runs */
+  {
+    i = (size_t)(uxml_find_run( c, NAME_ID( k ) ) - c->run);
+    c->child[ (k->type != XML_NODE) ? run[i].begin++: run[i].count++ ] = (size_t)(k - p->node);
+  }
+  free( run );
+  return c;
+}
+
+/*
+ * Get index of children of node \c n, it is built on first call.
+ * Returns NULL if there is no memory, or children are changed after parse.
+ */
+static const uxml_children_t *uxml_children( uxml_node_t *n )
+{
+  uxml_t *p = INSTANCE( n );
+  uxml_children_t *c, **table;
+  size_t i, j, mask, parent;
+
+  if( (n->flags & CHILDREN_CHANGED) != 0 ) /* children are looked through */
+    return NULL;
+  parent = (size_t)(n - p->node);
+  if( p->children != NULL )
+  {
+    for( i = parent & p->children_mask; (c = p->children[i]) != NULL; i = (i + 1) & p->children_mask )
+    {
+      if( c->parent == parent )
+        return c;
+    }
+  }
+  if( p->children == NULL || 2 * (p->children_count + 1) > p->children_mask + 1 ) /* keep hash table half-empty */
+  {
+    mask = (p->children != NULL) ? 2 * p->children_mask + 1: 15;
+    if( (table = (uxml_children_t **)calloc( mask + 1, sizeof( uxml_children_t * ) )) == NULL )
+      return NULL;
+    for( i = 0; p->children != NULL && i <= p->children_mask; i++ )
+    {
+      if( (c = p->children[i]) != NULL )
+      {
+        for( j = c->parent & mask; table[j] != NULL; j = (j + 1) & mask );
+        table[j] = c;
+      }
+    }
+    free( p->children );
+    p->children = table;
+    p->children_mask = mask;
+  }
+  if( (c = uxml_index_children( n )) == NULL )
+    return NULL;
+  for( i = parent & p->children_mask; p->children[i] != NULL; i = (i + 1) & p->children_mask );
+  p->children[i] = c;
+  p->children_count++;
+  return c;
+}
+
+/*
+ * Find child of node \c n with name \c id: first one, if \c index is NO_INDEX,
+ * or node number \c index among nodes with this name.
+ * Long lists of children are looked up in the index of children.
+ */
+static uxml_node_t *uxml_find_child( uxml_node_t *n, size_t id, size_t index )
+{
+  const uxml_children_t *c;
+  const uxml_run_t *r;
+  uxml_node_t *k;
+  size_t i = 0, steps = 0;
+
+  for( k = LINK( n, child ); k != NULL; k = LINK( k, next ) )
+  {
+    if( UXML_INDEX_CHILDREN != 0 && ++steps > UXML_INDEX_CHILDREN && (c = uxml_children( n )) != NULL )
+    {
+      if( (r = uxml_find_run( c, id )) == NULL )
+        return NULL;
+      if( index == NO_INDEX )
+        return INSTANCE( n )->node + c->child[ r->begin ];
+      return (index < r->count - r->attrs) ? INSTANCE( n )->node + c->child[ r->begin + r->attrs + index ]: NULL;
+    }
+    if( NAME_ID( k ) != id )
+      continue;
+    if( index == NO_INDEX || (k->type == XML_NODE && i++ == index) )
+      return k;
+  }
+  return NULL;
+}
+
+#define MASK_SQUARE_OPEN  1
+#define MASK_SQUARE_CLOSE 2
+#define MASK_INDEX        4
+#define MASK_WILDCARD     8
+
+uxml_node_t *uxml_node( uxml_node_t *node, const char *ipath )
+{
+  uxml_t *p = INSTANCE( node );
+  const char *path = ipath, *s1, *s2;
+  size_t i, id, len, index = 0;
+  int c, mask = 0;
+  uxml_node_t *n = node;
+
+  /* NULL path is equal to empty string */
+  if( path == NULL )
+  {
+    path = "";
+  }
+  /* Go from root? */
+  if( path[0] == '/' )
+  {
+    n = LINK( p->node, next );
+    path++;
+  }
+  /* scan string */
+  for( s1 = path, s2 = path, len = 0; *s2 != 0; s2++ )
+  {
+    /* current character */
+    c = *s2;
+    /* separator ? */
+    if( c == '/' )
+    {
+      /* empty name? - skip it */
+      if( s1 == s2 )
+      {
+        s1 = s2 + 1;
+        len = 0;
+        continue;
+      }
+      /* special case of ".." - parent node */
+      if( len == 2 )
+      {
+        if( s1[0] == '.' && s1[1] == '.' )
+        {
+          if( LINK( n, parent ) == NULL )
           {
-            n->child = p->node + p->node_index;  /* store attribute index */
+            return NULL;
           }
+          n = LINK( n, parent );
+          s1 = s2 + 1;
+          len = 0;
+          continue;
         }
-        if( a != NULL )                /* if it is not first attribute */
-        {
-          a->next = p->node + p->node_index; /* fill next of previous attribute */
-        }
-        if( p->node != NULL )          /* real dispatch? */
-        {
-          a = p->node + p->node_index; /* current node for attribute */
-          a->type = XML_ATTR;          /* this is attribute node */
-          a->name = p->text + p->text_index; /* name of attribute */
-          a->name_length = 0;
-          a->content = p->text;        /* add content later */
-          a->size = 0;                 /* size of content is 0*/
-          a->instance = p;             /* our instance */
-          a->parent = p->node + node_index; /* parent process instruction */
-          a->child = NULL;                /* attribute have no child nodes */
-          a->next = NULL;                 /* no next node (yet) */
-        }
-        p->node_index++;
-        if( p->text != NULL )          /* if text buffer present, */
+      }
+      /* name is hashed once, nodes are compared by ID */
+      id = (mask & MASK_WILDCARD) == 0 ? uxml_find_name( p, (const unsigned char *)s1, len, uxml_hash( (const unsigned char *)s1, len ) ): 0;
+      /* mask of name */
+      switch( mask )
+      {
+      case 0: /* regular case - name only */
+        n = uxml_find_child( n, id, NO_INDEX );
+        /* go next */
+        s1 = s2 + 1;
+        len = 0;
+        break;
+      case MASK_WILDCARD: /* wildcard "*" instead name */
+        n = LINK( n, child ); /* first child gettin' */
+        break;
+      case (MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
+        /* index present, but no wildcard, only nodes is considered */
+        n = uxml_find_child( n, id, index );
+        /* go next */
+        s1 = s2 + 1;
+        len = 0;
+        break;
+      case (MASK_WILDCARD | MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
+        /* wildcard and index, i.e. *[NN] */
+        for( i = 0, n = LINK( n, child ); n != NULL; n = LINK( n, next ) )
         {
-          p->text[ p->text_index ] = c0; /* store first character of attribute's name */
-          a->name_length++;
+          /* only nodes */
+          if( n->type != XML_NODE )
+            continue;
+          /* only index compare */
+          if( i == index )
+          {
+            /* go next */
+            s1 = s2 + 1;
+            len = 0;
+            break;
+          }
+          /* next index */
+          i++;
         }
-        p->text_index++;               /* prepare for next character */
+        break;
+      default:
+        /* other cases is wrong */
+        n = NULL;
+        break; 
       }
-      else if( (p->c & 0x0000FFFFU) == (('?' << 8) | '>') )
+      /* if NULL, nothing to do */
+      if( n == NULL )
       {
-        p->state = state;              /* restore outer state */
-        return node_index;             /* dispatch done */
+        return NULL;
       }
-      else if( !(c0 == '?') )
+      /* new name, clear mask */
+      mask = 0;
+    }
+    else if( c == '*' && s1 == s2 )
+    {
+      /* wildcard is only one first character */
+      mask |= MASK_WILDCARD;
+    }
+    else if( c == '[' && s1 != s2 )
+    {
+      /* square brackets only after non-zero name or wildcard */
+      mask |= MASK_SQUARE_OPEN;
+      index = 0;
+    }
+    else if( isdigit( c ) && (mask & MASK_SQUARE_OPEN) != 0 )
+    {
+      mask |= MASK_INDEX;
+      index = index * 10 + (c - '0');
+    }
+    else if( c == ']' && (mask & (MASK_SQUARE_OPEN | MASK_INDEX)) == (MASK_SQUARE_OPEN | MASK_INDEX) )
+    {
+      mask |= MASK_SQUARE_CLOSE;
+    }
+    else if( mask != 0 )
+    {
+      /* all other cases means bad syntax in path */
+      return NULL;
+    }
+    else
+    {
+      len++;
+    }
+  }
+  if( s2 != s1 )
+  {
+    if( len == 2 )
+    {
+      if( s1[0] == '.' && s1[1] == '.' )
       {
-        if( !isspace( c0 ) )
+        return LINK( n, parent );
+      }
+    }
+    id = (mask & MASK_WILDCARD) == 0 ? uxml_find_name( p, (const unsigned char *)s1, len, uxml_hash( (const unsigned char *)s1, len ) ): 0;
+    switch( mask )
+    {
+    case 0:
+      n = uxml_find_child( n, id, NO_INDEX );
+      break;
+    case MASK_WILDCARD:
+      n = LINK( n, child );
+      break;
+    case (MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
+      n = uxml_find_child( n, id, index );
+      break;
+    case (MASK_WILDCARD | MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
+      for( i = 0, n = LINK( n, child ); n != NULL; n = LINK( n, next ) )
+      {
+        if( n->type != XML_NODE )
+          continue;
+        if( i == index )
         {
-          p->error = "Invalid character";
-          return 0;
+          s1 = s2 + 1;
+          break;
         }
+        i++;
       }
+      break;
+    default:
+      n = NULL;
+      break; 
     }
-    else if( p->state == INST_ATTR_NAME )
+  }
+  return n;
+}
+
+/*
+ * Get zero-terminated content of node \c n, NULL - there is no node
+ */
+static const char *uxml_content( uxml_node_t *n )
+{
+  if( n == NULL )
+    return NULL;
+  if( (n->flags & CONTENT_REF) != 0 && !uxml_copy_ref( INSTANCE( n ), n ) ) /* terminate content, which refers to XML data */
+    return NULL;
+  return (const char *)CONTENT( INSTANCE( n ), n );
+}
+
+const char *uxml_get( uxml_node_t *node, const char *path )
+{
+  return uxml_content( uxml_node( node, path ) );
+}
+
+const char *uxml_get_ref( uxml_node_t *node, const char *path, size_t *size )
+{
+  uxml_node_t *n = uxml_node( node, path );
+
+  if( size != NULL )
+    *size = (n == NULL) ? 0: n->size;
+  return n == NULL ? NULL: (const char *)CONTENT( INSTANCE( n ), n );
+}
+
+int uxml_int( uxml_node_t *node, const char *path )
+{
+  const char *s = uxml_get( node, path );
+  return (s != NULL) ? (int)strtol( s, NULL, 0 ): 0;
+}
+
+
+/*
+ * Convert integer to unsigned value without locale: decimal, or hexadecimal after "0x".
+ * \c negative is set, if value has minus sign.
+ */
+static int uxml_to_uint( const unsigned char *s, size_t n, unsigned long long *value, int *negative )
+{
+  const unsigned char *e = s + n;
+  unsigned long long v = 0, d, base = 10;
+  int status = UXML_OK;
+
+  *negative = 0;
+  if( s != e && (*s == '-' || *s == '+') )
+  {
+    *negative = (*s++ == '-');
+  }
+  if( e - s > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X') )
+  {
+    base = 16;
+    s += 2;
+  }
+  if( s == e )
+  {
+    *value = 0;
+    return UXML_INVALID;
+  }
+  for( ; s != e; s++ )
+  {
+    if( *s >= '0' && *s <= '9' )
+      d = (unsigned long long)(*s - '0');
+    else if( base == 16 && (*s | 0x20) >= 'a' && (*s | 0x20) <= 'f' )
+      d = (unsigned long long)((*s | 0x20) - 'a' + 10);
+    else
+      break;
+    if( v > (ULLONG_MAX - d) / base )  /* keep checking characters after overflow */
+    {
+      v = ULLONG_MAX;
+      status = UXML_RANGE;
+    }
+    else
+    {
+      v = v * base + d;
+    }
+  }
+  *value = (s != e) ? 0: v;
+  return (s != e) ? UXML_INVALID: status;
+}
+
+#if !defined( UXML_DISABLE_DOUBLE )
+/* powers of ten, which are exact doubles */
+static const double uxml_pow10[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/* significant digits, which are enough for correct rounding of double */
+#define UXML_DOUBLE_DIGITS 768
+
+/*
+ * Convert real number without locale: [sign] digits [. digits] [e [sign] digits], INF or NaN.
+ * Up to 19 significant digits with small exponent are converted by one exact operation,
+ * which is correctly rounded. Other numbers are passed to strtod as significant digits 
+ * and exponent without decimal point, so they don't depend on locale too.
+ * Number, which is followed by other text, is UXML_INVALID, but its value is kept, like strtod does.
+ */
+static int uxml_to_double( const unsigned char *s, size_t n, double *value )
+{
+  const unsigned char *e = s + n, *first = NULL, *mark;
+  unsigned long long w = 0;
+  long exp10 = 0, x = 0;
+  size_t count = 0, k;
+  int negative = 0, point = 0, digits = 0, exp_negative, status;
+  char buffer[ UXML_DOUBLE_DIGITS + 32 ];
+  double v;
+
+  *value = 0.0;
+  if( s != e && (*s == '-' || *s == '+') )
+  {
+    negative = (*s++ == '-');
+  }
+  if( e - s == 3 && (memcmp( s, "INF", 3 ) == 0 || memcmp( s, "inf", 3 ) == 0) )
+  {
+    *value = negative ? -HUGE_VAL: HUGE_VAL;
+    return UXML_OK;
+  }
+  if( e - s == 3 && (memcmp( s, "NaN", 3 ) == 0 || memcmp( s, "nan", 3 ) == 0) )
+  {
+    *value = NAN;
+    return UXML_OK;
+  }
+  for( ; s != e; s++ )                 /* value is 0.(significant digits) * 10^exp10 */
+  {
+    if( *s >= '0' && *s <= '9' )
     {
-      if( isspace( c0 ) )           /* attribute's name end with '=' */
-      {
-        p->state = INST_ATTR_EQ;       /* new state */
-        p->text_index++;               /* end name with zero byte */
-      }
-      else if( c0 == '=' )           /* attribute's name end with '=' */
-      {
-        p->state = INST_ATTR_EQ_FOUND; /* new state */
-        p->text_index++;               /* end name with zero byte */
-      }
-      else                             /* all other characters means error */
+      digits = 1;
+      if( first == NULL && *s == '0' ) /* leading zeros are not significant */
       {
-        if( p->text != NULL )          /* if text buffer present, */
-        {
-          p->text[ p->text_index ] = c0; /* store next character of attribute's name */
-          a->name_length++;
-        }
-        p->text_index++;               /* go to next character */
+        exp10 -= point;
+        continue;
       }
+      if( first == NULL )
+        first = s;
+      if( count++ < 19 )
+        w = w * 10 + (unsigned long long)(*s - '0');
+      exp10 += !point;
     }
-    else if( p->state == INST_ATTR_EQ )
+    else if( *s == '.' && !point )
+      point = 1;
+    else
+      break;
+  }
+  if( !digits )
+    return UXML_INVALID;
+  if( s != e && (*s == 'e' || *s == 'E') )
+  {
+    mark = s;
+    exp_negative = 0;
+    if( ++s != e && (*s == '-' || *s == '+') )
     {
-      if( c0 == '=' )
-      {
-        p->state = INST_ATTR_EQ_FOUND;
-      }
-      else if( !isspace( c0 ) )
-      {
-        p->error = "Extra character after attribute's name";
-        return 0;
-      }
+      exp_negative = (*s++ == '-');
     }
-    else if( p->state == INST_ATTR_EQ_FOUND )
+    for( digits = 0; s != e && *s >= '0' && *s <= '9'; s++, digits = 1 )
     {
-      if( c0 == '\"' )               /* start attribute's value reading "value" */
-      {
-        p->state = INST_ATTR_VALUE_DQ; /* double quoted value */
-        if( a != NULL )                /* of course, do not forget real parsing */
-        {
-          a->content = p->text + p->text_index; /* content points to attribute's value */
-        }
-      }
-      else if( c0 == '\'' )          /* start attribute's value reading 'value' */
-      {
-        p->state = INST_ATTR_VALUE_SQ; /* single quoted value */
-        if( a != NULL )                /* of course, do not forget real parsing */
-        {
-          a->content = p->text + p->text_index;  /* content points to attribute's value */
-        }
-      }
-      else if( !isspace( c0 ) )      /* error in other non-space character */
-      {
-        p->error = "Attribute value must begin with '\"' or '\''";
-        return 0;
-      }
+      if( x < 100000 )                 /* far beyond range of double */
+        x = x * 10 + (*s - '0');
     }
-    else if( p->state == INST_ATTR_VALUE_DQ )
+    if( digits )
+      exp10 += exp_negative ? -x: x;
+    else
+      s = mark;                        /* exponent without digits is not a part of number */
+  }
+  status = (s != e) ? UXML_INVALID: UXML_OK;
+  e = s;
+  if( count == 0 )
+  {
+    *value = negative ? -0.0: 0.0;
+    return status;
+  }
+  x = exp10 - (long)count;             /* value is w * 10^x, if count <= 19 */
+  if( count <= 19 && w <= (1ULL << 53) )
+  {
+    if( x >= 0 && x <= 22 + 15 )
     {
-      if( c0 == '\"' && ((p->escape & 1) == 0) ) /* value ended? */
+      for( ; x > 22 && w <= (1ULL << 53) / 10; x-- ) /* move extra power to exact mantissa */
       {
-        p->text_index++;               /* end value with zero byte */
-        p->state = INST_TAG;           /* return to tag dispatch */
+        w *= 10;
       }
-      else
+      if( x <= 22 )
       {
-        if( p->text != NULL )          /* while real parsing */
-        {
-          p->text[ p->text_index ] = c0; /* store next value character */
-        }
-        p->text_index++;               /* next byte for value */
-        if( a != NULL )
-        {
-          a->size++;
-        }
+        v = (double)w * uxml_pow10[ x ];
+        *value = negative ? -v: v;
+        return status;
       }
     }
-    else if( p->state == INST_ATTR_VALUE_SQ )
+    else if( x < 0 && x >= -22 )
     {
-      if( c0 == '\'' && ((p->escape & 1) == 0) ) /* value ended? */
-      {
-        p->text_index++;               /* end value with zero byte */
-        p->state = INST_TAG;           /* return to tag dispatch */
-      }
-      else
-      {
-        if( p->text != NULL )          /* while real parsing */
-        {
-          p->text[ p->text_index ] = c0; /* store next value character */
-        }
-        p->text_index++;               /* next byte for value */
-        if( a != NULL )
-        {
-          a->size++;
-        }
-      }
+      v = (double)w / uxml_pow10[ -x ];
+      *value = negative ? -v: v;
+      return status;
     }
   }
-  if( p->error == NULL )
-    p->error = "Unterminated process instruction";
-  return 0;
+  /* significant digits and exponent, the rest of digits is replaced by one sticky digit */
+  for( k = 0, s = first; s != e && *s != 'e' && *s != 'E'; s++ )
+  {
+    if( *s == '.' )
+      continue;
+    if( k < UXML_DOUBLE_DIGITS )
+    {
+      buffer[ k++ ] = (char)*s;
+    }
+    else if( *s != '0' )
+    {
+      buffer[ UXML_DOUBLE_DIGITS ] = '1';
+      k = UXML_DOUBLE_DIGITS + 1;
+    }
+  }
+  exp10 -= (long)k;
+  sprintf( buffer + k, "e%ld", exp10 );
+  v = strtod( buffer, NULL );
+  *value = negative ? -v: v;
+  if( status == UXML_OK && (v == 0.0 || v == HUGE_VAL) ) /* significant digits underflow to 0, or overflow */
+    status = UXML_RANGE;
+  return status;
 }
+#endif
 
 /*
- * parse node
+ * Convert content of node to value of specified type, or get it from cache
  */
-static int uxml_parse_node( uxml_t *p, uxml_node_t *parent_node )
+static int uxml_convert( uxml_node_t *n, int type, uxml_value_t *value )
 {
-  int c0;
-  int state = p->state;                /* keep current state */
-  int node_index = p->node_index;      /* index of node */
-  uxml_node_t *n = NULL;               /* node itself */
-  uxml_node_t *a = NULL;               /* node for attribute reading */
-  int content_begin = 0;               /* content begin */
-  int content_end = 0;                 /* and content end, of course */
-  int name = p->xml_index - 1;         /* node's name - on step before */
-  int name_end = 0;                    /* node's end name - not found yet */
-  int name_len = 1;                    /* node's name length - 1 character at least */
-  int comment_state = p->state;        /* place for state when comment dispatch */
-  int last_child = 0;                  /* no children nodes yet */
+  uxml_t *p;
+  uxml_value_t *c = NULL;
+  const unsigned char *s;
+  unsigned long long u;
+  size_t size;
+  int negative;
+
+  value->type = type;
+  value->v.u = 0;
+  if( n == NULL )
+    return value->status = UXML_MISSING;
+  p = INSTANCE( n );
+  if( p->values != NULL && (n->flags & NODE_ADDED) == 0 )
+  {
+    c = p->values + (n - p->node);
+    if( c->type == type )              /* converted already */
+    {
+      *value = *c;
+      return value->status;
+    }
+  }
+  s = CONTENT( p, n );
+  size = n->size;
+  for( ; size != 0 && isspace( s[ size - 1 ] ); size-- ); /* whitespace around value is ignored, like in XML schema */
+  for( ; size != 0 && isspace( *s ); s++, size-- );
+  switch( type )
+  {
+  case VALUE_INT64:
+    value->status = uxml_to_uint( s, size, &u, &negative );
+    if( u > (unsigned long long)LLONG_MAX + negative )
+    {
+      u = (unsigned long long)LLONG_MAX + negative;
+      value->status = (value->status == UXML_OK) ? UXML_RANGE: value->status;
+    }
+    value->v.i = (negative && u != 0) ? -(long long)(u - 1) - 1: (long long)u;
+    break;
+  case VALUE_UINT64:
+    value->status = uxml_to_uint( s, size, &value->v.u, &negative );
+    if( negative && value->v.u != 0 )
+    {
+      value->v.u = 0;
+      value->status = (value->status == UXML_INVALID) ? UXML_INVALID: UXML_RANGE;
+    }
+    break;
+  case VALUE_BOOL:                     /* like in XML schema */
+    value->status = UXML_OK;
+    if( (size == 4 && memcmp( s, "true", 4 ) == 0) || (size == 1 && s[0] == '1') )
+      value->v.i = 1;
+    else if( !(size == 5 && memcmp( s, "false", 5 ) == 0) && !(size == 1 && s[0] == '0') )
+      value->status = UXML_INVALID;
+    break;
+#if !defined( UXML_DISABLE_DOUBLE )
+  case VALUE_DOUBLE:
+    value->status = uxml_to_double( s, size, &value->v.d );
+    break;
+#endif
+  }
+  if( c != NULL )
+  {
+    *c = *value;
+  }
+  return value->status;
+}
+
+int uxml_int64_e( uxml_node_t *node, const char *path, long long *value )
+{
+  uxml_value_t v;
+  int status = uxml_convert( uxml_node( node, path ), VALUE_INT64, &v );
+
+  if( value != NULL )
+    *value = v.v.i;
+  return status;
+}
+
+int uxml_uint64_e( uxml_node_t *node, const char *path, unsigned long long *value )
+{
+  uxml_value_t v;
+  int status = uxml_convert( uxml_node( node, path ), VALUE_UINT64, &v );
+
+  if( value != NULL )
+    *value = v.v.u;
+  return status;
+}
+
+int uxml_bool_e( uxml_node_t *node, const char *path, int *value )
+{
+  uxml_value_t v;
+  int status = uxml_convert( uxml_node( node, path ), VALUE_BOOL, &v );
+
+  if( value != NULL )
+    *value = (int)v.v.i;
+  return status;
+}
+
+long long uxml_int64( uxml_node_t *node, const char *path )
+{
+  long long value;
+
+  uxml_int64_e( node, path, &value );
+  return value;
+}
+
+unsigned long long uxml_uint64( uxml_node_t *node, const char *path )
+{
+  unsigned long long value;
+
+  uxml_uint64_e( node, path, &value );
+  return value;
+}
+
+int uxml_bool( uxml_node_t *node, const char *path )
+{
+  int value;
+
+  uxml_bool_e( node, path, &value );
+  return value;
+}
+
+#if !defined( UXML_DISABLE_DOUBLE )
+int uxml_double_e( uxml_node_t *node, const char *path, double *value )
+{
+  uxml_value_t v;
+  int status = uxml_convert( uxml_node( node, path ), VALUE_DOUBLE, &v );
 
-  if( p->node != NULL )                /* real parsing? */
+  if( value != NULL )
+    *value = (status == UXML_INVALID) ? 0.0: v.v.d;
+  return status;
+}
+
+double uxml_double( uxml_node_t *node, const char *path )
+{
+  uxml_value_t v;
+
+  uxml_convert( uxml_node( node, path ), VALUE_DOUBLE, &v ); /* number, which is followed by other text, is kept */
+  return v.v.d;
+}
+#endif
+
+int uxml_cache_values( uxml_node_t *root, int enable )
+{
+  uxml_t *p = INSTANCE( root );
+
+  if( !enable )
+  {
+    free( p->values );
+    p->values = NULL;
+  }
+  else if( p->values == NULL )         /* VALUE_NONE is 0 */
   {
-    n = p->node + p->node_index;       /* use current node */
+    p->values = (uxml_value_t *)calloc( p->nodes_count, sizeof( uxml_value_t ) );
+  }
+  return !enable || p->values != NULL;
+}
+
+void *uxml_user( uxml_node_t *node, const char *path )
+{
+  uxml_node_t *n = uxml_node( node, path );
+#if defined( UXML_COMPACT )
+  uxml_t *p;
+
+  if( n == NULL )
+    return NULL;
+  if( (n->self & ADDED_INDEX) != 0 )
+    return *uxml_added_user( n );
+  p = INSTANCE( n );
+  return (p->user != NULL) ? p->user[ n->self ]: NULL;
+#else
+  return (n != NULL) ? n->user: NULL;
+#endif
+}
+
+void uxml_set_user( uxml_node_t *node, const char *path, void *user )
+{
+  uxml_node_t *n = uxml_node( node, path );
+#if defined( UXML_COMPACT )
+  uxml_t *p;
 
-    n->type = XML_NODE;                /* type of node */
-    n->name = p->text + p->text_index; /* name of node */
-    n->name_length = 0;
-    n->content = p->text;              /* there is no content yet */
-    n->size = 0;
-    n->instance = p;                   /* our instance */
-    n->parent = parent_node;           /* no parent */
-    n->child = NULL;                   /* no child node(s) yet */
+  if( n == NULL )
+    return;
+  if( (n->self & ADDED_INDEX) != 0 )
+  {
+    *uxml_added_user( n ) = user;
+    return;
   }
-  p->node_index++;                     /* next node */
+  p = INSTANCE( n );
+  if( p->user == NULL && (p->user = (void **)calloc( p->nodes_count, sizeof( void * ) )) == NULL ) /* first user's pointer */
+    return;
+  p->user[ n->self ] = user;
+#else
+  if( n != NULL )
+    n->user = user;
+#endif
+}
 
-  if( p->text != NULL )                /* if text buffer present, */
+size_t uxml_size( uxml_node_t *node, const char *path )
+{
+  uxml_node_t *n = uxml_node( node, path );
+  return (n == NULL) ? 0: n->size;
+}
+
+/* step of compiled path */
+enum { STEP_NAME, STEP_PARENT, STEP_WILDCARD };
+
+typedef struct _uxml_step_t
+{
+  int type;                         /* STEP_NAME, STEP_PARENT or STEP_WILDCARD */
+  size_t index;                     /* index among nodes with the same name, NO_INDEX - no index */
+  const char *name;                 /* name in the copy of path, which follows steps */
+  size_t length;                    /* length of name */
+  unsigned int hash;                /* hash of name */
+} uxml_step_t;
+
+struct _uxml_path_t
+{
+  int absolute;                     /* path begins at root node */
+  size_t count;                     /* count of steps */
+  uxml_step_t step[1];              /* steps, then copy of path */
+};
+
+/*
+ * Parse step of path, which begins at \c s with non-separator character.
+ * Returns end of step, \c error is set in case of syntax error.
+ */
+static const char *uxml_parse_step( const char *s, uxml_step_t *t, const char **error )
+{
+  const char *e = NULL;
+
+  t->name = s;
+  t->index = NO_INDEX;
+  for( ; *s != 0 && *s != '/' && *s != '[' && *s != ']'; s++ );
+  t->length = (size_t)(s - t->name);
+  if( *s == '[' && t->length != 0 )
+  {
+    for( t->index = 0, s++; *s >= '0' && *s <= '9' && t->index < NO_INDEX / 10 - 1; s++ )
+    {
+      t->index = t->index * 10 + (size_t)(*s - '0');
+    }
+    if( *s == 0 || *s == '/' )
+      e = "Unterminated index";
+    else if( s[-1] == '[' || *s != ']' )
+      e = "Invalid index";
+    else if( *++s != 0 && *s != '/' )
+      e = "Extra character after index";
+  }
+  else if( *s == '[' || *s == ']' )
+  {
+    e = "Invalid character";
+  }
+  if( t->length == 2 && t->name[0] == '.' && t->name[1] == '.' )
+  {
+    t->type = STEP_PARENT;
+    if( t->index != NO_INDEX && e == NULL )
+      e = "Index of parent node";
+  }
+  else if( t->name[0] == '*' )
+  {
+    t->type = STEP_WILDCARD;
+    if( t->length != 1 && e == NULL )
+      e = "Wildcard is not whole name";
+  }
+  else
   {
-    p->text[ p->text_index ] = p->xml[ p->xml_index - 1 ];   /* store first character of name */
-    n->name_length++;
+    t->type = STEP_NAME;
+    t->hash = uxml_hash( (const unsigned char *)t->name, t->length );
   }
-  p->text_index++;                     /* go to next character */
+  *error = e;
+  return s;
+}
 
-  p->state = NODE_NAME;                /* new state - read instruction name */
-  while( p->xml_index != p->xml_size ) /* can read new character? */
+uxml_path_t *uxml_path_compile( const char *path, uxml_error_t *error )
+{
+  uxml_path_t *c;
+  const char *s, *e = NULL;
+  char *names;
+  size_t n = 1;
+
+  if( path == NULL )
   {
-    c0 = p->xml[ p->xml_index++ ];     /* get new character */
-    p->column++; 
-    p->c <<= 8;
-    p->escape <<= 1;
-    switch( c0 )
+    path = "";
+  }
+  for( s = path; *s != 0; s++ )        /* every step ends with '/' or end of path */
+  {
+    n += (*s == '/');
+  }
+  if( (c = (uxml_path_t *)malloc( sizeof( uxml_path_t ) + n * sizeof( uxml_step_t ) + (size_t)(s - path) + 1 )) == NULL )
+  {
+    if( error != NULL )
     {
-    case '&':                    /* is there escape? */
-      if( (p->state & ENABLE_ESCAPE) != 0 ) /* escape sequences only in attribute value or the content */
-      {
-        if( (c0 = uxml_get_escape( p )) == 0 )
-          return 0;
-        p->escape |= 1;
-      }
-      break;
-    case '\n': p->column = 0; p->line++; break;
-    case '\r': p->column = 0; break;
-    default: break;
+      error->text = "Insufficient memory";
+      error->line = error->column = 0;
     }
-    p->c |= c0;
-    if( p->state == NODE_NAME )        /* is name reading ? */
+    return NULL;
+  }
+  names = (char *)(c->step + n);
+  memcpy( names, path, (size_t)(s - path) + 1 );
+  c->absolute = (names[0] == '/');
+  c->count = 0;
+  for( s = names; *s != 0 && e == NULL; )
+  {
+    if( *s == '/' )                    /* empty name is skipped */
     {
-      if( (p->c & 0x0000FFFFU) == (('/' << 8) | '>') )
-      {
-        p->text_index++;               /* end name with zero-byte */
-        p->state = state;              /* restore outer state */
-        if( p->node != NULL )
-        {
-          if( parent_node != NULL )
-          {
-            if( parent_node->child == NULL )
-            {
-              parent_node->child = p->node + node_index;
-            }
-          }
-        }
-        return node_index;             /* dispatch done */
-      }
-      else if( c0 == '/' )
-      {
-        continue;
-      }
-      else if( c0 == '>' )
-      {
-        p->text_index++;               /* terminate name with zero byte */
-        p->state = NODE_CONTENT_TRIM;  /* start content dispatch */
-      }
-      else if( !isspace( c0 ) )           /* non-space character? that is name */
-      {
-        if( p->text != NULL )          /* if text buffer present, */
-        {
-          p->text[ p->text_index ] = c0; /* store current character of name */
-          n->name_length++;
-        }
-        p->text_index++;               /* go to next character */
-        name_len++;                    /* length of node's name */
-      }
-      else                             /* name over */
-      {
-        p->text_index++;               /* end name with zero-byte */
-        p->state = NODE_TAG;           /* go to read whole tag */
-      }
+      s++;
+      continue;
     }
-    else if( p->state == NODE_TAG )
+    s = uxml_parse_step( s, c->step + c->count++, &e );
+  }
+  if( e != NULL )
+  {
+    if( error != NULL )
+    {
+      error->text = e;
+      error->line = 0;
+      error->column = (int)(s - names); /* position in path */
+    }
+    free( c );
+    return NULL;
+  }
+  return c;
+}
+
+void uxml_path_free( uxml_path_t *path )
+{
+  free( path );
+}
+
+uxml_node_t *uxml_node_p( uxml_node_t *node, const uxml_path_t *path )
+{
+  uxml_t *p = INSTANCE( node );
+  const uxml_step_t *t;
+  uxml_node_t *n;
+  size_t i, k, id;
+
+  if( path == NULL )
+    return NULL;
+  n = path->absolute ? LINK( p->node, next ): node;
+  for( k = 0, t = path->step; k != path->count && n != NULL; k++, t++ )
+  {
+    switch( t->type )
     {
-      if( isalpha( c0 ) )            /* attribute begin with alphabet character? */
-      {
-        p->state = NODE_ATTR_NAME;     /* go to new state */
-        if( n != NULL )                /* while real parsing */
-        {
-          if( n->child == NULL )          /* and no one attribute was parsed yet */
-          {
-            n->child = p->node + p->node_index;  /* store attribute index */
-          }
-        }
-        if( a != NULL )                /* if it is not first attribute */
-        {
-          a->next = p->node + p->node_index; /* fill next of previous attribute */
-        }
-        if( p->node != NULL )          /* real dispatch? */
-        {
-          a = p->node + p->node_index; /* current node for attribute */
-          a->type = XML_ATTR;          /* this is attribute node */
-          a->name = p->text + p->text_index; /* name of attribute */
-          a->name_length = 0;
-          a->content = p->text;              /* add content later */
-          a->size = 0;
-          a->instance = p;             /* our instance */
-          a->parent = p->node + node_index; /* parent process instruction */
-          a->child = NULL;                /* attribute have no chid nodes */
-          a->next = NULL;                 /* no next node (yet) */
-        }
-        last_child = p->node_index;    /* new last child */
-        p->node_index++;
-        if( p->text != NULL )          /* if text buffer present, */
-        {
-          p->text[ p->text_index ] = c0; /* store first character of attribute's name */
-          a->name_length++;
-        }
-        p->text_index++;               /* prepare for next character */
-      }
-      else if( (p->c & 0x0000FFFFU) == (('/' << 8) | '>') )
-      {
-        p->state = state;              /* restore outer state */
-        if( p->node != NULL )
-        {
-          if( parent_node != NULL )
-          {
-            if( parent_node->child == NULL )
-            {
-              parent_node->child = p->node + node_index;
-            }
-          }
-        }
-        return node_index;             /* dispatch done */
-      }
-      else if( c0 == '>' )           /* node tag over */
-      {
-        p->state = NODE_CONTENT_TRIM;  /* start content dispatch */
-      }
-      else if( !isspace( c0 ) && c0 != '/' )      /* all other non-spaced symbols (digits, specials) */
+    case STEP_PARENT:
+      n = LINK( n, parent );
+      break;
+    case STEP_WILDCARD:
+      n = LINK( n, child );
+      for( i = 0; n != NULL && t->index != NO_INDEX; n = LINK( n, next ) ) /* only nodes are indexed */
       {
-        p->error = "Invalid character"; /* means error */
-        return 0;
+        if( n->type == XML_NODE && i++ == t->index )
+          break;
       }
+      break;
+    default:
+      id = uxml_find_name( p, (const unsigned char *)t->name, t->length, t->hash );
+      n = (id != 0) ? uxml_find_child( n, id, t->index ): NULL;
+      break;
     }
-    else if( p->state == NODE_ATTR_NAME )
+  }
+  return n;
+}
+
+const char *uxml_get_p( uxml_node_t *node, const uxml_path_t *path )
+{
+  return uxml_content( uxml_node_p( node, path ) );
+}
+
+int uxml_int_p( uxml_node_t *node, const uxml_path_t *path )
+{
+  const char *s = uxml_get_p( node, path );
+  return (s != NULL) ? (int)strtol( s, NULL, 0 ): 0;
+}
+
+#if !defined( UXML_DISABLE_DOUBLE )
+double uxml_double_p( uxml_node_t *node, const uxml_path_t *path )
+{
+  uxml_value_t v;
+
+  uxml_convert( uxml_node_p( node, path ), VALUE_DOUBLE, &v );
+  return v.v.d;
+}
+#endif
+
+uxml_iter_t uxml_find( uxml_node_t *node, const char *path )
+{
+  uxml_iter_t it;
+  uxml_step_t t;
+  const char *e = NULL;
+
+  memset( &it, 0, sizeof( it ) );
+  it.start = node;
+  if( path == NULL )
+  {
+    path = "";
+  }
+  if( path[0] == '/' )
+  {
+    it.start = LINK( INSTANCE( node )->node, next );
+  }
+  while( *path != 0 && e == NULL )
+  {
+    if( *path == '/' )                 /* empty name is skipped */
     {
-      if( isspace( c0 ) )
-      {
-        p->state = NODE_ATTR_EQ;       /* new state */
-        p->text_index++;               /* end name with zero byte */
-      }
-      else if( c0 == '=' )
-      {
-        p->state = NODE_ATTR_EQ_FOUND; /* new state */
-        p->text_index++;               /* end name with zero byte */
-      }
-      else
-      {
-        if( p->text != NULL )          /* if text buffer present, */
-        {
-          p->text[ p->text_index ] = c0; /* store next character of attribute's name */
-          a->name_length++;
-        }
-        p->text_index++;               /* go to next character */
-      }
+      path++;
+      continue;
     }
-    else if( p->state == NODE_ATTR_EQ )
+    if( it.count == UXML_ITER_STEPS )
     {
-      if( c0 == '=' )
-      {
-        p->state = NODE_ATTR_EQ_FOUND;
-      }
-      else if( !isspace( c0 ) )
-      {
-        p->error = "Extra character after attribute's name";
-        return 0;
-      }
+      e = "Too many steps";
+      break;
     }
-    else if( p->state == NODE_ATTR_EQ_FOUND )
+    path = uxml_parse_step( path, &t, &e );
+    it.type[ it.count ] = (unsigned char)t.type;
+    it.index[ it.count ] = t.index;
+    it.name[ it.count ] = (t.type == STEP_NAME) ? /* name, which is absent in document, matches nothing */
+      uxml_find_name( INSTANCE( node ), (const unsigned char *)t.name, t.length, t.hash ): 0;
+    it.count++;
+  }
+  if( e != NULL )
+  {
+    it.count = -1;                     /* invalid path matches nothing */
+  }
+  return it;
+}
+
+/*
+ * Get first node, which matches step \c k of iterator, among children of node \c n,
+ * or next node after node \c n, which matches the same step, if \c next is set
+ */
+static uxml_node_t *uxml_iter_match( uxml_iter_t *it, int k, uxml_node_t *n, int next )
+{
+  size_t i;
+
+  if( it->index[k] != NO_INDEX || it->type[k] == STEP_PARENT ) /* only one node matches */
+  {
+    if( next )
+      return NULL;
+    if( it->type[k] == STEP_PARENT )
+      return LINK( n, parent );
+    if( it->type[k] == STEP_NAME )
+      return uxml_find_child( n, it->name[k], it->index[k] );
+    for( i = 0, n = LINK( n, child ); n != NULL; n = LINK( n, next ) ) /* wildcard, only nodes are indexed */
     {
-      if( c0 == '\"' )               /* start attribute's value reading "value" */
-      {
-        p->state = NODE_ATTR_VALUE_DQ; /* double quoted value */
-        if( a != NULL )                /* of course, do not forget real parsing */
-        {
-          a->content = p->text + p->text_index;  /* content points to attribute's value */
-        }
-      }
-      else if( c0 == '\'' )          /* start attribute's value reading 'value' */
-      {
-        p->state = NODE_ATTR_VALUE_SQ; /* single quoted value */
-        if( a != NULL )                /* of course, do not forget real parsing */
-        {
-          a->content = p->text + p->text_index;  /* content points to attribute's value */
-        }
-      }
-      else if( !isspace( c0 ) )      /* error in other non-space character */
-      {
-        p->error = "Attribute value must begin with '\"' or '\''";
-        return 0;
-      }
+      if( n->type == XML_NODE && i++ == it->index[k] )
+        break;
     }
-    else if( p->state == NODE_ATTR_VALUE_DQ )
+    return n;
+  }
+  for( n = next ? LINK( n, next ): LINK( n, child ); n != NULL; n = LINK( n, next ) )
+  {
+    if( it->type[k] == STEP_WILDCARD || NAME_ID( n ) == it->name[k] )
+      break;
+  }
+  return n;
+}
+
+uxml_node_t *uxml_iter_next( uxml_iter_t *it )
+{
+  uxml_node_t *n;
+  int k;
+
+  if( it->start == NULL || it->count < 0 )
+    return NULL;
+  for( ;; )
+  {
+    if( it->advance )                  /* next match of last matched step, or of previous one */
     {
-      if( c0 == '\"' && ((p->escape & 1) == 0) ) /* value ended? */
+      if( (k = it->depth - 1) < 0 )
       {
-        p->text_index++;               /* end value with zero byte */
-        p->state = NODE_TAG;           /* return to tag dispatch */
+        it->count = -1;                /* no more matches */
+        return NULL;
       }
-      else
+      if( (n = uxml_iter_match( it, k, it->node[k], 1 )) == NULL )
       {
-        if( p->text != NULL )          /* while real parsing */
-        {
-          p->text[ p->text_index ] = c0; /* store next value character */
-        }
-        p->text_index++;               /* next byte for value */
-        if( a != NULL )
-        {
-          a->size++;
-        }
+        it->depth--;
+        continue;
       }
+      it->node[k] = n;
+      it->advance = 0;
     }
-    else if( p->state == NODE_ATTR_VALUE_SQ )
+    k = it->depth;
+    if( k == it->count )               /* all steps are matched */
     {
-      if( c0 == '\'' && ((p->escape & 1) == 0) ) /* value ended? */
-      {
-        p->text_index++;               /* end value with zero byte */
-        p->state = NODE_TAG;           /* return to tag dispatch */
-      }
-      else
-      {
-        if( p->text != NULL )          /* while real parsing */
-        {
-          p->text[ p->text_index ] = c0; /* store next value character */
-        }
-        p->text_index++;               /* next byte for value */
-        if( a != NULL )
-        {
-          a->size++;
-        }
-      }
+      it->advance = 1;
+      return (k != 0) ? it->node[ k - 1 ]: it->start;
     }
-    else if( p->state == NODE_CONTENT_TRIM || p->state == NODE_CONTENT )
+    if( (n = uxml_iter_match( it, k, (k != 0) ? it->node[ k - 1 ]: it->start, 0 )) == NULL )
     {
-      if( ( (p->c & 0x0000FFFFU) == (('<' << 8) | '!') && ((p->escape & 3) != 3) ) ||
-          ( (p->c & 0x00FFFFFFU) == (('<' << 16) | ('!' << 8) | '-') && ((p->escape & 7) != 7) ) )
-      {
-        continue;
-      }
-      if( ((p->c & 0x0000FF00U) == ('<' << 8)) && ((p->escape & 2) == 0) )
-      {
-        if( isalpha( c0 ) )          /* open new node? */
-        {
-          int k = content_end - content_begin;
-          int i;
+      it->advance = 1;
+      continue;
+    }
+    it->node[k] = n;
+    it->depth++;
+  }
+}
 
-          i = uxml_parse_node( p, p->node + node_index ); /* parse it */
-          if( !i )
-            return 0;
+size_t uxml_count( uxml_node_t *node, const char *path )
+{
+  uxml_iter_t it = uxml_find( node, path );
+  size_t count = 0;
 
-          if( p->node != NULL )         /* at real parsing stage */
-          {
-            if( last_child != 0 )
-            {
-              p->node[ last_child ].next = p->node + i; /* set-up next field of last child node */
-            }
-          }
-          last_child = i;               /* new last child */
+  while( uxml_iter_next( &it ) != NULL )
+  {
+    count++;
+  }
+  return count;
+}
 
-          if( k != 0 )                 /* if non-empty content */
-          {
-            if( p->text != NULL )      /* at real parsing */
-            {
-              for( i = 0; i != k; i++ )  /* copy content to new location */
-              {
-                p->text[ p->text_index + i ] = p->text[ content_begin + i ];
-              }
-            }
-            content_begin = p->text_index; /* new content's begin location */
-            p->text_index += k;            /* go to the next character */
-            content_end = p->text_index;   /* new content's end location */
-            if( n != NULL )
-            {
-              n->content = p->text + content_begin;  /* for real node, save new content's location too */
-            }
-          }
-        }
-        else if( c0 == '/' && ((p->escape & 1) == 0) )
-        {
-          p->text_index++;             /* end content with zero byte */
-          p->state = NODE_END;
-        }
-        else
-        {
-          p->error = "Invalid character";
-          return 0;
-        }
-      }
-      else if( p->c == (('<' << 24) | ('!' << 16) | ('-' << 8) | '-') && ((p->escape & 0xFU) != 0xFU) )
-      {
-        comment_state = p->state;      /* keep state before comment occured */
-        p->state = COMMENT;            /* comment in */
-      }
-      else if( c0 != '<' || (p->escape & 1) )           /* regular symbol of content */
-      {
-        if( p->state == NODE_CONTENT_TRIM )
-        {
-          if( !isspace( c0 ) )       /* non-space character? */
-          {
-            p->state = NODE_CONTENT;
-            if( content_begin != 0 )
-            {
-              if( p->text != NULL )    /* store it, if needed */
-              {
-                p->text[ p->text_index ] = ' '; /* store one space instead several */
-              }
-              p->text_index++;
-              if( n != NULL )
-              {
-                n->size++;
-              }
-            }
-            else
-            {
-              content_begin = p->text_index; /* the content begin. */
-            }
-            if( p->text != NULL )      /* store it, if needed */
-            {
-              p->text[ p->text_index ] = c0;
-            }
-            p->text_index++;               /* next character */
-            if( n != NULL )
-            {
-              n->size++;
-            }
-            content_end = p->text_index;   /* and content's end */
-          }
-        }
-        else                           /* need to read content */
-        {
-          if( isspace( c0 ) && ((p->escape & 1) == 0) )        /* all empty non-escaped characters will replaced with one space */
-          {
-            p->state = NODE_CONTENT_TRIM;
-          }
-          else
-          {
-            if( p->text != NULL )      /* store character, if needed */
-            {
-              p->text[ p->text_index ] = c0;
-            }
-            p->text_index++;             /* next character */
-            if( n != NULL )
-            {
-              n->size++;
-            }
-            content_end = p->text_index; /* and content's end */
-          }
-        }
-      }
+/*
+ * Field of record, which is bound by uxml_bind
+ */
+typedef struct _uxml_binding_t
+{
+  uxml_path_t *path;                /* compiled path of field, NULL - path is one name */
+  size_t id;                        /* name ID of field, which is one name, 0 - name is absent in document */
+  uxml_node_t *node;                /* node of field in current record */
+} uxml_binding_t;
+
+/*
+ * Store converted content of node \c n to field of record
+ */
+static void uxml_bind_field( void *field, int type, uxml_node_t *n )
+{
+  uxml_value_t v;
+
+  switch( type )
+  {
+  case UXML_FIELD_STRING:
+    *(const char **)field = uxml_content( n );
+    break;
+  case UXML_FIELD_NODE:
+    *(uxml_node_t **)field = n;
+    break;
+  case UXML_FIELD_INT:
+    uxml_convert( n, VALUE_INT64, &v );
+    *(int *)field = (v.v.i > INT_MAX) ? INT_MAX: (v.v.i < INT_MIN) ? INT_MIN: (int)v.v.i;
+    break;
+  case UXML_FIELD_INT64:
+    uxml_convert( n, VALUE_INT64, &v );
+    *(long long *)field = v.v.i;
+    break;
+  case UXML_FIELD_UINT64:
+    uxml_convert( n, VALUE_UINT64, &v );
+    *(unsigned long long *)field = v.v.u;
+    break;
+  case UXML_FIELD_BOOL:
+    uxml_convert( n, VALUE_BOOL, &v );
+    *(int *)field = (int)v.v.i;
+    break;
+#if !defined( UXML_DISABLE_DOUBLE )
+  case UXML_FIELD_DOUBLE:
+    uxml_convert( n, VALUE_DOUBLE, &v );
+    *(double *)field = v.v.d;
+    break;
+#endif
+  }
+}
+
+void *uxml_bind( uxml_node_t *node, const char *path, const uxml_field_t *fields, size_t fields_count,
+                 size_t size, size_t *count, uxml_error_t *error )
+{
+  uxml_t *p = INSTANCE( node );
+  uxml_binding_t *b;
+  uxml_path_t *c;
+  uxml_iter_t it;
+  uxml_node_t *r, *n;
+  unsigned char *records = NULL, *record;
+  size_t i, k, simple = 0, left, id, records_count = 0, records_size = 16;
+  const char *s;
+
+  if( count != NULL )
+    *count = 0;
+  if( (c = uxml_path_compile( path, error )) == NULL ) /* path of records is checked only */
+    return NULL;
+  uxml_path_free( c );
+  if( (b = (uxml_binding_t *)calloc( fields_count + 1, sizeof( uxml_binding_t ) )) == NULL ||
+      (records = (unsigned char *)malloc( records_size * size )) == NULL )
+    goto no_memory;
+  for( k = 0; k != fields_count; k++ ) /* field, which is one name, is found by one pass over children */
+  {
+    for( s = fields[k].path; *s != 0 && *s != '/' && *s != '[' && *s != ']' && *s != '*' && *s != '.'; s++ );
+    if( *s == 0 && s != fields[k].path )
+    {
+      b[k].id = uxml_find_name( p, (const unsigned char *)fields[k].path, (size_t)(s - fields[k].path),
+                                uxml_hash( (const unsigned char *)fields[k].path, (size_t)(s - fields[k].path) ) );
+      simple += (b[k].id != 0);
+    }
+    else if( (b[k].path = uxml_path_compile( fields[k].path, error )) == NULL )
+    {
+      records_count = 0;
+      free( records );
+      records = NULL;
+      goto done;
+    }
+  }
+  it = uxml_find( node, path );
+  while( (r = uxml_iter_next( &it )) != NULL )
+  {
+    if( records_count == records_size )
+    {
+      if( (record = (unsigned char *)realloc( records, records_size * 2 * size )) == NULL )
+        goto no_memory;
+      records = record;
+      records_size *= 2;
     }
-    else if( p->state == COMMENT )     /* is there comments inside? */
+    record = records + records_count++ * size;
+    memset( record, 0, size );
+    for( k = 0; k != fields_count; k++ )
     {
-      if( (p->c & 0x00FFFFFFU) == (('-' << 16) | ('-' << 8) | '>') ) /* comment over? */
-      {
-        p->state = comment_state;      /* restore state */
-      }
+      b[k].node = NULL;
     }
-    else if( p->state == NODE_END )    /* node end tag */
+    for( n = LINK( r, child ), left = simple; n != NULL && left != 0; n = LINK( n, next ) )
     {
-      if( name_end == 0 )              /* entry to end? */
+      for( id = NAME_ID( n ), k = 0; k != fields_count; k++ ) /* first node with such name */
       {
-        name_end = p->xml_index - 1;   /* keep end-name */
-      }
-      if( c0 == '>' )                /* node-end tag over? */
-      {
-        int i;
-
-        if( (p->xml_index - name_end - 1) != name_len )
-        {
-          p->error = "Different length of node's name";
-          return 0;
-        }
-        for( i = 0; i != name_len; i++ )
+        if( b[k].id == id && id != 0 && b[k].node == NULL )
         {
-          if( p->xml[ name + i ] != p->xml[ name_end + i ] )
-          {
-            p->error = "Different name at end of node";
-            return 0;
-          }
-        }
-        if( p->node != NULL )
-        {
-          p->node[ node_index ].content = p->text + content_begin;
-          if( parent_node != 0 )
-          {
-            if( parent_node->child == 0 ) /* if this is first child */
-            {
-              parent_node->child = p->node + node_index; /* parent will point to it */
-            }
-          }
+          b[k].node = n;
+          left--;
         }
-        p->state = state;              /* restore outer state */
-        return node_index;             /* dispatch done */
       }
     }
+    for( k = 0; k != fields_count; k++ )
+    {
+      uxml_bind_field( record + fields[k].offset, fields[k].type,
+                       (b[k].path != NULL) ? uxml_node_p( r, b[k].path ): b[k].node );
+    }
   }
-  if( p->error == NULL )
-    p->error = "Unterminated node";
-  return 0;
+  goto done;
+no_memory:
+  if( error != NULL )
+  {
+    error->text = "Insufficient memory";
+    error->line = error->column = 0;
+  }
+  records_count = 0;
+  free( records );
+  records = NULL;
+done:
+  if( b != NULL )
+  {
+    for( i = 0; i != fields_count; i++ )
+    {
+      uxml_path_free( b[i].path );
+    }
+    free( b );
+  }
+  if( count != NULL )
+    *count = records_count;
+  return records;
 }
 
-static int uxml_parse_doc( uxml_t *p )
+/* axis of query step */
+enum { AXIS_CHILD, AXIS_DESCENDANT, AXIS_PARENT, AXIS_SELF };
+
+/* type of query predicate */
+enum { PRED_INDEX, PRED_LAST, PRED_ATTR, PRED_CHILD };
+
+typedef struct _uxml_pred_t
 {
-  int root = 0;
-  int c0;
+  int type;                         /* PRED_INDEX, PRED_LAST, PRED_ATTR or PRED_CHILD */
+  size_t index;                     /* index for PRED_INDEX */
+  const char *name;                 /* name of attribute or child node in the copy of query */
+  size_t length;                    /* length of name */
+  unsigned int hash;                /* hash of name */
+  const char *value;                /* value to compare with, NULL - existence only */
+  size_t size;                      /* size of value */
+} uxml_pred_t;
 
-  while( p->xml_index != p->xml_size ) /* can read new character? */
+typedef struct _uxml_qstep_t
+{
+  int axis;                         /* AXIS_CHILD, AXIS_DESCENDANT, AXIS_PARENT or AXIS_SELF */
+  int type;                         /* type of matched nodes: XML_NODE or XML_ATTR */
+  const char *name;                 /* name in the copy of query, NULL - any name */
+  size_t length;                    /* length of name */
+  unsigned int hash;                /* hash of name */
+  size_t first;                     /* index of first predicate */
+  size_t count;                     /* count of predicates */
+} uxml_qstep_t;
+
+struct _uxml_query_t
+{
+  int absolute;                     /* query begins at root node */
+  size_t count;                     /* count of steps */
+  size_t preds;                     /* count of predicates */
+  uxml_qstep_t *step;               /* steps */
+  uxml_pred_t *pred;                /* predicates of all steps */
+};
+
+/*
+ * Parse predicate of query, which begins after '[' at \c s.
+ * Returns end of predicate, \c error is set in case of syntax error.
+ */
+static const char *uxml_parse_pred( const char *s, uxml_pred_t *t, const char **error )
+{
+  int quote;
+
+  t->name = NULL;
+  t->length = 0;
+  t->value = NULL;
+  t->size = 0;
+  if( *s >= '0' && *s <= '9' )
   {
-    c0 = p->xml[ p->xml_index++ ];     /* get new character */
-    p->column++; 
-    p->c <<= 8;
-    p->escape <<= 1;
-    switch( c0 )
+    t->type = PRED_INDEX;
+    for( t->index = 0; *s >= '0' && *s <= '9' && t->index < NO_INDEX / 10 - 1; s++ )
     {
-    case '&':                    /* is there escape? */
-      if( (p->state & ENABLE_ESCAPE) != 0 ) /* escape sequences only in attribute value or the content */
-      {
-        if( (c0 = uxml_get_escape( p )) == 0 )
-          return 0;
-        p->escape |= 1;
-      }
-      break;
-    case '\n': p->column = 0; p->line++; break;
-    case '\r': p->column = 0; break;
-    default: break;
+      t->index = t->index * 10 + (size_t)(*s - '0');
     }
-    p->c |= c0;
-    if( p->state == NONE )
+  }
+  else if( strncmp( s, "last()", 6 ) == 0 )
+  {
+    t->type = PRED_LAST;
+    s += 6;
+  }
+  else
+  {
+    t->type = PRED_CHILD;
+    if( *s == '@' )
     {
-      if( (p->c & 0x0000FF00U) == ('<' << 8) && isalpha( c0 ) )
-      {
-        if( root == 0 )
-        {
-          root = p->node_index;
-          if( !uxml_parse_node( p, 0 ) )
-            return 0;
-        }
-        else
-        {
-          p->error = "Multiple root node";
-          return 0;
-        }
-      }
-      else if( (p->c & 0x0000FFFFU) == (('<' << 8) | '?') )
-      {
-        if( !uxml_parse_inst( p ) )
-          return 0;
-      }
-      else if( p->c == (('<' << 24) | ('!' << 16) | ('-' << 8) | '-') )
+      t->type = PRED_ATTR;
+      s++;
+    }
+    for( t->name = s; *s != 0 && *s != '/' && *s != '[' && *s != ']' && *s != '=' && *s != '\'' && *s != '"'; s++ );
+    if( (t->length = (size_t)(s - t->name)) == 0 )
+    {
+      *error = (*s == 0) ? "Unterminated predicate": "Empty name";
+      return s;
+    }
+    t->hash = uxml_hash( (const unsigned char *)t->name, t->length );
+    if( *s == '=' )
+    {
+      if( (quote = *++s) != '\'' && quote != '"' )
       {
-        p->state = COMMENT;
+        *error = "Invalid predicate";
+        return s;
       }
-      else if( !(( (p->c & 0x00FFFFFFU) == (('<' << 16) | ('!' << 8) | '-') ) ||
-                 ( (p->c & 0x0000FFFFU) == (('<' << 8) | '!') ) ||
-                 ( c0 == '<' )) )
+      for( t->value = ++s; *s != 0 && *s != quote; s++ );
+      if( *s == 0 )
       {
-        if( !isspace( c0 ) )
-        {
-          p->error = "Unrelated character";
-          return 0;
-        }
+        *error = "Unterminated string";
+        return s;
       }
+      t->size = (size_t)(s++ - t->value);
     }
-    else if( p->state == COMMENT )
+  }
+  if( *s != ']' )
+  {
+    *error = (*s == 0) ? "Unterminated predicate": "Invalid predicate";
+    return s;
+  }
+  return s + 1;
+}
+
+uxml_query_t *uxml_query_compile( const char *query, uxml_error_t *error )
+{
+  uxml_query_t *q;
+  uxml_qstep_t *t;
+  const char *s, *e = NULL;
+  char *text;
+  size_t steps = 1, preds = 0;
+  int axis = AXIS_CHILD;
+
+  if( query == NULL )
+  {
+    query = "";
+  }
+  for( s = query; *s != 0; s++ )       /* every step ends with '/' or end of query */
+  {
+    steps += (*s == '/');
+    preds += (*s == '[');
+  }
+  if( (q = (uxml_query_t *)malloc( sizeof( uxml_query_t ) + steps * sizeof( uxml_qstep_t ) +
+                                   preds * sizeof( uxml_pred_t ) + (size_t)(s - query) + 1 )) == NULL )
+  {
+    if( error != NULL )
     {
-      if( (p->c & 0x00FFFFFFU) == (('-' << 16) | ('-' << 8) | '>') )
-      {
-        p->state = NONE;
-      }
+      error->text = "Insufficient memory";
+      error->line = error->column = 0;
     }
+    return NULL;
   }
-  if( root == 0 )
+  q->step = (uxml_qstep_t *)(q + 1);
+  q->pred = (uxml_pred_t *)(q->step + steps);
+  text = (char *)(q->pred + preds);
+  memcpy( text, query, (size_t)(s - query) + 1 );
+  q->absolute = (text[0] == '/');
+  q->count = 0;
+  q->preds = 0;
+  for( s = text; *s != 0 && e == NULL; )
   {
-    if( p->error == NULL )
+    if( *s == '/' )
+    {
+      axis = (s[1] == '/') ? AXIS_DESCENDANT: AXIS_CHILD;
+      s += (s[1] == '/') ? 2: 1;
+      if( *s == 0 || *s == '/' )
+        e = (*s == 0 && axis == AXIS_CHILD && s == text + 1) ? NULL: "Empty name"; /* "/" is root itself */
+      continue;
+    }
+    t = q->step + q->count++;
+    t->axis = axis;
+    t->type = XML_NODE;
+    t->first = q->preds;
+    t->count = 0;
+    if( *s == '@' )
+    {
+      t->type = XML_ATTR;
+      s++;
+    }
+    for( t->name = s; *s != 0 && *s != '/' && *s != '[' && *s != ']'; s++ );
+    t->length = (size_t)(s - t->name);
+    if( t->length == 0 )
+    {
+      e = (*s == ']') ? "Invalid character": "Empty name";
+    }
+    else if( t->type == XML_NODE && t->name[0] == '.' && (t->length == 1 || (t->length == 2 && t->name[1] == '.')) )
+    {
+      if( axis == AXIS_DESCENDANT )
+        e = "Descendant of parent node";
+      t->axis = (t->length == 2) ? AXIS_PARENT: AXIS_SELF;
+      t->name = NULL;
+    }
+    else if( t->name[0] == '*' )
+    {
+      if( t->length != 1 )
+        e = "Wildcard is not whole name";
+      t->name = NULL;
+    }
+    else
+    {
+      t->hash = uxml_hash( (const unsigned char *)t->name, t->length );
+    }
+    while( *s == '[' && e == NULL )
+    {
+      s = uxml_parse_pred( s + 1, q->pred + q->preds++, &e );
+      t->count++;
+    }
+    if( e == NULL && *s != 0 && *s != '/' )
     {
-      p->error = "No root node";
+      e = "Invalid character";
     }
+    axis = AXIS_CHILD;
   }
-  return root;
+  if( e != NULL )
+  {
+    if( error != NULL )
+    {
+      error->text = e;
+      error->line = 0;
+      error->column = (int)(s - text); /* position in query */
+    }
+    free( q );
+    return NULL;
+  }
+  return q;
 }
 
-uxml_node_t *uxml_parse( const char *xml_data, const int xml_length0, uxml_error_t *error )
+void uxml_query_free( uxml_query_t *query )
 {
-  uxml_t instance, *p = &instance;
-  void *v;
-  char *c;
-  int i, xml_length;
+  free( query );
+}
 
-  for( xml_length = xml_length0; xml_length != 0 && xml_data[ xml_length - 1 ] == 0; xml_length-- );
+/*
+ * Set of nodes, which is collected by query's step
+ */
+typedef struct _uxml_set_t
+{
+  uxml_node_t **node;               /* nodes, terminated by NULL */
+  size_t count;                     /* count of nodes */
+  size_t size;                      /* allocated count of nodes */
+  int sorted;                       /* nodes are in document order without repeats */
+} uxml_set_t;
 
-  p->xml = (const unsigned char *)xml_data;
-  p->xml_index = 0;
-  p->xml_size = xml_length;
-  p->text = NULL;
-  p->text_index = 0;
-  p->node = NULL;
-  p->node_index = 1;
-  p->state = NONE;
-  p->c = 0;
-  p->escape = 0;
-  p->line = 1;
-  p->column = 0;
-  p->error = NULL;
+/*
+ * Add node to the set
+ */
+static int uxml_set_add( uxml_set_t *set, uxml_node_t *n )
+{
+  uxml_node_t **node;
 
-  if( p->xml_size >= 3 )               /* if we have 3 bytes at least, */
-  {                                    /* check for UTF-8 byte order mark */
-    if( p->xml[0] == 0xEF && p->xml[1] == 0xBB && p->xml[2] == 0xBF )
+  if( set->count + 1 >= set->size )
+  {
+    if( set->size > (size_t)-1 / (4 * sizeof( uxml_node_t * )) ||
+        (node = (uxml_node_t **)realloc( set->node, 2 * set->size * sizeof( uxml_node_t * ) )) == NULL )
+      return 0;
+    set->node = node;
+    set->size *= 2;
+  }
+  if( set->count != 0 && set->node[ set->count - 1 ] >= n ) /* nodes are indexed in document order */
+  {
+    set->sorted = 0;
+  }
+  set->node[ set->count++ ] = n;
+  return 1;
+}
+
+static int uxml_cmp_nodes( const void *a, const void *b )
+{
+  const uxml_node_t *n1 = *(uxml_node_t * const *)a, *n2 = *(uxml_node_t * const *)b;
+
+  return (n1 < n2) ? -1: (n1 > n2);
+}
+
+/*
+ * Get next node after \c n in document order among descendants of \c top, or NULL
+ */
+static uxml_node_t *uxml_walk( uxml_node_t *top, uxml_node_t *n )
+{
+  if( LINK( n, child ) != NULL )
+    return LINK( n, child );
+  while( n != top && LINK( n, next ) == NULL )
+  {
+    n = LINK( n, parent );
+  }
+  return (n != top) ? LINK( n, next ): NULL;
+}
+
+/*
+ * Restore document order of the set, when tree is changed after parse and
+ * nodes of array are not in document order: tree, which contains the set, is walked,
+ * and its nodes are looked up in the set, which is sorted by address.
+ * Returns 0 if there is no memory.
+ */
+static int uxml_order_set( uxml_set_t *set )
+{
+  uxml_node_t **node, *top, *n;
+  size_t i;
+
+  if( (node = (uxml_node_t **)malloc( set->size * sizeof( uxml_node_t * ) )) == NULL )
+    return 0;
+  for( top = set->node[0]; LINK( top, parent ) != NULL; top = LINK( top, parent ) );
+  for( i = 0, n = top; n != NULL && i != set->count; n = uxml_walk( top, n ) )
+  {
+    if( bsearch( &n, set->node, set->count, sizeof( uxml_node_t * ), uxml_cmp_nodes ) != NULL )
+      node[ i++ ] = n;
+  }
+  free( set->node );
+  set->node = node;
+  set->count = i;
+  return 1;
+}
+
+/*
+ * Check, whether node has attribute or child node with specified name, and value
+ */
+static int uxml_match_pred( uxml_node_t *n, const uxml_pred_t *t, size_t id )
+{
+  int type = (t->type == PRED_ATTR) ? XML_ATTR: XML_NODE;
+
+  if( id == 0 )                        /* name is absent in document */
+    return 0;
+  for( n = LINK( n, child ); n != NULL; n = LINK( n, next ) )
+  {
+    if( n->type == XML_ATTR && type == XML_NODE ) /* attributes are first children */
+      continue;
+    if( n->type != type )
+      break;
+    if( NAME_ID( n ) == id && (t->value == NULL || (n->size == t->size && memcmp( CONTENT( INSTANCE( n ), n ), t->value, t->size ) == 0)) )
+      return 1;
+  }
+  return 0;
+}
+
+/*
+ * Filter nodes of the set from \c begin by predicates of step
+ */
+static void uxml_filter_set( uxml_set_t *set, size_t begin, const uxml_query_t *query, const uxml_qstep_t *step, const size_t *ids )
+{
+  const uxml_pred_t *t;
+  size_t i, k, j;
+
+  for( j = 0; j != step->count && set->count != begin; j++ )
+  {
+    t = query->pred + step->first + j;
+    if( t->type == PRED_INDEX || t->type == PRED_LAST )
     {
-      p->xml += 3;                     /* simple skip BOM */
-      p->xml_size -= 3;
+      k = (t->type == PRED_LAST) ? set->count - 1: begin + t->index;
+      if( k < set->count && k >= begin )
+      {
+        set->node[ begin ] = set->node[k];
+        set->count = begin + 1;
+      }
+      else
+      {
+        set->count = begin;
+      }
+      continue;
+    }
+    for( i = k = begin; i != set->count; i++ )
+    {
+      if( uxml_match_pred( set->node[i], t, ids[ step->first + j ] ) )
+        set->node[ k++ ] = set->node[i];
+    }
+    set->count = k;
+  }
+}
+
+/*
+ * Check, whether node matches the name test of step
+ */
+#define UXML_MATCH_STEP( n, step, id ) \
+  ((n)->type == (step)->type && ((step)->name == NULL || NAME_ID( n ) == (id)))
+
+/*
+ * Collect nodes, which match step, for every node of context set
+ */
+static int uxml_select_step( uxml_set_t *context, uxml_set_t *set, const uxml_query_t *query, const uxml_qstep_t *step, const size_t *ids )
+{
+  uxml_node_t *c, *n, *last = NULL;
+  size_t i, begin, id = ids[ query->preds + (size_t)(step - query->step) ];
+
+  set->count = 0;
+  set->sorted = 1;
+  if( step->name != NULL && id == 0 )  /* name is absent in document */
+    return 1;
+  for( i = 0; i != context->count; i++ )
+  {
+    c = context->node[i];
+    begin = set->count;
+    switch( step->axis )
+    {
+    case AXIS_SELF:
+      if( !uxml_set_add( set, c ) )
+        return 0;
+      break;
+    case AXIS_PARENT:
+      if( (n = LINK( c, parent )) != NULL && !uxml_set_add( set, n ) )
+        return 0;
+      break;
+    case AXIS_CHILD:
+      for( n = LINK( c, child ); n != NULL; n = LINK( n, next ) )
+      {
+        if( UXML_MATCH_STEP( n, step, id ) && !uxml_set_add( set, n ) )
+          return 0;
+      }
+      break;
+    case AXIS_DESCENDANT:
+      if( INSTANCE( c )->modified )    /* changed tree is walked */
+      {
+        for( n = LINK( c, child ); n != NULL; n = uxml_walk( c, n ) )
+        {
+          if( UXML_MATCH_STEP( n, step, id ) && !uxml_set_add( set, n ) )
+            return 0;
+        }
+        break;
+      }
+      /* descendants follow node in array of nodes up to the last descendant */
+      if( last != NULL && c <= last && step->count == 0 ) /* descendants of this node are collected already */
+        continue;
+      for( last = c; (n = uxml_last_child( last )) != NULL; last = n );
+      for( n = c + 1; n <= last; n++ )
+      {
+        if( UXML_MATCH_STEP( n, step, id ) && !uxml_set_add( set, n ) )
+          return 0;
+      }
+      break;
     }
+    uxml_filter_set( set, begin, query, step, ids );
+  }
+  if( context->count != 0 && INSTANCE( context->node[0] )->modified ) /* addresses don't follow document order */
+  {
+    set->sorted = (context->count == 1);
   }
-  if( !uxml_parse_doc( p ) )
+  if( !set->sorted )                   /* restore document order, remove repeats */
   {
-    if( error != NULL )
+    qsort( set->node, set->count, sizeof( uxml_node_t * ), uxml_cmp_nodes );
+    for( i = begin = 0; i != set->count; i++ )
     {
-      error->text = p->error;
-      error->line = p->line;
-      error->column = p->column;
+      if( begin == 0 || set->node[ begin - 1 ] != set->node[i] )
+        set->node[ begin++ ] = set->node[i];
     }
-    return NULL;
+    set->count = begin;
+    if( set->count != 0 && INSTANCE( set->node[0] )->modified && !uxml_order_set( set ) )
+      return 0;
   }
-  i = sizeof( uxml_t ) + 1 + p->text_index + 1 + p->node_index * sizeof( uxml_node_t );
+  return 1;
+}
+
+uxml_node_t **uxml_select( uxml_node_t *node, const uxml_query_t *query, size_t *count )
+{
+  uxml_t *p = INSTANCE( node );
+  uxml_set_t set[2], *context = set, *next = set + 1, *t;
+  const uxml_qstep_t *step;
+  const uxml_pred_t *pred;
+  size_t i, *ids = NULL;
+  int ok = 1;
 
-  if( (v = malloc( i )) == NULL )
+  if( count != NULL )
   {
-    error->text = "Insufficient memory";
-    return 0;
+    *count = 0;
   }
-  memset( v, 0, i );
-  p->initial_allocated = i;
-
-  p = (uxml_t *)v;
-  c = (char *)v;
-  memcpy( p, &instance, sizeof( uxml_t ) );
-  c += sizeof( uxml_t );
-  p->node = (uxml_node_t *)c;
-  c += (sizeof( uxml_node_t ) * p->node_index);
-  p->text = (unsigned char *)c;
-
-  p->xml = (const unsigned char *)xml_data;
-  p->xml_index = 0;
-  p->xml_size = xml_length;
-  p->text_size = p->text_index + 1;
-  p->text_index = 1;
-  p->nodes_count = p->node_index;
-  p->node_index = 1;
-  p->state = NONE;
-  p->c = 0;
-  p->line = 1;
-  p->column = 0;
-  p->error = NULL;
-
-  if( p->xml_size >= 3 )               /* if we have 3 bytes at least */
-  {                                    /* check for UTF-8 byte order mark */
-    if( p->xml[0] == 0xEF && p->xml[1] == 0xBB && p->xml[2] == 0xBF )
-    {
-      p->xml += 3;                     /* simple skip BOM */
-      p->xml_size -= 3;
-    }
+  if( query == NULL )
+    return NULL;
+  for( i = 0; i != 2; i++ )
+  {
+    set[i].count = 0;
+    set[i].size = 16;
+    set[i].sorted = 1;
+    set[i].node = (uxml_node_t **)malloc( set[i].size * sizeof( uxml_node_t * ) );
   }
-  if( (i = uxml_parse_doc( p )) == 0 )
+  if( set[0].node == NULL || set[1].node == NULL ||
+      (ids = (size_t *)malloc( (query->preds + query->count + 1) * sizeof( size_t ) )) == NULL )
   {
-    if( error != NULL )
-    {
-      error->text = p->error;
-      error->line = p->line;
-      error->column = p->column;
-    }
+    free( set[0].node );
+    free( set[1].node );
+    return NULL;
+  }
+  /* names of query are resolved once, name, which is absent in document, matches nothing */
+  for( i = 0, pred = query->pred; i != query->preds; i++, pred++ )
+  {
+    ids[i] = (pred->name != NULL) ? uxml_find_name( p, (const unsigned char *)pred->name, pred->length, pred->hash ): 0;
+  }
+  for( i = 0, step = query->step; i != query->count; i++, step++ )
+  {
+    ids[ query->preds + i ] = (step->name != NULL) ? uxml_find_name( p, (const unsigned char *)step->name, step->length, step->hash ): 0;
+  }
+  context->node[ context->count++ ] = query->absolute ? LINK( p->node, next ): node;
+  for( i = 0, step = query->step; i != query->count && context->count != 0 && ok; i++, step++ )
+  {
+    ok = uxml_select_step( context, next, query, step, ids );
+    t = context;
+    context = next;
+    next = t;
+  }
+  free( ids );
+  free( next->node );
+  if( !ok )
+  {
+    free( context->node );
     return NULL;
   }
-  p->node[0].next = p->node + i;
-  return p->node + i;
+  context->node[ context->count ] = NULL;
+  if( count != NULL )
+  {
+    *count = context->count;
+  }
+  return context->node;
 }
 
-void uxml_free( uxml_node_t *node )
+/*
+ * Children of node \c n are changed: its index of children is dropped,
+ * the entry is kept in the hash table as deleted one, and freed by uxml_free.
+ */
+static void uxml_children_changed( uxml_node_t *n )
 {
-  free( node->instance );
-}
+  uxml_t *p = INSTANCE( n );
+  uxml_children_t *c;
+  size_t i, parent;
 
-uxml_node_t *uxml_child( uxml_node_t *node )
-{
-  return node->child;
+  p->modified = 1;
+  if( (n->flags & CHILDREN_CHANGED) != 0 )
+    return;
+  n->flags |= CHILDREN_CHANGED;
+  if( p->children == NULL || (n->flags & NODE_ADDED) != 0 )
+    return;
+  parent = (size_t)(n - p->node);
+  for( i = parent & p->children_mask; (c = p->children[i]) != NULL; i = (i + 1) & p->children_mask )
+  {
+    if( c->parent == parent )
+    {
+      c->parent = NO_INDEX;
+      break;
+    }
+  }
 }
 
-uxml_node_t *uxml_child_node( uxml_node_t *node )
+/*
+ * Replace content of node \c n with copy of \c s in the arena
+ */
+static int uxml_replace_content( uxml_node_t *n, const char *s )
 {
-  uxml_node_t *n = node->child;
+  uxml_t *p = INSTANCE( n );
+  size_t size = (s != NULL) ? strlen( s ): 0;
+  unsigned char *a;
+#if defined( UXML_COMPACT )
+  size_t i;
 
-  while( n != NULL )
+  if( size > UXML_INDEX_MAX )
+    return 0;
+#endif
+  if( (a = uxml_arena_copy( p, (const unsigned char *)(s != NULL ? s: ""), size )) == NULL )
+    return 0;
+#if defined( UXML_COMPACT )
+  if( (i = uxml_ext( p, a )) == NO_INDEX )
+    return 0;
+  n->content = (uxml_index_t)i;
+  n->size = (uxml_index_t)size;
+  n->flags |= CONTENT_EXT;
+#else
+  n->content = a;
+  n->size = size;
+#endif
+  n->flags &= ~CONTENT_REF;
+  if( p->values != NULL && (n->flags & NODE_ADDED) == 0 ) /* converted value is dropped */
   {
-    if( n->type == XML_NODE )
-      break;
-    n = n->next;
+    p->values[ n - p->node ].type = VALUE_NONE;
   }
-  return n;
+  return 1;
 }
 
-uxml_node_t *uxml_first_attr( uxml_node_t *node )
+/*
+ * Intern name, which is added after parse, its copy is kept in the arena.
+ * Returns ID of name, 0 - there is no memory.
+ */
+static size_t uxml_intern( uxml_t *p, const char *name )
 {
-  uxml_node_t *n = node->child;
+  size_t length = strlen( name ), id;
+  unsigned int hash = uxml_hash( (const unsigned char *)name, length );
+  unsigned char *s;
 
-  while( n != NULL )
-  {
-    if( n->type == XML_ATTR )
-      break;
-    n = n->next;
-  }
-  return n;
+  if( (id = uxml_find_name( p, (const unsigned char *)name, length, hash )) != 0 )
+    return id;
+  if( (s = uxml_arena_copy( p, (const unsigned char *)name, length )) == NULL ||
+      (id = uxml_add_name( p, 0, length, hash )) == 0 )
+    return 0;
+  p->names[ id ].copy = s;
+  return id;
 }
 
-uxml_node_t *uxml_next_attr( uxml_node_t *node )
+/*
+ * Allocate new node in the arena and link it to \c parent after child \c after,
+ * or as first child, if \c after is NULL.
+ * Returns NULL if there is no memory.
+ */
+static uxml_node_t *uxml_insert( uxml_node_t *parent, uxml_node_t *after, int type, const char *name, const char *content )
 {
-  uxml_node_t *n = node->next;
+  uxml_t *p = INSTANCE( parent );
+  uxml_node_t *n, *first = LINK( parent, child ), *next;
+  size_t id;
 
-  while( n != NULL )
+  if( (id = uxml_intern( p, name )) == 0 )
+    return NULL;
+  /* nodes are aligned in the arena, the rest of last block may be skipped */
+  p->arena_index = (p->arena_index + sizeof( void * ) - 1) & ~(sizeof( void * ) - 1);
+  if( p->arena_index > p->arena_size )
   {
-    if( n->type == XML_ATTR )
-      break;
-    n = n->next;
+    p->arena_index = p->arena_size;
+  }
+#if defined( UXML_COMPACT )
+  if( (n = uxml_added_alloc( p )) == NULL )
+    return NULL;
+  n->name = (uxml_index_t)id;
+#else
+  if( (n = (uxml_node_t *)uxml_arena_alloc( p, sizeof( uxml_node_t ) )) == NULL )
+    return NULL;
+  memset( n, 0, sizeof( uxml_node_t ) );
+  n->name = p->names[ id ].copy != NULL ? p->names[ id ].copy: p->text + p->names[ id ].name;
+  n->name_id = (unsigned int)id;
+  n->instance = p;
+#endif
+  n->type = type;
+  n->flags = NODE_ADDED | CHILDREN_CHANGED; /* children of added node are never indexed */
+  if( !uxml_replace_content( n, content ) )
+    return NULL;
+  next = (after != NULL) ? LINK( after, next ): first;
+  SET_NODE( p, n, parent, parent );
+  SET_NODE( p, n, next, next );
+#if !defined( UXML_DISABLE_PREV )
+  if( after != NULL )
+  {
+    SET_NODE( p, n, prev, after );
+    if( next != NULL )
+      SET_NODE( p, next, prev, n );
+    else
+      SET_NODE( p, first, prev, n );    /* first child refers to new last one */
+  }
+  else
+  {
+    SET_NODE( p, n, prev, (first != NULL) ? LINK( first, prev ): n );
+    if( first != NULL )
+      SET_NODE( p, first, prev, n );
   }
+#endif
+  if( after != NULL )
+    SET_NODE( p, after, next, n );
+  else
+    SET_NODE( p, parent, child, n );
+  uxml_children_changed( parent );
   return n;
 }
 
-uxml_node_t *uxml_next( uxml_node_t *node )
+uxml_node_t *uxml_add_child( uxml_node_t *node, const char *name, const char *content )
 {
-  return node->next;
+  if( node == NULL || node->type != XML_NODE || name == NULL || *name == 0 )
+    return NULL;
+  return uxml_insert( node, uxml_last_child( node ), XML_NODE, name, content );
 }
 
-uxml_node_t *uxml_prev( uxml_node_t *node )
+int uxml_set_content( uxml_node_t *node, const char *path, const char *content )
 {
-  uxml_node_t *prev = NULL, *n = node->parent;
+  uxml_node_t *n = uxml_node( node, path );
 
-  if( n == NULL ) return NULL;
-  for( n = n->child; n != node; n = n->next )
+  if( n == NULL || n->type == XML_INST )
+    return 0;
+  return uxml_replace_content( n, content );
+}
+
+int uxml_set_attr( uxml_node_t *node, const char *name, const char *value )
+{
+  uxml_node_t *n, *last = NULL;
+  size_t length;
+
+  if( node == NULL || node->type != XML_NODE || name == NULL || *name == 0 )
+    return 0;
+  length = strlen( name );
+  for( n = LINK( node, child ); n != NULL && n->type == XML_ATTR; n = LINK( n, next ) )
   {
-    prev = n;
+    if( NAME_LENGTH( INSTANCE( n ), n ) == length && memcmp( NAME( INSTANCE( n ), n ), name, length ) == 0 )
+      return uxml_replace_content( n, value );
+    last = n;
   }
-  return prev;
+  return uxml_insert( node, last, XML_ATTR, name, value ) != NULL; /* new attribute follows the last one */
 }
 
-const char *uxml_name( uxml_node_t *node )
+int uxml_remove( uxml_node_t *node )
 {
-  return (const char *)node->name;
+  uxml_t *p;
+  uxml_node_t *parent, *prev, *next;
+
+  if( node == NULL || (parent = LINK( node, parent )) == NULL )
+    return 0;
+  p = INSTANCE( node );
+  prev = uxml_prev( node );
+  next = LINK( node, next );
+  if( prev != NULL )
+    SET_NODE( p, prev, next, next );
+  else
+    SET_NODE( p, parent, child, next );
+#if !defined( UXML_DISABLE_PREV )
+  if( next != NULL )
+    SET_NODE( p, next, prev, (prev != NULL) ? prev: LINK( node, prev ) ); /* new first child refers to the last one */
+  else if( prev != NULL )
+    SET_NODE( p, LINK( parent, child ), prev, prev ); /* first child refers to new last one */
+  SET_NODE( p, node, prev, node );
+#endif
+  SET_NODE( p, node, parent, (uxml_node_t *)NULL );
+  SET_NODE( p, node, next, (uxml_node_t *)NULL );
+  uxml_children_changed( parent );
+  return 1;
 }
 
-#define MASK_SQUARE_OPEN  1
-#define MASK_SQUARE_CLOSE 2
-#define MASK_INDEX        4
-#define MASK_WILDCARD     8
 
-uxml_node_t *uxml_node( uxml_node_t *node, const char *ipath )
+#if defined( _MSC_VER )
+#pragma warning(disable:4996)
+#endif
+
+#if !defined( UXML_DISABLE_MMAP )
+/*
+ * Map regular file to memory read-only and parse it, without copy of XML data.
+ * Returns 0 if file can't be mapped: it is pipe, special or empty file.
+ */
+static int uxml_load_map( const char *xml_file, uxml_node_t **root, uxml_error_t *error )
 {
-  uxml_t *p = node->instance;
-  const char *path = ipath, *s1, *s2;
-  int c, i, len, mask = 0, index = 0;
-  uxml_node_t *n = node;
+#if defined( _WIN32 )
+  HANDLE f, m;
+  LARGE_INTEGER size;
+  void *v = NULL;
 
-  /* NULL path is equal to empty string */
-  if( path == NULL )
+  if( (f = CreateFileA( xml_file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL )) == INVALID_HANDLE_VALUE )
+    return 0;
+  if( GetFileType( f ) == FILE_TYPE_DISK && GetFileSizeEx( f, &size ) && size.QuadPart > 0 && (ULONGLONG)size.QuadPart == (SIZE_T)size.QuadPart &&
+      (m = CreateFileMappingA( f, NULL, PAGE_READONLY, 0, 0, NULL )) != NULL )
   {
-    path = "";
+    if( (v = MapViewOfFile( m, FILE_MAP_READ, 0, 0, 0 )) != NULL )
+    {
+      *root = uxml_parse( (const char *)v, (size_t)size.QuadPart, error );
+      UnmapViewOfFile( v );
+    }
+    CloseHandle( m );
   }
-  /* Go from root? */
-  if( path[0] == '/' )
+  CloseHandle( f );
+  return v != NULL;
+#else
+  struct stat st;
+  void *v = MAP_FAILED;
+  int fd;
+
+  if( (fd = open( xml_file, O_RDONLY )) < 0 )
+    return 0;
+  if( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size > 0 && (off_t)(size_t)st.st_size == st.st_size &&
+      (v = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 )) != MAP_FAILED )
   {
-    n = p->node[0].next;
-    path++;
+#if defined( POSIX_MADV_SEQUENTIAL )
+    posix_madvise( v, st.st_size, POSIX_MADV_SEQUENTIAL ); /* read ahead, pages behind may be dropped */
+#endif
+    *root = uxml_parse( (const char *)v, (size_t)st.st_size, error );
+    munmap( v, st.st_size );
   }
-  /* scan string */
-  for( s1 = path, s2 = path, len = 0; *s2 != 0; s2++ )
+  close( fd );
+  return v != MAP_FAILED;
+#endif
+}
+#endif
+
+/*
+ * Read whole file by parts until its end, size of file may be unknown.
+ * Returns allocated buffer with XML data, or NULL in case of error.
+ */
+static char *uxml_load_read( FILE *fp, size_t *size, uxml_error_t *error )
+{
+  char *b = NULL, *c;
+  size_t n = 0, k, allocated = 0;
+
+  for( ;; )
   {
-    /* current character */
-    c = *s2;
-    /* separator ? */
-    if( c == '/' )
+    if( n == allocated )
     {
-      /* empty name? - skip it */
-      if( s1 == s2 )
-      {
-        s1 = s2 + 1;
-        len = 0;
-        continue;
-      }
-      /* special case of ".." - parent node */
-      if( len == 2 )
-      {
-        if( s1[0] == '.' && s1[1] == '.' )
-        {
-          if( n->parent == NULL )
-          {
-            return NULL;
-          }
-          n = n->parent;
-          s1 = s2 + 1;
-          len = 0;
-          continue;
-        }
-      }
-      /* mask of name */
-      switch( mask )
+      if( allocated > (size_t)-1 / 2 )
       {
-      case 0: /* regular case - name only */
-        for( n = n->child; n != NULL; n = n->next )
-        {
-          /* look at only same length names */
-          if( len == n->name_length )
-          {
-            /* is our name? */
-            if( memcmp( s1, n->name, len ) == 0 )
-            {
-              /* go next */
-              s1 = s2 + 1;
-              len = 0;
-              break;
-            }
-          }
-        }
-        break;
-      case MASK_WILDCARD: /* wildcard "*" instead name */
-        n = n->child; /* first child gettin' */
-        break;
-      case (MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
-        /* index present, but no wildcard */
-        for( i = 0, n = n->child; n != NULL; n = n->next )
-        {
-          /* only nodes is considered */
-          if( n->type != XML_NODE )
-            continue;
-          /* look at only same length names */
-          if( len == n->name_length )
-          {
-            /* is our name? */
-            if( memcmp( s1, n->name, len ) == 0 )
-            {
-              /* and our index? */
-              if( i == index )
-              {
-                /* go next */
-                s1 = s2 + 1;
-                len = 0;
-                break;
-              }
-              /* next index */
-              i++;
-            }
-          }
-        }
-        break;
-      case (MASK_WILDCARD | MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
-        /* wildcard and index, i.e. *[NN] */
-        for( i = 0, n = n->child; n != NULL; n = n->next )
-        {
-          /* only nodes */
-          if( n->type != XML_NODE )
-            continue;
-          /* only index compare */
-          if( i == index )
-          {
-            /* go next */
-            s1 = s2 + 1;
-            len = 0;
-            break;
-          }
-          /* next index */
-          i++;
-        }
-        break;
-      default:
-        /* other cases is wrong */
-        n = NULL;
-        break; 
+        free( b );
+        error->text = "File is too large"; error->line = error->column = 0;
+        return NULL;
       }
-      /* if NULL, nothing to do */
-      if( n == NULL )
+      allocated = (allocated != 0) ? 2 * allocated: 65536;
+      if( (c = (char *)realloc( b, allocated )) == NULL )
       {
+        free( b );
+        error->text = "malloc failed"; error->line = error->column = 0;
         return NULL;
       }
-      /* new name, clear mask */
-      mask = 0;
+      b = c;
     }
-    else if( c == '*' && s1 == s2 )
+    if( (k = fread( b + n, 1, allocated - n, fp )) == 0 )
+      break;
+    n += k;
+  }
+  if( ferror( fp ) )
+  {
+    free( b );
+    error->text = "fread failed"; error->line = error->column = 0;
+    return NULL;
+  }
+  *size = n;
+  return b;
+}
+
+uxml_node_t *uxml_load( const char *xml_file, uxml_error_t *error )
+{
+  FILE *fp;
+  char *b;
+  size_t n;
+  uxml_node_t *root = NULL;
+
+#if !defined( UXML_DISABLE_MMAP )
+  if( uxml_load_map( xml_file, &root, error ) )
+    return root;
+#endif
+  if( (fp = fopen( xml_file, "rb" )) == NULL )
+  {
+    error->text = "fopen failed"; error->line = error->column = 0;
+    return NULL;
+  }
+  b = uxml_load_read( fp, &n, error );
+  fclose( fp );
+  if( b == NULL )
+    return NULL;
+  root = uxml_parse( b, n, error );
+  free( b );
+  return root;
+}
+
+/*
+ * Output of writer: user's buffer, or buffer, which is flushed to file
+ */
+typedef struct _uxml_output_t
+{
+  unsigned char *buffer;            /* output buffer */
+  size_t size;                      /* size of buffer */
+  size_t used;                      /* count of bytes in buffer */
+  size_t length;                    /* total length of output */
+  uxml_flush_t flush;               /* user's callback, which gets full buffer, NULL - file or user's buffer */
+  void *user;                       /* user's pointer of callback */
+  int fd;                           /* file descriptor, -1 - user's buffer, output behind its end is dropped */
+  int error;                        /* write to file failed */
+} uxml_output_t;
+
+/* spaces of indentation, which are written by parts */
+static const char uxml_indent[] = "                                                                ";
+
+/*
+ * Pass buffer to callback or write it to file, it is empty after that.
+ * Returns 0, if buffer is user's one, or write failed.
+ */
+static int uxml_output_flush( uxml_output_t *o )
+{
+  size_t i;
+#if defined( _WIN32 )
+  int k;
+#else
+  ssize_t k;
+#endif
+
+  if( o->flush != NULL )
+  {
+    if( o->used != 0 && !o->error && !o->flush( o->user, (const char *)o->buffer, o->used ) )
+      o->error = 1;
+    o->used = 0;
+    return !o->error;
+  }
+  if( o->fd < 0 )
+    return 0;
+  for( i = 0; i < o->used && !o->error; i += (size_t)k )
+  {
+#if defined( _WIN32 )
+    k = _write( o->fd, o->buffer + i, (unsigned int)(o->used - i) );
+#else
+    k = write( o->fd, o->buffer + i, o->used - i );
+#endif
+    if( k < 0 && errno == EINTR )      /* interrupted by signal before any data was written */
     {
-      /* wildcard is only one first character */
-      mask |= MASK_WILDCARD;
+      k = 0;
     }
-    else if( c == '[' && s1 != s2 )
+    else if( k <= 0 )
     {
-      /* square brackets only after non-zero name or wildcard */
-      mask |= MASK_SQUARE_OPEN;
-      index = 0;
+      o->error = 1;
+      k = 0;
     }
-    else if( isdigit( c ) && (mask & MASK_SQUARE_OPEN) != 0 )
+  }
+  o->used = 0;
+  return !o->error;
+}
+
+static void uxml_output( uxml_output_t *o, const void *data, size_t n )
+{
+  const unsigned char *s = (const unsigned char *)data;
+  size_t k;
+
+  o->length += n;
+  if( n != 0 && n <= o->size - o->used ) /* usual case, buffer has room */
+  {
+    memcpy( o->buffer + o->used, s, n );
+    o->used += n;
+    return;
+  }
+  while( n != 0 )
+  {
+    if( o->used == o->size && !uxml_output_flush( o ) )
+      return;
+    k = (n < o->size - o->used) ? n: o->size - o->used;
+    memcpy( o->buffer + o->used, s, k );
+    o->used += k;
+    s += k;
+    n -= k;
+  }
+}
+
+static void uxml_output_indent( uxml_output_t *o, size_t depth )
+{
+  size_t k;
+
+  for( depth *= 2; depth != 0; depth -= k )
+  {
+    k = (depth < sizeof( uxml_indent ) - 1) ? depth: sizeof( uxml_indent ) - 1;
+    uxml_output( o, uxml_indent, k );
+  }
+}
+
+/*
+ * Get length of run of characters, which are written as is. Other characters are
+ * '<', '>', '&', control ones, and '"' in attribute value, or space in content,
+ * which isn't between two non-space characters: parser collapses such spaces.
+ * \c space is set if character before the run is space, or it is begin of content.
+ */
+static size_t uxml_clean_run( const unsigned char *s, size_t n, int attr, int space )
+{
+  size_t i = 1;
+  unsigned int bits;
+
+  if( s[0] < ' ' || s[0] == '<' || s[0] == '>' || s[0] == '&' ||
+      (attr ? s[0] == '\"': (s[0] == ' ' && (space || n == 1 || s[1] <= ' '))) )
+    return 0;
+#if defined( __AVX2__ ) && !defined( UXML_DISABLE_SIMD )
+  for( ; i + 32 < n; i += 32 )         /* character after block is available */
+  {
+    __m256i v = _mm256_loadu_si256( (const __m256i *)(s + i) );
+    __m256i m = _mm256_cmpeq_epi8( _mm256_min_epu8( v, _mm256_set1_epi8( 0x1F ) ), v ); /* v < ' ' */
+    m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '<' ) ) );
+    m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '>' ) ) );
+    m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '&' ) ) );
+    if( attr )
+      m = _mm256_or_si256( m, _mm256_cmpeq_epi8( v, _mm256_set1_epi8( '\"' ) ) );
+    else
     {
-      mask |= MASK_INDEX;
-      index = index * 10 + (c - '0');
+      __m256i a = _mm256_loadu_si256( (const __m256i *)(s + i - 1) ), b = _mm256_loadu_si256( (const __m256i *)(s + i + 1) );
+      a = _mm256_cmpeq_epi8( _mm256_min_epu8( a, _mm256_set1_epi8( ' ' ) ), a ); /* space or control before */
+      b = _mm256_cmpeq_epi8( _mm256_min_epu8( b, _mm256_set1_epi8( ' ' ) ), b ); /* space or control after */
+      m = _mm256_or_si256( m, _mm256_and_si256( _mm256_cmpeq_epi8( v, _mm256_set1_epi8( ' ' ) ), _mm256_or_si256( a, b ) ) );
     }
-    else if( c == ']' && (mask & (MASK_SQUARE_OPEN | MASK_INDEX)) == (MASK_SQUARE_OPEN | MASK_INDEX) )
+    if( (bits = (unsigned int)_mm256_movemask_epi8( m )) != 0 )
+      return i + (size_t)uxml_ctz64( bits );
+  }
+#elif defined( UXML_SSE2 )
+  for( ; i + 16 < n; i += 16 )         /* character after block is available */
+  {
+    __m128i v = _mm_loadu_si128( (const __m128i *)(s + i) );
+    __m128i m = _mm_cmpeq_epi8( _mm_min_epu8( v, _mm_set1_epi8( 0x1F ) ), v ); /* v < ' ' */
+    m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '<' ) ) );
+    m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '>' ) ) );
+    m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '&' ) ) );
+    if( attr )
+      m = _mm_or_si128( m, _mm_cmpeq_epi8( v, _mm_set1_epi8( '\"' ) ) );
+    else
     {
-      mask |= MASK_SQUARE_CLOSE;
+      __m128i a = _mm_loadu_si128( (const __m128i *)(s + i - 1) ), b = _mm_loadu_si128( (const __m128i *)(s + i + 1) );
+      a = _mm_cmpeq_epi8( _mm_min_epu8( a, _mm_set1_epi8( ' ' ) ), a ); /* space or control before */
+      b = _mm_cmpeq_epi8( _mm_min_epu8( b, _mm_set1_epi8( ' ' ) ), b ); /* space or control after */
+      m = _mm_or_si128( m, _mm_and_si128( _mm_cmpeq_epi8( v, _mm_set1_epi8( ' ' ) ), _mm_or_si128( a, b ) ) );
     }
-    else if( mask != 0 )
+    if( (bits = (unsigned int)_mm_movemask_epi8( m )) != 0 )
+      return i + (size_t)uxml_ctz64( bits );
+  }
+#endif
+  for( ; i < n; i++ )
+  {
+    if( s[i] < ' ' || s[i] == '<' || s[i] == '>' || s[i] == '&' ||
+        (attr ? s[i] == '\"': (s[i] == ' ' && (s[i-1] <= ' ' || i + 1 == n || s[i+1] <= ' '))) )
+      break;
+  }
+  (void)bits;
+  return i;
+}
+
+/*
+ * Write content or attribute value with escaped characters,
+ * parser restores the same text from it
+ */
+static void uxml_output_text( uxml_output_t *o, const unsigned char *s, size_t n, int attr )
+{
+  size_t k;
+  int space = 1;                       /* leading space is escaped */
+  char ref[16];
+
+  while( n != 0 )
+  {
+    k = uxml_clean_run( s, n, attr, space );
+    uxml_output( o, s, k );
+    if( k == n )
+      break;
+    s += k;
+    n -= k;
+    switch( *s )
     {
-      /* all other cases means bad syntax in path */
-      return NULL;
+    case '<':  uxml_output( o, "&lt;", 4 ); break;
+    case '>':  uxml_output( o, "&gt;", 4 ); break;
+    case '&':  uxml_output( o, "&amp;", 5 ); break;
+    case '\"': uxml_output( o, "&quot;", 6 ); break;
+    default:   uxml_output( o, ref, (size_t)sprintf( ref, "&#%d;", *s ) ); break;
     }
-    else
+    space = (*s <= ' ');
+    s++;
+    n--;
+  }
+}
+
+/*
+ * Write begin of tag of node or processing instruction with its attributes
+ */
+static void uxml_output_open( uxml_output_t *o, uxml_node_t *n )
+{
+  uxml_t *p = INSTANCE( n );
+  uxml_node_t *a;
+
+  uxml_output( o, (n->type == XML_INST) ? "<?": "<", (n->type == XML_INST) ? 2: 1 );
+  uxml_output( o, NAME( p, n ), NAME_LENGTH( p, n ) );
+  for( a = LINK( n, child ); a != NULL; a = LINK( a, next ) )
+  {
+    if( a->type != XML_ATTR )
+      continue;
+    uxml_output( o, " ", 1 );
+    uxml_output( o, NAME( p, a ), NAME_LENGTH( p, a ) );
+    uxml_output( o, "=\"", 2 );
+    uxml_output_text( o, CONTENT( p, a ), a->size, 1 );
+    uxml_output( o, "\"", 1 );
+  }
+}
+
+/*
+ * Get first node among node \c n and its next siblings, attributes are skipped
+ */
+static uxml_node_t *uxml_output_next( uxml_node_t *n )
+{
+  for( ; n != NULL && n->type != XML_NODE; n = LINK( n, next ) );
+  return n;
+}
+
+static void uxml_output_close( uxml_output_t *o, uxml_node_t *n, size_t depth, int indent )
+{
+  uxml_t *p = INSTANCE( n );
+
+  if( indent )
+    uxml_output_indent( o, depth );
+  uxml_output( o, "</", 2 );
+  uxml_output( o, NAME( p, n ), NAME_LENGTH( p, n ) );
+  uxml_output( o, indent ? ">\n": ">", indent ? 2: 1 );
+}
+
+/*
+ * Write node with its subtree in one walk without recursion.
+ * Content of node is written before its child nodes.
+ */
+static void uxml_output_tree( uxml_output_t *o, uxml_node_t *node, int flags )
+{
+  uxml_t *p = INSTANCE( node );
+  uxml_node_t *n = node, *c;
+  size_t depth = 0;
+  int indent = (flags & UXML_WRITE_INDENT) != 0;
+
+  if( node->type == XML_ATTR )
+  {
+    uxml_output( o, NAME( p, node ), NAME_LENGTH( p, node ) );
+    uxml_output( o, "=\"", 2 );
+    uxml_output_text( o, CONTENT( p, node ), node->size, 1 );
+    uxml_output( o, "\"", 1 );
+    return;
+  }
+  if( node == LINK( p->node, next ) )  /* processing instructions before root node */
+  {
+    for( c = p->node + 1; c != node; c++ )
     {
-      len++;
+      if( c->type != XML_INST )
+        continue;
+      uxml_output_open( o, c );
+      uxml_output( o, indent ? "?>\n": "?>", indent ? 3: 2 );
     }
   }
-  if( s2 != s1 )
+  if( node->type == XML_INST )
   {
-    if( len == 2 )
+    uxml_output_open( o, node );
+    uxml_output( o, indent ? "?>\n": "?>", indent ? 3: 2 );
+    return;
+  }
+  for( ;; )
+  {
+    if( indent )
+      uxml_output_indent( o, depth );
+    uxml_output_open( o, n );
+    c = uxml_output_next( LINK( n, child ) );
+    if( c == NULL && n->size == 0 )
     {
-      if( s1[0] == '.' && s1[1] == '.' )
-      {
-        return n->parent;
-      }
+      uxml_output( o, indent ? "/>\n": "/>", indent ? 3: 2 );
     }
-    switch( mask )
+    else if( c == NULL )
     {
-    case 0:
-      for( n = n->child; n != NULL; n = n->next )
-      {
-        if( len == n->name_length )
-        {
-          if( memcmp( s1, n->name, len ) == 0 )
-          {
-            s1 = s2 + 1;
-            break;
-          }
-        }
-      }
-      break;
-    case MASK_WILDCARD:
-      n = n->child;
-      break;
-    case (MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
-      for( i = 0, n = n->child; n != NULL; n = n->next )
+      uxml_output( o, ">", 1 );
+      uxml_output_text( o, CONTENT( p, n ), n->size, 0 );
+      uxml_output_close( o, n, 0, 0 );
+      if( indent )
+        uxml_output( o, "\n", 1 );
+    }
+    else                               /* child nodes follow content */
+    {
+      uxml_output( o, indent ? ">\n": ">", indent ? 2: 1 );
+      if( n->size != 0 )
       {
-        if( n->type != XML_NODE )
-          continue;
-        if( len == n->name_length )
-        {
-          if( memcmp( s1, n->name, len ) == 0 )
-          {
-            if( i == index )
-            {
-              s1 = s2 + 1;
-              break;
-            }
-            i++;
-          }
-        }
+        if( indent )
+          uxml_output_indent( o, depth + 1 );
+        uxml_output_text( o, CONTENT( p, n ), n->size, 0 );
+        if( indent )
+          uxml_output( o, "\n", 1 );
       }
-      break;
-    case (MASK_WILDCARD | MASK_SQUARE_OPEN | MASK_INDEX | MASK_SQUARE_CLOSE):
-      for( i = 0, n = n->child; n != NULL; n = n->next )
+      n = c;
+      depth++;
+      continue;
+    }
+    for( ;; )                          /* next sibling, or end of parent */
+    {
+      if( n == node )
+        return;
+      if( (c = uxml_output_next( LINK( n, next ) )) != NULL )
       {
-        if( n->type != XML_NODE )
-          continue;
-        if( i == index )
-        {
-          s1 = s2 + 1;
-          break;
-        }
-        i++;
+        n = c;
+        break;
       }
-      break;
-    default:
-      n = NULL;
-      break; 
+      n = LINK( n, parent );
+      uxml_output_close( o, n, --depth, indent );
     }
   }
-  return n;
 }
 
-const char *uxml_get( uxml_node_t *node, const char *path )
+size_t uxml_write( uxml_node_t *node, char *buffer, size_t size, int flags )
 {
-  uxml_node_t *n = uxml_node( node, path );
-  return n == NULL ? NULL: (const char *)n->content;
+  uxml_output_t o;
+
+  o.buffer = (unsigned char *)buffer;
+  o.size = (size != 0) ? size - 1: 0;  /* room for terminating zero */
+  o.used = o.length = 0;
+  o.flush = NULL;
+  o.fd = -1;
+  o.error = 0;
+  uxml_output_tree( &o, node, flags );
+  if( size != 0 )
+    buffer[ o.used ] = 0;
+  return o.length;
 }
 
-int uxml_int( uxml_node_t *node, const char *path )
+int uxml_write_fd( uxml_node_t *node, int fd, int flags )
 {
-  const char *s = uxml_get( node, path );
-  return (s != NULL) ? (int)strtol( s, NULL, 0 ): 0;
+  uxml_output_t o;
+
+  if( (o.buffer = (unsigned char *)malloc( UXML_WRITE_BUFFER )) == NULL )
+    return 0;
+  o.size = UXML_WRITE_BUFFER;
+  o.used = o.length = 0;
+  o.flush = NULL;
+  o.fd = fd;
+  o.error = 0;
+  uxml_output_tree( &o, node, flags );
+  uxml_output_flush( &o );
+  free( o.buffer );
+  return !o.error;
 }
 
-#if !defined( UXML_DISABLE_DOUBLE )
-double uxml_double( uxml_node_t *node, const char *path )
+struct _uxml_writer_t
 {
-  const char *s = uxml_get( node, path );
-  return (s != NULL) ? strtod( s, NULL ): 0.0;
+  uxml_output_t o;                  /* buffered output */
+  char *names;                      /* names of open elements, each one is zero-terminated */
+  size_t names_size;                /* allocated size of names */
+  size_t names_used;                /* size of names of open elements */
+  size_t depth;                     /* count of open elements */
+  int flags;                        /* UXML_WRITE_COMPACT or UXML_WRITE_INDENT */
+  int tag;                          /* start tag of last element isn't closed by '>' yet */
+  int children;                     /* current element has child elements */
+  int root;                         /* root element is written already */
+  unsigned char rest[3];            /* bytes of base64 data, which are not encoded yet */
+  int rest_size;                    /* count of such bytes */
+  const char *error;                /* error description, NULL - no error */
+};
+
+static uxml_writer_t *uxml_writer_init( uxml_flush_t flush, void *user, int fd, int flags )
+{
+  uxml_writer_t *w;
+
+  if( (w = (uxml_writer_t *)malloc( sizeof( uxml_writer_t ) )) == NULL )
+    return NULL;
+  if( (w->o.buffer = (unsigned char *)malloc( UXML_WRITE_BUFFER )) == NULL )
+  {
+    free( w );
+    return NULL;
+  }
+  w->o.size = UXML_WRITE_BUFFER;
+  w->o.used = w->o.length = 0;
+  w->o.flush = flush;
+  w->o.user = user;
+  w->o.fd = fd;
+  w->o.error = 0;
+  w->names = NULL;
+  w->names_size = w->names_used = w->depth = 0;
+  w->flags = flags;
+  w->tag = w->children = w->rest_size = w->root = 0;
+  w->error = NULL;
+  return w;
 }
-#endif
 
-void *uxml_user( uxml_node_t *node, const char *path )
+uxml_writer_t *uxml_writer_create( uxml_flush_t flush, void *user, int flags )
 {
-  uxml_node_t *n = uxml_node( node, path );
-  return (n != NULL) ? n->user: NULL;
+  return uxml_writer_init( flush, user, -1, flags );
 }
 
-void uxml_set_user( uxml_node_t *node, const char *path, void *user )
+uxml_writer_t *uxml_writer_create_fd( int fd, int flags )
 {
-  uxml_node_t *n = uxml_node( node, path );
-  if( n != NULL )
-    n->user = user;
+  return uxml_writer_init( NULL, NULL, fd, flags );
 }
 
-int uxml_size( uxml_node_t *node, const char *path )
+/*
+ * Check state of writer before next call, close start tag of last element, 
+ * and write the rest of base64 data, if \c content is set. Returns 0 in case of error.
+ */
+static int uxml_writer_check( uxml_writer_t *w, int content )
 {
-  uxml_node_t *n = uxml_node( node, path );
-  return (n == NULL) ? 0: n->size;
+  char b[8];
+
+  if( w->error == NULL && w->o.error )
+    w->error = "Write failed";
+  if( w->error != NULL || !content )
+    return w->error == NULL;
+  if( w->tag )
+  {
+    uxml_output( &w->o, ">", 1 );
+    w->tag = 0;
+  }
+  if( w->rest_size != 0 )
+  {
+    uxml_output( &w->o, b, (size_t)uxml_encode64( b, sizeof( b ), w->rest, w->rest_size ) - 1 );
+    w->rest_size = 0;
+  }
+  return 1;
 }
 
-#include <stdio.h>
+int uxml_writer_start_element( uxml_writer_t *w, const char *name )
+{
+  size_t n = strlen( name ), k;
+  char *c;
 
-#if defined( _MSC_VER )
-#pragma warning(disable:4996)
-#endif
+  if( !uxml_writer_check( w, 1 ) )
+    return 0;
+  if( w->depth == 0 && w->root )       /* document has one root element */
+  {
+    w->error = "Second root element";
+    return 0;
+  }
+  if( w->names_used + n + 1 > w->names_size )
+  {
+    for( k = (w->names_size != 0) ? w->names_size * 2: 256; k < w->names_used + n + 1; k *= 2 );
+    if( (c = (char *)realloc( w->names, k )) == NULL )
+    {
+      w->error = "Insufficient memory";
+      return 0;
+    }
+    w->names = c;
+    w->names_size = k;
+  }
+  memcpy( w->names + w->names_used, name, n + 1 );
+  w->names_used += n + 1;
+  if( (w->flags & UXML_WRITE_INDENT) != 0 && w->o.length != 0 )
+  {
+    uxml_output( &w->o, "\n", 1 );
+    uxml_output_indent( &w->o, w->depth );
+  }
+  uxml_output( &w->o, "<", 1 );
+  uxml_output( &w->o, name, n );
+  w->depth++;
+  w->root = 1;
+  w->tag = 1;
+  w->children = 0;
+  return 1;
+}
 
-uxml_node_t *uxml_load( const char *xml_file, uxml_error_t *error )
+int uxml_writer_attribute( uxml_writer_t *w, const char *name, const char *value )
 {
-  FILE *fp;
-  void *b;
-  int size, n;
-  uxml_node_t *root;
+  if( !uxml_writer_check( w, 0 ) )
+    return 0;
+  if( !w->tag )
+  {
+    w->error = "Attribute is outside of start tag";
+    return 0;
+  }
+  uxml_output( &w->o, " ", 1 );
+  uxml_output( &w->o, name, strlen( name ) );
+  uxml_output( &w->o, "=\"", 2 );
+  uxml_output_text( &w->o, (const unsigned char *)value, strlen( value ), 1 );
+  uxml_output( &w->o, "\"", 1 );
+  return 1;
+}
 
-  if( (fp = fopen( xml_file, "rb" )) == NULL )
+int uxml_writer_text( uxml_writer_t *w, const char *text, size_t size )
+{
+  if( !uxml_writer_check( w, 1 ) )
+    return 0;
+  if( w->depth == 0 )
   {
-    error->text = "fopen failed"; error->line = error->column = 0;
-    return NULL;
+    w->error = "Text is outside of element";
+    return 0;
   }
-  fseek( fp, 0, SEEK_END );
-  n = ftell( fp );
-  fseek( fp, 0, SEEK_SET );
-  if( (b = malloc( n )) == NULL )
+  uxml_output_text( &w->o, (const unsigned char *)text, size, 0 );
+  return 1;
+}
+
+int uxml_writer_base64( uxml_writer_t *w, const void *data, size_t size )
+{
+  const unsigned char *s = (const unsigned char *)data;
+  char b[ 4 * 1024 + 8 ];
+  size_t n;
+
+  if( !uxml_writer_check( w, 0 ) )
+    return 0;
+  if( w->depth == 0 )
   {
-    fclose( fp );
-    error->text = "malloc failed"; error->line = error->column = 0;
-    return NULL;
+    w->error = "Text is outside of element";
+    return 0;
   }
-  size = fread( b, 1, n, fp );
-  fclose( fp );
-  if( size != n )
+  if( w->tag )
   {
-    free( b );
-    error->text = "fread failed"; error->line = error->column = 0;
-    return NULL;
+    uxml_output( &w->o, ">", 1 );
+    w->tag = 0;
   }
-  root = uxml_parse( b, n, error );
-  free( b );
-  return root;
+  for( ; w->rest_size != 0 && w->rest_size < 3 && size != 0; size-- ) /* complete group of 3 bytes */
+  {
+    w->rest[ w->rest_size++ ] = *s++;
+  }
+  if( w->rest_size == 3 )
+  {
+    uxml_output( &w->o, b, (size_t)uxml_encode64( b, sizeof( b ), w->rest, 3 ) - 1 );
+    w->rest_size = 0;
+  }
+  for( ; size >= 3; s += n, size -= n ) /* encoded by parts, padding may follow the last one only */
+  {
+    n = (size < 3 * 1024) ? size - size % 3: 3 * 1024;
+    uxml_output( &w->o, b, (size_t)uxml_encode64( b, sizeof( b ), s, (int)n ) - 1 );
+  }
+  for( ; size != 0; size-- )
+  {
+    w->rest[ w->rest_size++ ] = *s++;
+  }
+  return 1;
+}
+
+int uxml_writer_end_element( uxml_writer_t *w )
+{
+  size_t n;
+
+  if( !uxml_writer_check( w, 0 ) )
+    return 0;
+  if( w->depth == 0 )
+  {
+    w->error = "No open element";
+    return 0;
+  }
+  if( w->tag )                         /* no text, child elements or data */
+  {
+    uxml_output( &w->o, "/>", 2 );
+    w->tag = 0;
+  }
+  else
+  {
+    uxml_writer_check( w, 1 );
+    if( (w->flags & UXML_WRITE_INDENT) != 0 && w->children )
+    {
+      uxml_output( &w->o, "\n", 1 );
+      uxml_output_indent( &w->o, w->depth - 1 );
+    }
+    for( n = w->names_used - 1; n != 0 && w->names[ n - 1 ] != 0; n-- ); /* begin of last name */
+    uxml_output( &w->o, "</", 2 );
+    uxml_output( &w->o, w->names + n, w->names_used - 1 - n );
+    uxml_output( &w->o, ">", 1 );
+  }
+  for( w->names_used--; w->names_used != 0 && w->names[ w->names_used - 1 ] != 0; w->names_used-- );
+  w->depth--;
+  w->children = 1;                     /* parent has child element */
+  return 1;
+}
+
+int uxml_writer_finish( uxml_writer_t *w, uxml_error_t *error )
+{
+  while( w->depth != 0 && uxml_writer_end_element( w ) );
+  if( (w->flags & UXML_WRITE_INDENT) != 0 && w->o.length != 0 )
+    uxml_output( &w->o, "\n", 1 );
+  uxml_output_flush( &w->o );
+  if( uxml_writer_check( w, 0 ) )
+    return 1;
+  if( error != NULL )
+  {
+    error->text = w->error;
+    error->line = error->column = 0;
+  }
+  return 0;
+}
+
+void uxml_writer_free( uxml_writer_t *w )
+{
+  if( w == NULL )
+    return;
+  free( w->o.buffer );
+  free( w->names );
+  free( w );
 }
 
 void uxml_dump_list( uxml_node_t *root )
 {
-  uxml_t *p = root->instance;
-  int i;
+  uxml_t *p = INSTANCE( root );
+  size_t i;
 
   for( i = 0; i < p->nodes_count; i++ )
   {
-    printf( "%d: %s name=\"%s\"(%d) content=\"%s\" size=%d parent=%d child=%d next=%d",
-      i,
+    printf( "%llu: %s name=\"%s\"(%llu) content=\"%s\" size=%llu parent=%llu child=%llu next=%llu",
+      (unsigned long long)i,
       p->node[i].type == XML_NODE ? "node": (p->node[i].type == XML_ATTR ? "attr": (p->node[i].type == XML_INST ? "inst": (p->node[i].type == XML_NONE ? "none": "????"))),
-      p->node[i].name,
-      p->node[i].name_length,
-      p->node[i].content,
-      p->node[i].size,
-      p->node[i].parent == NULL ? 0: p->node[i].parent - p->node,
-      p->node[i].child  == NULL ? 0: p->node[i].child - p->node,
-      p->node[i].next == NULL ? 0: p->node[i].next - p->node );
+      uxml_name( p->node + i ),
+      (unsigned long long)NAME_LENGTH( p, p->node + i ),
+      uxml_get( p->node + i, NULL ),   /* contents, which refer to XML data, are terminated */
+      (unsigned long long)p->node[i].size,
+      (unsigned long long)(LINK( p->node + i, parent ) == NULL ? 0: LINK( p->node + i, parent ) - p->node),
+      (unsigned long long)(LINK( p->node + i, child )  == NULL ? 0: LINK( p->node + i, child ) - p->node),
+      (unsigned long long)(LINK( p->node + i, next ) == NULL ? 0: LINK( p->node + i, next ) - p->node) );
     printf( "\n" );
   }
-  printf( "Total nodes: %d, text size: %d\n", p->nodes_count, p->text_size );
+  printf( "Total nodes: %llu, text size: %llu\n", (unsigned long long)p->nodes_count, (unsigned long long)p->text_size );
 }
 
-int uxml_get_initial_allocated( uxml_node_t *root )
+size_t uxml_get_initial_allocated( uxml_node_t *root )
 {
-  uxml_t *p = root->instance;
+  uxml_t *p = INSTANCE( root );
   return p->initial_allocated;
 }
 
@@ -1,6 +1,8 @@
 #ifndef _uxml_h
 #define _uxml_h
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -11,6 +13,10 @@ extern "C" {
  * in various functions of the uxml-library.
  * This pointer may define one XML-node or 
  * whole XML tree.
+ *
+ * When UXML_COMPACT is defined at build of the library, nodes refer to
+ * each other and to their texts by 32-bit indices, so they take about
+ * half of memory, but XML data is limited to 4 GB.
  */
 typedef struct _uxml_node_t uxml_node_t;
 
@@ -30,6 +36,8 @@ typedef struct _uxml_error_t
 /*! Parse XML data from memory
  *
  * Buffer must contain valid XML data.
+ * Names are interned: every distinct name is kept once per document,
+ * and nodes with the same name share it.
  * If XML data contain no header with "version" and "encoding" attributes,
  * then values "1.0" and "UTF-8" will be used by default.
  * It is possible to create empty XML tree, specify "<root/>",
@@ -40,9 +48,100 @@ typedef struct _uxml_error_t
  * description and it's position in XML data (row and column).
  * \return Root node, or NULL in case of error.
  */
-uxml_node_t *uxml_parse( const char *xml_data, const int xml_length, uxml_error_t *error );
+uxml_node_t *uxml_parse( const char *xml_data, const size_t xml_length, uxml_error_t *error );
+
+/*! Parse XML data from memory without copying of contents
+ *
+ * Like a \c uxml_parse, but contents, which are the same in XML data,
+ * are not copied: the tree refers to them in \c xml_data buffer.
+ * Only contents with escape sequences, with replaced spaces or separated by 
+ * child nodes are kept by tree, so the tree takes much less memory.
+ * Names are interned like in \c uxml_parse, one copy per distinct name.
+ * Buffer \c xml_data must not be changed or freed until \c uxml_free call.
+ * Contents in \c xml_data are not terminated with zero byte, 
+ * use \c uxml_get_ref to get them with their length.
+ * \c uxml_get copies them with zero byte on first call,
+ * and returns NULL, if there is no memory for copy. The copy changes the tree,
+ * so \c uxml_get calls in one tree from concurrent threads must be synchronized.
+ * \param xml_data - pointer buffer with XML data, may be zero-terminated;
+ * \param xml_length - length of XML data in buffer \c xml_data;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and it's position in XML data (row and column).
+ * \return Root node, or NULL in case of error.
+ */
+uxml_node_t *uxml_parse_ref( const char *xml_data, const size_t xml_length, uxml_error_t *error );
+
+/*! Parse XML data in its buffer
+ *
+ * Like a \c uxml_parse, but names and contents are decoded and 
+ * terminated with zero byte inside \c xml_data buffer itself, so XML data is destroyed,
+ * even in case of error. Only the array of nodes is allocated, 
+ * and content, which is split by child nodes, is joined in separate memory.
+ * Buffer \c xml_data must not be changed or freed until \c uxml_free call.
+ * \param xml_data - pointer buffer with XML data, may be zero-terminated;
+ * \param xml_length - length of XML data in buffer \c xml_data;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and it's position in XML data (row and column).
+ * \return Root node, or NULL in case of error.
+ */
+uxml_node_t *uxml_parse_insitu( char *xml_data, const size_t xml_length, uxml_error_t *error );
+
+#if !defined( UXML_DISABLE_THREADS )
+/*! Parse XML data from memory by several threads
+ *
+ * Like a \c uxml_parse, but children of root node are split into parts, 
+ * which are parsed by own threads, and then the parts are joined into one tree.
+ * The tree is the same as \c uxml_parse makes.
+ * It is useful for large XML data with long list of nodes under the root.
+ * If data can't be split, or if there is an error, it is parsed by \c uxml_parse.
+ * \param xml_data - pointer buffer with XML data, may be zero-terminated;
+ * \param xml_length - length of XML data in buffer \c xml_data;
+ * \param threads - count of threads;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and it's position in XML data (row and column).
+ * \return Root node, or NULL in case of error.
+ */
+uxml_node_t *uxml_parse_parallel( const char *xml_data, const size_t xml_length, const int threads, uxml_error_t *error );
+#endif
+
+/*! Parse context, see \c uxml_parse_ctx
+ */
+typedef struct _uxml_context_t uxml_context_t;
+
+/*! Create parse context
+ *
+ * \return context's pointer, or NULL if there is no memory.
+ */
+uxml_context_t *uxml_context_create( void );
+
+/*! Parse XML data from memory with buffers of context
+ *
+ * Like a \c uxml_parse, but array of nodes, text data, stack and table of names
+ * are kept by context between parses, and grow only, if document needs more,
+ * so stream of small documents is parsed without allocations and copy of tree.
+ * The tree is valid until next parse with the same context, or \c uxml_context_free.
+ * \c uxml_free of the tree frees data, which is allocated after parse
+ * (copies, indices, cache of values), buffers stay in context.
+ * \param ctx - context's pointer;
+ * \param xml_data - pointer buffer with XML data, may be zero-terminated;
+ * \param xml_length - length of XML data in buffer \c xml_data;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and it's position in XML data (row and column).
+ * \return Root node, or NULL in case of error.
+ */
+uxml_node_t *uxml_parse_ctx( uxml_context_t *ctx, const char *xml_data, const size_t xml_length, uxml_error_t *error );
+
+/*! Free parse context with its last tree
+ *
+ * \param ctx - context's pointer, may be NULL.
+ */
+void uxml_context_free( uxml_context_t *ctx );
 
 /*! Parse XML from file
+ *
+ * Regular file is mapped to memory read-only and parsed without copy
+ * of XML data (unless UXML_DISABLE_MMAP is defined). Pipes and special 
+ * files are read by parts.
  *
  * \param xml_file - name of file with XML data;
  * \param error - pointer to structure, which will be fill with error 
@@ -51,6 +150,125 @@ uxml_node_t *uxml_parse( const char *xml_data, const int xml_length, uxml_error_
  */
 uxml_node_t *uxml_load( const char *xml_file, uxml_error_t *error );
 
+/*! XML reader callbacks
+ *
+ * Callbacks of \c uxml_read, all of them are optional and may be NULL.
+ * Every callback receives \c user pointer as first argument,
+ * and returns non-zero to continue reading or 0 to stop it.
+ * Names and values are zero-terminated strings, which are valid 
+ * until the callback returns only.
+ */
+typedef struct _uxml_reader_t
+{
+  void *user;                          /*!< user's pointer, passed to callbacks */
+  /*! node begins, its attributes follow */
+  int (*start)( void *user, const char *name );
+  /*! attribute of node or process instruction */
+  int (*attr)( void *user, const char *name, const char *value, size_t size );
+  /*! part of node's content, spaces are stripped like in \c uxml_get */
+  int (*text)( void *user, const char *text, size_t size );
+  /*! node ends */
+  int (*end)( void *user, const char *name );
+  /*! process instruction begins, its attributes follow */
+  int (*inst)( void *user, const char *name );
+} uxml_reader_t;
+
+/*! Read XML data from memory without building XML tree
+ *
+ * XML data is parsed like \c uxml_parse does, but nodes are not stored:
+ * the reader's callbacks are called for every node, attribute, content 
+ * and process instruction in the document order.
+ * Memory used by reader doesn't depend on size of XML data,
+ * it depends on nesting of nodes and on longest name or attribute's value only.
+ * Long content is passed to \c text callback by several parts,
+ * and the content of node, which is separated by child nodes, is passed 
+ * by separate calls.
+ * \param xml_data - pointer buffer with XML data, may be zero-terminated;
+ * \param xml_length - length of XML data in buffer \c xml_data;
+ * \param reader - reader's callbacks;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and it's position in XML data (row and column).
+ * \return 1 if whole XML data was read, or 0 in case of error or when callback stops reading.
+ */
+int uxml_read( const char *xml_data, const size_t xml_length, uxml_reader_t *reader, uxml_error_t *error );
+
+/*! XML push parser
+ *
+ * Parser reads XML data, which is passed by parts, like \c uxml_read does.
+ * Parts may be split at any byte, parser keeps its state between them.
+ */
+typedef struct _uxml_t uxml_parser_t;
+
+/*! Create push parser
+ *
+ * \param reader - reader's callbacks, see \c uxml_read.
+ * \return New parser, or NULL if there is no memory.
+ */
+uxml_parser_t *uxml_parser_create( uxml_reader_t *reader );
+
+/*! Pass next part of XML data to parser
+ *
+ * Reader's callbacks are called for all nodes, which are found in this part.
+ * Data is not copied, only unfinished name, attribute, 
+ * or part of content is kept by parser.
+ * \param parser - parser's pointer;
+ * \param data - pointer to next part of XML data;
+ * \param length - length of \c data in bytes;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and it's position in XML data (row and column).
+ * \return 1 if data was parsed, or 0 in case of error or when callback stops reading.
+ */
+int uxml_parser_feed( uxml_parser_t *parser, const char *data, const size_t length, uxml_error_t *error );
+
+/*! Finish parsing
+ *
+ * Checks, that whole XML document was passed to parser.
+ * \param parser - parser's pointer;
+ * \param error - pointer to structure, which will be fill with error description.
+ * \return 1 if document is complete, or 0 in case of error.
+ */
+int uxml_parser_finish( uxml_parser_t *parser, uxml_error_t *error );
+
+/*! Free push parser
+ *
+ * \param parser - parser's pointer.
+ */
+void uxml_parser_free( uxml_parser_t *parser );
+
+/*! Extraction callback, see \c uxml_extract
+ *
+ * \param user - user's pointer;
+ * \param path - index of matched path;
+ * \param value - zero-terminated content of node or attribute's value,
+ * which is valid until the callback returns only;
+ * \param size - size of value in bytes.
+ * \return non-zero to continue reading or 0 to stop it.
+ */
+typedef int (*uxml_extract_t)( void *user, size_t path, const char *value, size_t size );
+
+/*! Extract values by paths without building XML tree
+ *
+ * XML data is read like \c uxml_read does, current path is tracked,
+ * and only contents of nodes and values of attributes, which match
+ * one of paths, are passed to callback in the document order.
+ * Contents of other nodes are not copied. Memory doesn't depend on size of 
+ * XML data, it depends on nesting of nodes and on size of matched contents.
+ * Path begins with the name of root node, e.g. "/export/customer/id",
+ * its last step may be attribute, and "*" matches any name. 
+ * Content of node is passed at the end of node, like \c uxml_get returns it.
+ * \param xml_data - pointer buffer with XML data, may be zero-terminated;
+ * \param xml_length - length of XML data in buffer \c xml_data;
+ * \param paths - array of paths;
+ * \param count - count of paths;
+ * \param callback - callback, which receives matched values;
+ * \param user - user's pointer, passed to callback;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and it's position in XML data (row and column).
+ * \return 1 if whole XML data was read, or 0 in case of error or when callback stops reading.
+ */
+int uxml_extract( const char *xml_data, const size_t xml_length, const char * const *paths, const size_t count,
+                  uxml_extract_t callback, void *user, uxml_error_t *error );
+
 /*! Get node's content
  *
  * Returns pointer to content of the specified node - element or attribute.
@@ -79,6 +297,16 @@ uxml_node_t *uxml_load( const char *xml_file, uxml_error_t *error );
  * N-th node in the row of "abc" nodes, numbering starts from 0.
  * Moreover, name can substitute with wildcard "*", in this case
  * no differences in names.
+ * Every name of path is looked up in the document's names once,
+ * so nodes are compared by name's ID, not by string.
+ * Lookups only read the tree, so they may be done from concurrent threads.
+ * If the library is built with UXML_INDEX_CHILDREN (e.g. 32), children of node 
+ * with more children than that are indexed by name on first lookup, then "abc" and "abc[N]"
+ * take constant time. The index is kept until \c uxml_free, so lookups in one tree
+ * from concurrent threads must be synchronized in this case.
+ * Trees of \c uxml_parse_ref need the same synchronization, because \c uxml_get
+ * copies content, which refers to XML data, to the tree on first call,
+ * while \c uxml_get_ref doesn't change the tree.
  * When content of specified \c node is needed, the path must point to
  * empty string "" or to NULL.
  * Returned pointer is pointed to node content.
@@ -97,6 +325,17 @@ uxml_node_t *uxml_load( const char *xml_file, uxml_error_t *error );
  */
 const char *uxml_get( uxml_node_t *node, const char *path );
 
+/*! Get node's content and its size
+ *
+ * Like a \c uxml_get, but content is not copied, when it refers to XML data
+ * (see \c uxml_parse_ref), so it may be not terminated with zero byte.
+ * \param node - node's pointer;
+ * \param path - node's path;
+ * \param size - pointer to content's size in bytes, may be NULL.
+ * \return pointer to node's content, or NULL, if specified node doesn't exists.
+ */
+const char *uxml_get_ref( uxml_node_t *node, const char *path, size_t *size );
+
 /*! Get integer value
  *
  * Like a \c uxml_get, but convert node's content to integer type.
@@ -106,10 +345,82 @@ const char *uxml_get( uxml_node_t *node, const char *path );
  */
 int uxml_int( uxml_node_t *node, const char *path );
 
+/*! Status of conversion, see \c uxml_int64_e
+ */
+enum
+{
+  UXML_OK,                             /*!< content is converted */
+  UXML_MISSING,                        /*!< there is no such node */
+  UXML_INVALID,                        /*!< content is not a value of this type */
+  UXML_RANGE                           /*!< value is out of range of type, it is limited */
+};
+
+/*! Get 64-bit integer value
+ *
+ * Content is decimal integer, or hexadecimal one after "0x", with optional sign.
+ * Conversion doesn't depend on locale.
+ * \param node - node's pointer;
+ * \param path - node's path;
+ * \param value - pointer to converted value, which is 0 if node is missing
+ * or content is not a number, may be NULL.
+ * \return UXML_OK, UXML_MISSING, UXML_INVALID or UXML_RANGE.
+ */
+int uxml_int64_e( uxml_node_t *node, const char *path, long long *value );
+
+/*! Get unsigned 64-bit integer value
+ *
+ * Like a \c uxml_int64_e, negative value is out of range.
+ */
+int uxml_uint64_e( uxml_node_t *node, const char *path, unsigned long long *value );
+
+/*! Get boolean value
+ *
+ * Content is "true", "false", "1" or "0", like in XML schema.
+ * \param node - node's pointer;
+ * \param path - node's path;
+ * \param value - pointer to converted value, 1 or 0, may be NULL.
+ * \return UXML_OK, UXML_MISSING or UXML_INVALID.
+ */
+int uxml_bool_e( uxml_node_t *node, const char *path, int *value );
+
+/*! Get 64-bit integer value
+ *
+ * Like a \c uxml_int64_e, but 0 is returned in case of error.
+ */
+long long uxml_int64( uxml_node_t *node, const char *path );
+
+/*! Get unsigned 64-bit integer value
+ *
+ * Like a \c uxml_uint64_e, but 0 is returned in case of error.
+ */
+unsigned long long uxml_uint64( uxml_node_t *node, const char *path );
+
+/*! Get boolean value
+ *
+ * Like a \c uxml_bool_e, but 0 is returned in case of error.
+ */
+int uxml_bool( uxml_node_t *node, const char *path );
+
 #if !defined( UXML_DISABLE_DOUBLE )
 /*! Get real type value
  *
- * Like a \c uxml_get, but convert node's content to double precision type.
+ * Content is real number with optional sign, fraction and exponent,
+ * or INF, -INF, NaN. Conversion doesn't depend on locale, and
+ * it is correctly rounded. Number, which is followed by other text,
+ * is not a number. Value, which overflows, is limited to HUGE_VAL,
+ * and nonzero value, which underflows to 0, is 0, both are UXML_RANGE.
+ * \param node - node's pointer;
+ * \param path - node's path;
+ * \param value - pointer to converted value, which is 0 if node is missing
+ * or content is not a number, may be NULL.
+ * \return UXML_OK, UXML_MISSING, UXML_INVALID or UXML_RANGE.
+ */
+int uxml_double_e( uxml_node_t *node, const char *path, double *value );
+
+/*! Get real type value
+ *
+ * Like a \c uxml_double_e, but 0 is returned in case of error, and number,
+ * which is followed by other text, is converted like by strtod: "3.5 kg" is 3.5.
  * \param node - node's pointer;
  * \param path - node's path.
  * \return Node's content converted to the real double-precision type.
@@ -117,6 +428,19 @@ int uxml_int( uxml_node_t *node, const char *path );
 double uxml_double( uxml_node_t *node, const char *path );
 #endif
 
+/*! Enable cache of converted values
+ *
+ * When cache is enabled, value, which is converted by \c uxml_int64, 
+ * \c uxml_uint64, \c uxml_bool or \c uxml_double functions, is kept for every node,
+ * and repeated conversion to the same type doesn't parse content again.
+ * Cache takes 16 bytes per node. It is filled by readers, so concurrent 
+ * threads must not read values, while cache is enabled.
+ * \param root - root node's pointer;
+ * \param enable - 1 to enable cache, 0 to disable and free it.
+ * \return 1 if cache is enabled or disabled, or 0 if there is no memory.
+ */
+int uxml_cache_values( uxml_node_t *root, int enable );
+
 /*! Return user's pointer
  */
 void *uxml_user( uxml_node_t *node, const char *path );
@@ -133,7 +457,7 @@ void uxml_set_user( uxml_node_t *node, const char *path, void *user );
  * \return content size in bytes 
  * (length of zero-terminated string).
  */
-int uxml_size( uxml_node_t *node, const char *path );
+size_t uxml_size( uxml_node_t *node, const char *path );
 
 /*! Get node by path
  *
@@ -143,6 +467,219 @@ int uxml_size( uxml_node_t *node, const char *path );
  */
 uxml_node_t *uxml_node( uxml_node_t *node, const char *path );
 
+/*! Compiled path, see \c uxml_path_compile
+ */
+typedef struct _uxml_path_t uxml_path_t;
+
+/*! Compile path for repeated lookups
+ *
+ * Path is parsed once, see \c uxml_get for its syntax, 
+ * and names of path are hashed once too.
+ * Compiled path doesn't depend on XML tree, it can be used with any tree,
+ * and it is shared by concurrent threads, until \c uxml_path_free call.
+ * Lookups in one tree from concurrent threads follow the rules of \c uxml_get.
+ * Unlike \c uxml_node, which returns NULL for invalid path,
+ * syntax errors are reported here: wildcard or ".." with other characters,
+ * invalid or unterminated index, characters after index.
+ * \param path - node's path;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and its position in path (column, line is 0).
+ * \return compiled path, or NULL in case of error.
+ */
+uxml_path_t *uxml_path_compile( const char *path, uxml_error_t *error );
+
+/*! Free compiled path
+ *
+ * \param path - compiled path, may be NULL.
+ */
+void uxml_path_free( uxml_path_t *path );
+
+/*! Get node by compiled path
+ *
+ * Like a \c uxml_node, but path is compiled by \c uxml_path_compile.
+ * \param node - node's pointer, root or branch;
+ * \param path - compiled path.
+ * \return pointer to specified node, or NULL, if there is no such node.
+ */
+uxml_node_t *uxml_node_p( uxml_node_t *node, const uxml_path_t *path );
+
+/*! Get node's content by compiled path
+ *
+ * Like a \c uxml_get, but path is compiled by \c uxml_path_compile.
+ */
+const char *uxml_get_p( uxml_node_t *node, const uxml_path_t *path );
+
+/*! Get integer value by compiled path
+ *
+ * Like a \c uxml_int, but path is compiled by \c uxml_path_compile.
+ */
+int uxml_int_p( uxml_node_t *node, const uxml_path_t *path );
+
+#if !defined( UXML_DISABLE_DOUBLE )
+/*! Get real type value by compiled path
+ *
+ * Like a \c uxml_double, but path is compiled by \c uxml_path_compile.
+ */
+double uxml_double_p( uxml_node_t *node, const uxml_path_t *path );
+#endif
+
+#if !defined( UXML_ITER_STEPS )
+#define UXML_ITER_STEPS 16             /*!< maximal number of steps in path of \c uxml_find */
+#endif
+
+/*! Iterator of nodes, which match path, see \c uxml_find
+ *
+ * It is returned by value, no memory is allocated. All fields are private.
+ */
+typedef struct _uxml_iter_t
+{
+  uxml_node_t *start;                  /* node, path is relative to */
+  uxml_node_t *node[UXML_ITER_STEPS];  /* matched node of every step */
+  size_t name[UXML_ITER_STEPS];        /* name ID of every step */
+  size_t index[UXML_ITER_STEPS];       /* index of every step */
+  unsigned char type[UXML_ITER_STEPS]; /* type of every step */
+  int count;                           /* number of steps, -1 if there are no more matches */
+  int depth;                           /* number of matched steps */
+  int advance;                         /* last match is returned */
+} uxml_iter_t;
+
+/*! Find all nodes by path
+ *
+ * Unlike \c uxml_node, which returns the first match only, 
+ * iterator yields every node, which matches path, in one linear walk:
+ * step without index matches all children with such name, wildcard "*" 
+ * matches all children, step with index or ".." matches one node.
+ * For example:
+ * \code
+ * uxml_iter_t it = uxml_find( root, "records/record" );
+ * while( (n = uxml_iter_next( &it )) != NULL ) ...
+ * \endcode
+ * yields all "record" nodes of all "records" nodes in document order.
+ * Node is yielded once per match, so path with ".." may yield the same node again.
+ * Invalid path, or path with more than \c UXML_ITER_STEPS steps, matches nothing.
+ * \param node - node's pointer, root or branch;
+ * \param path - node's path, see \c uxml_get for its syntax.
+ * \return iterator, which is valid while the tree exists.
+ */
+uxml_iter_t uxml_find( uxml_node_t *node, const char *path );
+
+/*! Get next node of iterator
+ *
+ * \param it - iterator, returned by \c uxml_find.
+ * \return pointer to next matched node, or NULL, if there are no more matches.
+ */
+uxml_node_t *uxml_iter_next( uxml_iter_t *it );
+
+/*! Count nodes by path
+ *
+ * Counts nodes, which are yielded by \c uxml_find iterator, 
+ * without building a list of them.
+ * \param node - node's pointer, root or branch;
+ * \param path - node's path.
+ * \return number of matched nodes.
+ */
+size_t uxml_count( uxml_node_t *node, const char *path );
+
+/*! Type of field of record, see \c uxml_bind
+ */
+enum
+{
+  UXML_FIELD_STRING,                   /*!< const char *, content as \c uxml_get returns, NULL if node is missing */
+  UXML_FIELD_NODE,                     /*!< uxml_node_t *, node of field, NULL if node is missing */
+  UXML_FIELD_INT,                      /*!< int, like \c uxml_int64, limited to range of int */
+  UXML_FIELD_INT64,                    /*!< long long, see \c uxml_int64 */
+  UXML_FIELD_UINT64,                   /*!< unsigned long long, see \c uxml_uint64 */
+  UXML_FIELD_BOOL,                     /*!< int, see \c uxml_bool */
+  UXML_FIELD_DOUBLE                    /*!< double, see \c uxml_double */
+};
+
+/*! Field of record, see \c uxml_bind
+ */
+typedef struct _uxml_field_t
+{
+  const char *path;                    /*!< path of field relative to record's node */
+  int type;                            /*!< type of field, UXML_FIELD_STRING ... UXML_FIELD_DOUBLE */
+  size_t offset;                       /*!< offset of field in record's structure */
+} uxml_field_t;
+
+/*! Fill array of records
+ *
+ * Every node, which is yielded by \c uxml_find iterator, is converted
+ * to record structure of \c size bytes. Fields are described by their paths, 
+ * types and offsets, e.g.
+ * \code
+ * typedef struct { const char *name; int id; double price; } item_t;
+ * static const uxml_field_t fields[] = { { "name", UXML_FIELD_STRING, offsetof( item_t, name ) },
+ *   { "id", UXML_FIELD_INT, offsetof( item_t, id ) }, { "price/value", UXML_FIELD_DOUBLE, offsetof( item_t, price ) } };
+ * item_t *items = (item_t *)uxml_bind( root, "items/item", fields, 3, sizeof( item_t ), &count, &error );
+ * \endcode
+ * Paths of fields are resolved once per call. Fields, which are one name,
+ * are found by one pass over children of each record, other ones as by \c uxml_node.
+ * Missing field or one, which is not a value of its type, is 0.
+ * Bytes of record, which are not fields, are 0 too.
+ * \param node - node's pointer, root or branch;
+ * \param path - path of records, see \c uxml_find;
+ * \param fields - array of fields;
+ * \param fields_count - count of fields;
+ * \param size - size of record's structure;
+ * \param count - pointer to count of records, may be NULL;
+ * \param error - pointer to structure, which will be fill with error 
+ * description in case of invalid path or insufficient memory, may be NULL.
+ * \return array of records, which must be freed by \c free call, or NULL
+ * in case of error. Strings and nodes of records are valid until \c uxml_free call.
+ */
+void *uxml_bind( uxml_node_t *node, const char *path, const uxml_field_t *fields, size_t fields_count,
+                 size_t size, size_t *count, uxml_error_t *error );
+
+/*! Compiled query, see \c uxml_query_compile
+ */
+typedef struct _uxml_query_t uxml_query_t;
+
+/*! Compile query
+ *
+ * Query is a subset of XPath, steps are separated by "/" (child) 
+ * or "//" (descendant). Step is name of node, "@" and name of attribute,
+ * "*" or "@*" for any node or attribute, ".." for parent or "." for node itself.
+ * Unlike paths of \c uxml_get, name without "@" matches nodes only.
+ * Step may be followed by predicates, which are applied in order:
+ * - [N] - N-th matched node, counting from 0, as in paths of \c uxml_get;
+ * - [last()] - last matched node;
+ * - [@a='v'], [@a] - node has attribute "a" with value "v", or just has it;
+ * - [c='v'], [c] - node has child node "c" with content "v", or just has it.
+ *
+ * Positions are counted among children of each context node, and
+ * for "//" - among all its descendants. Query, which begins with "/",
+ * is relative to root, like absolute paths of \c uxml_get, e.g. 
+ * "//order[@status='open']" - every "order" node with attribute status="open".
+ * Compiled query doesn't depend on XML tree, and it is shared by
+ * concurrent threads, until \c uxml_query_free call.
+ * Selections in one tree from concurrent threads follow the rules of \c uxml_get.
+ * \param query - text of query;
+ * \param error - pointer to structure, which will be fill with error 
+ * description and its position in query (column, line is 0).
+ * \return compiled query, or NULL in case of error.
+ */
+uxml_query_t *uxml_query_compile( const char *query, uxml_error_t *error );
+
+/*! Free compiled query
+ *
+ * \param query - compiled query, may be NULL.
+ */
+void uxml_query_free( uxml_query_t *query );
+
+/*! Select nodes by query
+ *
+ * Descendants are found by linear scan of nodes, which are kept 
+ * in document order, so "//" costs one pass over the subtree.
+ * \param node - node's pointer, root or branch;
+ * \param query - compiled query;
+ * \param count - pointer to count of selected nodes, may be NULL.
+ * \return array of selected nodes in document order without repeats,
+ * terminated by NULL, which must be freed by \c free call, 
+ * or NULL in case of insufficient memory.
+ */
+uxml_node_t **uxml_select( uxml_node_t *node, const uxml_query_t *query, size_t *count );
+
 /*! Get node's name
  *
  * Returns the pointer to the name of specified node.
@@ -153,6 +690,16 @@ uxml_node_t *uxml_node( uxml_node_t *node, const char *path );
  */
 const char *uxml_name( uxml_node_t *node );
 
+/*! Get node's name and its length
+ *
+ * Like a \c uxml_name, but length of name is returned too,
+ * it is known without scan of name.
+ * \param node - node's pointer;
+ * \param length - pointer to name's length in bytes, may be NULL.
+ * \return pointer to node's name.
+ */
+const char *uxml_name_ref( uxml_node_t *node, size_t *length );
+
 /*! Get first children element or attribute
  *
  * \param node - node's pointer.
@@ -196,11 +743,73 @@ uxml_node_t *uxml_next( uxml_node_t *node );
 
 /*! Get previous node
  *
+ * Nodes keep link to previous node, so it takes constant time,
+ * unless UXML_DISABLE_PREV is defined at build of the library:
+ * then nodes are smaller, but siblings are walked from the first one.
  * \param node - node's pointer.
  * \return Previous node, or NULL if this is first child of parent node.
  */
 uxml_node_t *uxml_prev( uxml_node_t *node );
 
+/*! Get previous attribute
+ *
+ * \param node - node's pointer.
+ * \return Previous attribute, or NULL if this is first attribute of parent node.
+ */
+uxml_node_t *uxml_prev_attr( uxml_node_t *node );
+
+/*! Get last child element or attribute
+ *
+ * \param node - node's pointer.
+ * \return Last child of specified node - element or attribute,
+ * or NULL if there is no children of this node.
+ * Other children nodes can be obtained by sequence of \c uxml_prev calls.
+ */
+uxml_node_t *uxml_last_child( uxml_node_t *node );
+
+/*! Add child element
+ *
+ * Tree can be changed after parse: new nodes, names and contents are allocated
+ * in the arena of document, so cost of change is proportional to its size,
+ * and \c uxml_free releases them with the tree. Pointers to contents, which are
+ * replaced, stay valid until \c uxml_free. Trees of UXML_COMPACT build keep
+ * new nodes in chunks of the arena, which are never moved, so pointers
+ * to them stay valid too.
+ * \param node - parent element's pointer;
+ * \param name - name of new element;
+ * \param content - content of new element, may be NULL.
+ * \return new element, which is the last child of \c node,
+ * or NULL if there is no memory.
+ */
+uxml_node_t *uxml_add_child( uxml_node_t *node, const char *name, const char *content );
+
+/*! Set content of element or value of attribute
+ *
+ * \param node - node's pointer, root or branch;
+ * \param path - node's path, see \c uxml_content description;
+ * \param content - new content, zero-terminated string, may be NULL.
+ * Content replaces the whole content of element, which is split by child elements.
+ * \return 1 if content is set, or 0 if there is no such node or no memory.
+ */
+int uxml_set_content( uxml_node_t *node, const char *path, const char *content );
+
+/*! Set value of attribute, attribute is added, if element hasn't it
+ *
+ * \param node - element's pointer;
+ * \param name - attribute's name;
+ * \param value - attribute's value, may be NULL.
+ * \return 1 if value is set, or 0 if there is no memory.
+ */
+int uxml_set_attr( uxml_node_t *node, const char *name, const char *value );
+
+/*! Remove element or attribute with its subtree from parent element
+ *
+ * Removed node keeps its subtree and stays valid until \c uxml_free.
+ * \param node - node's pointer.
+ * \return 1 if node is removed, or 0 if node is root or has no parent.
+ */
+int uxml_remove( uxml_node_t *node );
+
 /*! Free XML tree
  *
  * \param node - root node's pointer;
@@ -208,6 +817,153 @@ uxml_node_t *uxml_prev( uxml_node_t *node );
  */
 void uxml_free( uxml_node_t *root );
 
+/*! Flags of \c uxml_write
+ */
+enum
+{
+  UXML_WRITE_COMPACT = 0,              /*!< no spaces between nodes */
+  UXML_WRITE_INDENT = 1                /*!< one node per line, nested nodes are indented by 2 spaces */
+};
+
+/*! Write XML to buffer
+ *
+ * Writes node with its attributes and subtree. Root node is preceded by
+ * processing instructions of document, e.g. <?xml ...?>. Content of node
+ * is written before its child nodes, so text, which is mixed with nodes, 
+ * is joined as in \c uxml_get. Characters '<', '>', '&', '"' in values,
+ * control characters and spaces, which parser would collapse, are escaped,
+ * so parsing of output gives the same tree (but parser skips leading spaces of content).
+ * Like \c snprintf, output, which doesn't fit in buffer, is truncated.
+ * \param node - node's pointer, root or branch;
+ * \param buffer - pointer to buffer, may be NULL, if size is 0;
+ * \param size - size of buffer, output is zero-terminated if size isn't 0;
+ * \param flags - UXML_WRITE_COMPACT or UXML_WRITE_INDENT.
+ * \return length of whole output without terminating zero,
+ * output is truncated, if it isn't less than \c size.
+ */
+size_t uxml_write( uxml_node_t *node, char *buffer, size_t size, int flags );
+
+/*! Write XML to file
+ *
+ * Like a \c uxml_write, but output is written to file descriptor
+ * by parts of UXML_WRITE_BUFFER size (64 KB by default).
+ * \param node - node's pointer, root or branch;
+ * \param fd - file descriptor, opened for writing;
+ * \param flags - UXML_WRITE_COMPACT or UXML_WRITE_INDENT.
+ * \return 1 if XML is written, or 0 in case of write error or insufficient memory.
+ */
+int uxml_write_fd( uxml_node_t *node, int fd, int flags );
+
+/*! Callback of streaming writer, see \c uxml_writer_create
+ *
+ * \param user - user's pointer;
+ * \param data - pointer to next part of output;
+ * \param size - size of part in bytes.
+ * \return non-zero to continue writing or 0 to stop it.
+ */
+typedef int (*uxml_flush_t)( void *user, const char *data, size_t size );
+
+/*! Streaming XML writer
+ *
+ * Writer produces XML without tree: elements, attributes and text are passed 
+ * by calls in document order, and writer keeps names of open elements itself.
+ * Output is collected in a buffer of UXML_WRITE_BUFFER size (64 KB by default),
+ * which is passed to callback or file when it is full. Text and values are 
+ * escaped like in \c uxml_write. For example:
+ * \code
+ * uxml_writer_t *w = uxml_writer_create_fd( fd, UXML_WRITE_INDENT );
+ * uxml_writer_start_element( w, "item" );
+ * uxml_writer_attribute( w, "id", "1" );
+ * uxml_writer_text( w, "a & b", 5 );
+ * uxml_writer_end_element( w );
+ * uxml_writer_finish( w, &error );
+ * uxml_writer_free( w );
+ * \endcode
+ * writes <item id="1">a &amp; b</item>.
+ * After an error all calls return 0, and \c uxml_writer_finish reports it.
+ */
+typedef struct _uxml_writer_t uxml_writer_t;
+
+/*! Create streaming writer, which passes output to callback
+ *
+ * \param flush - callback, which gets parts of output;
+ * \param user - user's pointer, passed to callback;
+ * \param flags - UXML_WRITE_COMPACT or UXML_WRITE_INDENT.
+ * \return New writer, or NULL if there is no memory.
+ */
+uxml_writer_t *uxml_writer_create( uxml_flush_t flush, void *user, int flags );
+
+/*! Create streaming writer, which writes output to file
+ *
+ * \param fd - file descriptor, opened for writing;
+ * \param flags - UXML_WRITE_COMPACT or UXML_WRITE_INDENT.
+ * \return New writer, or NULL if there is no memory.
+ */
+uxml_writer_t *uxml_writer_create_fd( int fd, int flags );
+
+/*! Write start of element
+ *
+ * \param writer - writer's pointer;
+ * \param name - name of element, it is written as is.
+ * \return 1 if element is started, or 0 in case of error,
+ * e.g. second element at top level after the root one.
+ */
+int uxml_writer_start_element( uxml_writer_t *writer, const char *name );
+
+/*! Write attribute of element
+ *
+ * Attributes follow \c uxml_writer_start_element call, before text or child elements.
+ * \param writer - writer's pointer;
+ * \param name - name of attribute;
+ * \param value - value of attribute, zero-terminated string.
+ * \return 1 if attribute is written, or 0 in case of error.
+ */
+int uxml_writer_attribute( uxml_writer_t *writer, const char *name, const char *value );
+
+/*! Write text of element
+ *
+ * Text may be passed by several calls, and mixed with child elements.
+ * \param writer - writer's pointer;
+ * \param text - pointer to text;
+ * \param size - size of text in bytes.
+ * \return 1 if text is written, or 0 in case of error.
+ */
+int uxml_writer_text( uxml_writer_t *writer, const char *text, size_t size );
+
+/*! Write binary data of element in base64
+ *
+ * Data may be passed by several calls, it is encoded as one sequence
+ * by \c uxml_encode64, until other call of writer.
+ * \param writer - writer's pointer;
+ * \param data - pointer to data;
+ * \param size - size of data in bytes.
+ * \return 1 if data is written, or 0 in case of error.
+ */
+int uxml_writer_base64( uxml_writer_t *writer, const void *data, size_t size );
+
+/*! Write end of last open element
+ *
+ * Element without text and child elements is written as <name/>.
+ * \param writer - writer's pointer.
+ * \return 1 if element is ended, or 0 in case of error.
+ */
+int uxml_writer_end_element( uxml_writer_t *writer );
+
+/*! Finish writing
+ *
+ * Ends all open elements and passes the rest of output to callback or file.
+ * \param writer - writer's pointer;
+ * \param error - pointer to structure, which will be fill with error description, may be NULL.
+ * \return 1 if whole output is written, or 0 in case of error.
+ */
+int uxml_writer_finish( uxml_writer_t *writer, uxml_error_t *error );
+
+/*! Free streaming writer
+ *
+ * \param writer - writer's pointer, may be NULL.
+ */
+void uxml_writer_free( uxml_writer_t *writer );
+
 /*! Encode to base64 sequence
  *
  * Encode binary data into the Base64 text data.
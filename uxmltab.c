@@ -3,6 +3,7 @@
 #define isdigit( c ) (c>='0'&&c<='9')
 #define isalpha( c ) ((c>='A'&&c<='Z')||(c>='a'&&c<='z'))
 #define isspace( c ) (c==' '||c=='\n'||c=='\t'||c=='\r')
+#define isstruct( c ) (c<=' '||c=='\"'||c=='&'||c=='\''||c=='/'||c=='<'||c=='='||c=='>')
 static const unsigned char base64[]="ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 static signed char base64_decode_tab[256];
 
@@ -62,6 +63,18 @@ int main()
   }
   printf( "};\n" );
 
+  printf( "static const unsigned int uxml_isstruct_tab32[8]={" );
+  for( i = 0; i < 8; i++ )
+  {
+    u = 0;
+    for( j = 0; j < 32; j++ )
+    {
+      u |= (isstruct( i * 32 + j ) << j);
+    }
+    printf( "%s0x%08lX", comma[ i == 0 ], u );
+  }
+  printf( "};\n" );
+
   printf( "static const char base64_decode_tab[256]={" );
   for( i = 0; i < sizeof( base64_decode_tab ); i++ ) base64_decode_tab[i] = -1;
   for( i = 0; i < 64; i++ )